@@ -0,0 +1,226 @@
+//! Procedural macros for the seastar crate.
+//!
+//! Do not depend on this crate directly, use the `#[seastar::main]`,
+//! `#[seastar::test]` and `#[seastar::perf_test]` re-exports instead.
+
+use proc_macro::TokenStream;
+use proc_macro2::TokenStream as TokenStream2;
+use quote::{format_ident, quote, quote_spanned};
+use syn::parse::Parser;
+use syn::spanned::Spanned;
+use syn::{ItemFn, LitInt, LitStr, ReturnType};
+
+/// Reactor configuration accepted by both `#[seastar::main]`
+/// and `#[seastar::test]`, e.g. `#[seastar::test(smp = 2, memory = "512M")]`.
+#[derive(Default)]
+struct ReactorArgs {
+    smp: Option<LitInt>,
+    memory: Option<LitStr>,
+}
+
+impl ReactorArgs {
+    fn parse(attr: TokenStream) -> syn::Result<Self> {
+        let mut args = ReactorArgs::default();
+        let parser = syn::meta::parser(|meta| {
+            if meta.path.is_ident("smp") {
+                args.smp = Some(meta.value()?.parse()?);
+                Ok(())
+            } else if meta.path.is_ident("memory") {
+                args.memory = Some(meta.value()?.parse()?);
+                Ok(())
+            } else {
+                Err(meta.error("unsupported option, expected `smp` or `memory`"))
+            }
+        });
+        parser.parse(attr)?;
+        Ok(args)
+    }
+
+    fn to_options(&self) -> TokenStream2 {
+        let mut options = quote!(::seastar::SeastarOptions::new());
+        if let Some(smp) = &self.smp {
+            options = quote!(#options.smp(#smp));
+        }
+        if let Some(memory) = &self.memory {
+            options = quote!(#options.memory(#memory));
+        }
+        options
+    }
+}
+
+/// Splits an `async fn` into its outer, synchronous signature and an inner
+/// `async fn` holding the original body.
+fn split_async_fn(item: TokenStream, macro_name: &str) -> syn::Result<(ItemFn, TokenStream2)> {
+    let mut input: ItemFn = syn::parse(item)?;
+    if input.sig.asyncness.take().is_none() {
+        return Err(syn::Error::new(
+            input.sig.fn_token.span(),
+            format!("the `async` keyword is missing from the function declaration of #[seastar::{macro_name}]"),
+        ));
+    }
+    if !input.sig.inputs.is_empty() {
+        return Err(syn::Error::new(
+            input.sig.inputs.span(),
+            format!("functions annotated with #[seastar::{macro_name}] cannot take arguments"),
+        ));
+    }
+    let output = match &input.sig.output {
+        ReturnType::Default => quote!(()),
+        ReturnType::Type(_, ty) => quote!(#ty),
+    };
+    let block = &input.block;
+    let inner = quote_spanned! {block.span()=>
+        async fn __seastar_body() -> #output #block
+    };
+    Ok((input, inner))
+}
+
+/// Marks an async function to be run inside a Seastar reactor.
+///
+/// The reactor is started on the calling thread with `std::env::args()` as
+/// its command line and the function is run on shard 0. Once it completes,
+/// the reactor is stopped and the function's output is returned from `main`.
+///
+/// The number of shards and the amount of memory can be given as defaults,
+/// which are used unless the command line specifies them:
+///
+/// ```ignore
+/// #[seastar::main(smp = 4, memory = "2G")]
+/// async fn main() {
+///     // ...
+/// }
+/// ```
+#[proc_macro_attribute]
+pub fn main(attr: TokenStream, item: TokenStream) -> TokenStream {
+    let args = match ReactorArgs::parse(attr) {
+        Ok(args) => args,
+        Err(err) => return err.to_compile_error().into(),
+    };
+    let (input, inner) = match split_async_fn(item, "main") {
+        Ok(split) => split,
+        Err(err) => return err.to_compile_error().into(),
+    };
+    let options = args.to_options();
+    let ItemFn {
+        attrs, vis, sig, ..
+    } = input;
+    quote! {
+        #(#attrs)*
+        #vis #sig {
+            #inner
+            match ::seastar::AppTemplate::new(#options).run(::std::env::args(), __seastar_body()) {
+                ::std::result::Result::Ok(output) => output,
+                ::std::result::Result::Err(code) => ::std::process::exit(code),
+            }
+        }
+    }
+    .into()
+}
+
+/// Marks an async function as a test to be run inside a Seastar reactor.
+///
+/// Only one reactor can run in a process, so all tests in the test binary share
+/// a single reactor which is started by the first test. The test body runs
+/// on shard 0. Panics are propagated to the test harness, so `#[should_panic]`
+/// works as usual.
+///
+/// The reactor runs 2 shards with 1G of memory, regardless of the size of
+/// the machine. The number of shards and the amount of memory can be
+/// configured instead. All tests in a binary must use the same
+/// configuration, because it is fixed when the shared reactor starts:
+///
+/// ```ignore
+/// #[seastar::test(smp = 2, memory = "512M")]
+/// async fn test_something() {
+///     // ...
+/// }
+/// ```
+#[proc_macro_attribute]
+pub fn test(attr: TokenStream, item: TokenStream) -> TokenStream {
+    let args = match ReactorArgs::parse(attr) {
+        Ok(args) => args,
+        Err(err) => return err.to_compile_error().into(),
+    };
+    let (input, inner) = match split_async_fn(item, "test") {
+        Ok(split) => split,
+        Err(err) => return err.to_compile_error().into(),
+    };
+    let options = args.to_options();
+    let ItemFn {
+        attrs, vis, sig, ..
+    } = input;
+    quote! {
+        #[::core::prelude::v1::test]
+        #(#attrs)*
+        #vis #sig {
+            #inner
+            ::seastar::testing::run_test(#options, __seastar_body)
+        }
+    }
+    .into()
+}
+
+/// Registers a function as a benchmark run by `seastar::perf_tests::main`.
+///
+/// The Rust equivalent of perf_tests' `PERF_TEST(group, name)`: the group is
+/// given as the argument of the attribute and the name is the function's name.
+/// The function may be `async`, and may return `usize` to report the number of
+/// iterations it performed in an inner loop.
+///
+/// ```ignore
+/// #[seastar::perf_test(preempt)]
+/// fn need_preempt() {
+///     seastar::perf_tests::do_not_optimize(&seastar::need_preempt());
+/// }
+/// ```
+#[proc_macro_attribute]
+pub fn perf_test(attr: TokenStream, item: TokenStream) -> TokenStream {
+    let group: syn::Ident = match syn::parse(attr) {
+        Ok(group) => group,
+        Err(err) => {
+            return syn::Error::new(err.span(), "expected the name of the benchmark group")
+                .to_compile_error()
+                .into()
+        }
+    };
+    let input: ItemFn = match syn::parse(item) {
+        Ok(input) => input,
+        Err(err) => return err.to_compile_error().into(),
+    };
+    if !input.sig.inputs.is_empty() {
+        return syn::Error::new(
+            input.sig.inputs.span(),
+            "functions annotated with #[seastar::perf_test] cannot take arguments",
+        )
+        .to_compile_error()
+        .into();
+    }
+    let name = &input.sig.ident;
+    let constructor = if input.sig.asyncness.is_some() {
+        quote!(new_async)
+    } else {
+        quote!(new)
+    };
+    let register = format_ident!("__SEASTAR_PERF_TEST_{}", name);
+    // Registration happens before `main`, from .init_array, the same way as
+    // static constructors register PERF_TESTs in C++.
+    quote! {
+        #input
+
+        #[doc(hidden)]
+        #[allow(non_upper_case_globals)]
+        #[used]
+        #[link_section = ".init_array"]
+        static #register: extern "C" fn() = {
+            extern "C" fn register() {
+                ::seastar::perf_tests::register(::seastar::perf_tests::PerfTest::#constructor(
+                    ::std::stringify!(#group),
+                    ::std::stringify!(#name),
+                    #name,
+                ));
+            }
+            register
+        };
+    }
+    .into()
+}
@@ -0,0 +1,206 @@
+//! Measures the cost of crossing the Rust/C++ boundary.
+//!
+//! Whenever possible, the measured loop runs inside the reactor (through
+//! `Bencher::iter_custom`), so the reported time per iteration is directly
+//! comparable with the per-iteration time of an equivalent `PERF_TEST`
+//! built with Seastar's perf_tests. Run with `cargo bench`.
+
+use criterion::{criterion_group, criterion_main, Criterion};
+use seastar::testing::run_in_shared_reactor;
+use seastar::{SeastarOptions, TemporaryBuffer};
+use std::future::Future;
+use std::hint::black_box;
+use std::time::{Duration, Instant};
+
+// Two shards, so that submit_to can be measured across shards.
+fn reactor_options() -> SeastarOptions {
+    SeastarOptions::new().smp(2).memory("1G")
+}
+
+/// Runs `iters` iterations of a benchmark inside the reactor and returns
+/// the time they took, as measured on the reactor thread.
+fn measure_in_reactor<F, Fut>(iters: u64, bench: F) -> Duration
+where
+    F: FnOnce(u64) -> Fut + Send + 'static,
+    Fut: Future<Output = Duration> + 'static,
+{
+    run_in_shared_reactor(reactor_options(), move || bench(iters))
+}
+
+fn bench_need_preempt(c: &mut Criterion) {
+    let mut group = c.benchmark_group("need_preempt");
+    group.bench_function("outside_reactor", |b| {
+        b.iter(|| black_box(seastar::need_preempt()))
+    });
+    group.bench_function("in_reactor", |b| {
+        b.iter_custom(|iters| {
+            measure_in_reactor(iters, |iters| async move {
+                let start = Instant::now();
+                for _ in 0..iters {
+                    black_box(seastar::need_preempt());
+                }
+                start.elapsed()
+            })
+        })
+    });
+    group.finish();
+}
+
+fn bench_futures(c: &mut Criterion) {
+    let mut group = c.benchmark_group("futures");
+    // A wake-up followed by a poll from the reactor's task queue.
+    group.bench_function("wake_and_poll", |b| {
+        b.iter_custom(|iters| {
+            measure_in_reactor(iters, |iters| async move {
+                let start = Instant::now();
+                for _ in 0..iters {
+                    seastar::yield_now().await;
+                }
+                start.elapsed()
+            })
+        })
+    });
+    // Creating a seastar task for a future, running it and joining it.
+    group.bench_function("spawn_and_join", |b| {
+        b.iter_custom(|iters| {
+            measure_in_reactor(iters, |iters| async move {
+                let start = Instant::now();
+                for i in 0..iters {
+                    black_box(seastar::spawn(async move { i }).await);
+                }
+                start.elapsed()
+            })
+        })
+    });
+    group.finish();
+}
+
+fn bench_cross_thread(c: &mut Criterion) {
+    let mut group = c.benchmark_group("cross_thread");
+    // Submitting a future to shard 0 from a non-reactor thread through the
+    // alien queue and waiting for its completion.
+    group.bench_function("alien_round_trip", |b| {
+        b.iter(|| run_in_shared_reactor(reactor_options(), || async {}))
+    });
+    group.finish();
+}
+
+fn bench_cross_shard(c: &mut Criterion) {
+    let mut group = c.benchmark_group("cross_shard");
+    // A round trip through smp::submit_to which stays on the shard, which
+    // is the fixed cost of boxing the closure and of the result channel.
+    group.bench_function("submit_to_same_shard", |b| {
+        b.iter_custom(|iters| {
+            measure_in_reactor(iters, |iters| async move {
+                let start = Instant::now();
+                for i in 0..iters {
+                    black_box(seastar::smp::submit_to(0, move || async move { i }).await);
+                }
+                start.elapsed()
+            })
+        })
+    });
+    // A round trip to another shard and back through the smp queues.
+    group.bench_function("submit_to_other_shard", |b| {
+        b.iter_custom(|iters| {
+            measure_in_reactor(iters, |iters| async move {
+                let start = Instant::now();
+                for i in 0..iters {
+                    black_box(seastar::smp::submit_to(1, move || async move { i }).await);
+                }
+                start.elapsed()
+            })
+        })
+    });
+    group.finish();
+}
+
+fn bench_buffers(c: &mut Criterion) {
+    let mut group = c.benchmark_group("buffers");
+    // A temporary_buffer allocated and filled by C++, handed over to Rust
+    // and destroyed by C++ again.
+    group.bench_function("copy_of_4k", |b| {
+        b.iter_custom(|iters| {
+            measure_in_reactor(iters, |iters| async move {
+                let bytes = [0u8; 4096];
+                let start = Instant::now();
+                for _ in 0..iters {
+                    black_box(TemporaryBuffer::copy_of(black_box(&bytes)));
+                }
+                start.elapsed()
+            })
+        })
+    });
+    // Handing out another view of the same bytes, the way received buffers
+    // are split without copying, and dropping it.
+    group.bench_function("share_and_drop", |b| {
+        b.iter_custom(|iters| {
+            measure_in_reactor(iters, |iters| async move {
+                let mut buf = TemporaryBuffer::copy_of(&[0u8; 4096]);
+                let start = Instant::now();
+                for _ in 0..iters {
+                    black_box(buf.share());
+                }
+                start.elapsed()
+            })
+        })
+    });
+    // Borrowing the bytes of a buffer, which goes through C++.
+    group.bench_function("as_bytes", |b| {
+        b.iter_custom(|iters| {
+            measure_in_reactor(iters, |iters| async move {
+                let buf = TemporaryBuffer::copy_of(&[0u8; 4096]);
+                let start = Instant::now();
+                for _ in 0..iters {
+                    black_box(black_box(&buf).as_bytes());
+                }
+                start.elapsed()
+            })
+        })
+    });
+    group.finish();
+}
+
+fn bench_allocator(c: &mut Criterion) {
+    let mut group = c.benchmark_group("allocator");
+    // Rust allocations on a reactor thread are served by the shard's
+    // allocator (when Seastar replaces malloc), those on other threads
+    // are not. Comparing the two shows the cost of the routing.
+    group.bench_function("box_outside_reactor", |b| {
+        b.iter(|| black_box(Box::new(black_box(0u64))))
+    });
+    group.bench_function("box_in_reactor", |b| {
+        b.iter_custom(|iters| {
+            measure_in_reactor(iters, |iters| async move {
+                let start = Instant::now();
+                for _ in 0..iters {
+                    black_box(Box::new(black_box(0u64)));
+                }
+                start.elapsed()
+            })
+        })
+    });
+    group.bench_function("vec_4k_in_reactor", |b| {
+        b.iter_custom(|iters| {
+            measure_in_reactor(iters, |iters| async move {
+                let start = Instant::now();
+                for _ in 0..iters {
+                    black_box(Vec::<u8>::with_capacity(black_box(4096)));
+                }
+                start.elapsed()
+            })
+        })
+    });
+    group.finish();
+}
+
+criterion_group!(
+    benches,
+    bench_need_preempt,
+    bench_futures,
+    bench_cross_thread,
+    bench_cross_shard,
+    bench_buffers,
+    bench_allocator
+);
+criterion_main!(benches);
@@ -0,0 +1,58 @@
+//! Microbenchmarks run inside the reactor by the perf_tests runner, which
+//! also reports allocations and tasks per iteration.
+//!
+//! Run with `cargo bench --bench perf -- --runs 5 --duration 1`.
+
+use seastar::perf_tests::do_not_optimize;
+
+#[seastar::perf_test(preempt)]
+fn need_preempt() {
+    do_not_optimize(&seastar::need_preempt());
+}
+
+#[seastar::perf_test(executor)]
+async fn wake_and_poll() {
+    seastar::yield_now().await;
+}
+
+#[seastar::perf_test(executor)]
+async fn spawn_and_join() {
+    do_not_optimize(&seastar::spawn(async { 42 }).await);
+}
+
+#[seastar::perf_test(allocator)]
+fn box_u64() {
+    do_not_optimize(&Box::new(0u64));
+}
+
+/// A queue which stays around 1000 items, so that pushes regularly cross
+/// chunk boundaries.
+const QUEUE_LENGTH: usize = 1000;
+
+#[seastar::perf_test(containers)]
+fn circular_buffer_push_pop() {
+    thread_local! {
+        static QUEUE: std::cell::RefCell<seastar::CircularBuffer<u64>> =
+            std::cell::RefCell::new((0..QUEUE_LENGTH as u64).collect());
+    }
+    QUEUE.with_borrow_mut(|queue| {
+        queue.push_back(0);
+        do_not_optimize(&queue.pop_front());
+    });
+}
+
+#[seastar::perf_test(containers)]
+fn chunked_fifo_push_pop() {
+    thread_local! {
+        static QUEUE: std::cell::RefCell<seastar::ChunkedFifo<u64>> =
+            std::cell::RefCell::new((0..QUEUE_LENGTH as u64).collect());
+    }
+    QUEUE.with_borrow_mut(|queue| {
+        queue.push_back(0);
+        do_not_optimize(&queue.pop_front());
+    });
+}
+
+fn main() {
+    seastar::perf_tests::main();
+}
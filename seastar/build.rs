@@ -1,8 +1,50 @@
-use std::path::PathBuf;
+use std::env;
+use std::fs;
+use std::path::{Path, PathBuf};
 
 static CXX_BRIDGES: &[&str] = &[
     // Put all files that contain a cxx::bridge into this list
+    "src/app_template.rs",
+    "src/build_config.rs",
+    "src/completion.rs",
+    "src/executor.rs",
+    "src/file.rs",
+    "src/httpd.rs",
+    "src/iostream.rs",
+    "src/logging.rs",
+    "src/lw_shared_ptr.rs",
+    "src/memory.rs",
+    "src/net.rs",
+    "src/perf_tests.rs",
     "src/preempt.rs",
+    "src/scheduling.rs",
+    "src/smp.rs",
+    "src/sstring.rs",
+    "src/task_stats.rs",
+    "src/temporary_buffer.rs",
+    "src/testing.rs",
+];
+
+static CXX_CPP_SOURCES: &[&str] = &[
+    // Put all C++ source files which implement the bridges into this list
+    "src/app_template.cc",
+    "src/build_config.cc",
+    "src/completion.cc",
+    "src/executor.cc",
+    "src/file.cc",
+    "src/httpd.cc",
+    "src/iostream.cc",
+    "src/logging.cc",
+    "src/lw_shared_ptr.cc",
+    "src/memory.cc",
+    "src/net.cc",
+    "src/perf_tests.cc",
+    "src/scheduling.cc",
+    "src/smp.cc",
+    "src/sstring.cc",
+    "src/task_stats.cc",
+    "src/temporary_buffer.cc",
+    "src/testing.cc",
 ];
 
 fn main() {
@@ -23,7 +65,16 @@ fn main() {
     // TODO: Remove this after seastar.pc or the pkg-config crate is fixed
     pkg_config::Config::new().statik(true).probe("fmt").unwrap();
 
-    // TODO: liburing probably has the same problem as above
+    // liburing has the same problem as fmt above, but only seastar builds
+    // with io_uring support depend on it.
+    let seastar_config = SeastarConfig::detect(&seastar);
+    if seastar_config.uring {
+        pkg_config::Config::new()
+            .statik(true)
+            .probe("liburing")
+            .unwrap();
+    }
+    seastar_config.emit();
 
     let cxx_bridges = CXX_BRIDGES
         .iter()
@@ -37,7 +88,11 @@ fn main() {
             None => build.define(var, None),
         };
     }
+    if env::var_os("CARGO_FEATURE_CROSS_LANGUAGE_LTO").is_some() {
+        enable_cross_language_lto(&mut build);
+    }
     build
+        .files(CXX_CPP_SOURCES)
         .flag_if_supported("-Wall")
         .flag_if_supported("-std=c++20")
         .flag_if_supported("-fcoroutines")
@@ -46,7 +101,120 @@ fn main() {
         .compile("seastar-rs");
 
     println!("cargo:rerun-if-changed=build.rs");
+    println!("cargo:rerun-if-env-changed=CXX");
     for bridge_file in cxx_bridges.iter() {
         println!("cargo:rerun-if-changed={}", bridge_file.to_str().unwrap());
     }
+    for source_file in CXX_CPP_SOURCES {
+        println!("cargo:rerun-if-changed={}", source_file);
+        let header_file = PathBuf::from(source_file).with_extension("hh");
+        println!("cargo:rerun-if-changed={}", header_file.to_str().unwrap());
+    }
+}
+
+// Default value of SEASTAR_SCHEDULING_GROUPS_COUNT in seastar's build system.
+const DEFAULT_SCHEDULING_GROUPS_COUNT: usize = 16;
+
+// Configuration which seastar was built with, as far as it can be told
+// from its pkg-config file.
+struct SeastarConfig {
+    uring: bool,
+    dpdk: bool,
+    debug: bool,
+    debug_shared_ptr: bool,
+    default_allocator: bool,
+    alloc_failure_injection: bool,
+    scheduling_groups_count: usize,
+    api_level: Option<u32>,
+}
+
+impl SeastarConfig {
+    fn detect(seastar: &pkg_config::Library) -> Self {
+        let defined = |name: &str| seastar.defines.contains_key(name);
+        let value = |name: &str| seastar.defines.get(name).cloned().flatten();
+        let links = |pred: &dyn Fn(&str) -> bool| seastar.libs.iter().any(|lib| pred(lib));
+        Self {
+            uring: defined("SEASTAR_HAVE_URING") || links(&|lib| lib == "uring"),
+            dpdk: defined("SEASTAR_HAVE_DPDK")
+                || links(&|lib| lib.starts_with("rte_") || lib.contains("dpdk")),
+            debug: defined("SEASTAR_DEBUG"),
+            debug_shared_ptr: defined("SEASTAR_DEBUG_SHARED_PTR"),
+            default_allocator: defined("SEASTAR_DEFAULT_ALLOCATOR"),
+            alloc_failure_injection: defined("SEASTAR_ENABLE_ALLOC_FAILURE_INJECTION"),
+            scheduling_groups_count: value("SEASTAR_SCHEDULING_GROUPS_COUNT")
+                .map(|count| count.parse().unwrap())
+                .unwrap_or(DEFAULT_SCHEDULING_GROUPS_COUNT),
+            api_level: value("SEASTAR_API_LEVEL").map(|level| level.parse().unwrap()),
+        }
+    }
+
+    // Exposes the configuration to the Rust code as cfgs and as constants
+    // in $OUT_DIR/seastar_config.rs, which is included by build_config.rs.
+    fn emit(&self) {
+        for (cfg, enabled) in [
+            ("seastar_uring", self.uring),
+            ("seastar_dpdk", self.dpdk),
+            ("seastar_debug", self.debug),
+            ("seastar_debug_shared_ptr", self.debug_shared_ptr),
+            ("seastar_default_allocator", self.default_allocator),
+            (
+                "seastar_alloc_failure_injection",
+                self.alloc_failure_injection,
+            ),
+        ] {
+            println!("cargo:rustc-check-cfg=cfg({cfg})");
+            if enabled {
+                println!("cargo:rustc-cfg={cfg}");
+            }
+        }
+
+        let api_level = match self.api_level {
+            Some(level) => format!("Some({level})"),
+            None => "None".to_owned(),
+        };
+        let constants = format!(
+            "pub const SCHEDULING_GROUPS_COUNT: usize = {};\n\
+             pub const API_LEVEL: Option<u32> = {};\n",
+            self.scheduling_groups_count, api_level,
+        );
+        let out_dir = env::var("OUT_DIR").unwrap();
+        fs::write(Path::new(&out_dir).join("seastar_config.rs"), constants).unwrap();
+    }
+}
+
+// Compiles the bridges into LLVM bitcode, so that the linker can inline
+// the C++ side of trivial bridged functions (e.g. need_preempt) into their
+// Rust callers. The Rust side has to be compiled with `-Clinker-plugin-lto`
+// and linked with clang and lld, which can only be requested through
+// RUSTFLAGS - a build script cannot set flags for the dependent crates.
+fn enable_cross_language_lto(build: &mut cc::Build) {
+    // Respect an explicitly chosen compiler, but it has to be a clang whose
+    // LLVM version matches the one used by rustc.
+    if env::var_os("CXX").is_none() {
+        build.compiler("clang++");
+    }
+    // GCC would reject -flto=thin, and its LTO objects could not be read by
+    // the LLVM linker plugin anyway.
+    let compiler = build.get_compiler();
+    if !compiler.is_like_clang() {
+        println!(
+            "cargo:warning=the cross-language-lto feature requires clang, but {} is not clang; \
+             building without cross-language LTO",
+            compiler.path().display(),
+        );
+        return;
+    }
+    build.archiver("llvm-ar").flag("-flto=thin");
+
+    let rustflags = env::var("CARGO_ENCODED_RUSTFLAGS").unwrap_or_default();
+    if !rustflags
+        .split('\x1f')
+        .any(|flag| flag.contains("linker-plugin-lto"))
+    {
+        println!(
+            "cargo:warning=the cross-language-lto feature requires RUSTFLAGS to contain \
+             -Clinker-plugin-lto -Clinker=clang -Clink-arg=-fuse-ld=lld, \
+             otherwise the bridges will not be inlined"
+        );
+    }
 }
@@ -0,0 +1,86 @@
+#include "seastar/src/app_template.hh"
+#include "seastar/src/app_template.rs.h"
+#include "seastar/src/executor.hh"
+#include "seastar/src/logging.hh"
+
+#include <seastar/core/app-template.hh>
+
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace seastar_rs {
+
+// Set on shard 0 while a reactor runs. Other threads can ask for it, e.g.
+// while the test reactor starts, hence the mutex.
+static std::mutex active_reactor_backend_mutex;
+static std::string active_reactor_backend;
+
+void remember_reactor_config(const seastar::app_template& app) {
+    // The backend which the reactor was created with: the one given by
+    // --reactor-backend, or the default which seastar picked among those
+    // available on this machine.
+    const auto& backend = app.options().reactor_opts.reactor_backend;
+    {
+        std::lock_guard lock(active_reactor_backend_mutex);
+        active_reactor_backend = backend.get_selected_candidate_name();
+    }
+    remember_log_config(app);
+}
+
+void forget_reactor_config() {
+    std::lock_guard lock(active_reactor_backend_mutex);
+    active_reactor_backend.clear();
+}
+
+rust::String reactor_backend_name() {
+    std::lock_guard lock(active_reactor_backend_mutex);
+    return rust::String(active_reactor_backend);
+}
+
+rust::Vec<rust::String> available_reactor_backends() {
+    // Seastar fills in the candidates when the options are created, after
+    // checking which backends the kernel supports.
+    seastar::app_template::seastar_options options;
+    rust::Vec<rust::String> names;
+    for (const auto& name : options.reactor_opts.reactor_backend.get_candidate_names()) {
+        names.push_back(rust::String(name));
+    }
+    return names;
+}
+
+int32_t run_app_template(rust::Slice<const rust::String> args, rust::Box<MainTask> task) {
+    std::vector<std::string> arg_strings;
+    arg_strings.reserve(args.size());
+    for (const auto& arg : args) {
+        arg_strings.emplace_back(std::string(arg));
+    }
+    std::vector<char*> argv;
+    argv.reserve(arg_strings.size() + 1);
+    for (auto& arg : arg_strings) {
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+
+    // app_template::run() takes a std::function, which has to be copyable,
+    // so the task is handed over through a raw pointer instead of a capture.
+    MainTask* raw_task = task.into_raw();
+    seastar::app_template app;
+    int ret = app.run(int(arg_strings.size()), argv.data(), [&app, &raw_task] {
+        remember_reactor_config(app);
+        auto task = rust::Box<MainTask>::from_raw(std::exchange(raw_task, nullptr));
+        seastar::promise<> pr;
+        auto f = pr.get_future();
+        start_main_task(std::move(task), std::make_unique<void_promise>(std::move(pr)));
+        return f;
+    });
+    forget_reactor_config();
+    if (raw_task) {
+        // The reactor was not started (or only printed --help).
+        rust::Box<MainTask>::from_raw(raw_task);
+    }
+    return ret;
+}
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "rust/cxx.h"
+
+#include <cstdint>
+#include <string>
+
+namespace seastar {
+
+class app_template;
+
+}
+
+namespace seastar_rs {
+
+struct MainTask;
+
+// Runs seastar::app_template with the given command line and the Rust main
+// task on shard 0. Returns the exit code of app_template::run().
+int32_t run_app_template(rust::Slice<const rust::String> args, rust::Box<MainTask> task);
+
+// Records the parts of the configuration of a started app_template which
+// can be queried from Rust. Must be called before any Rust code runs.
+void remember_reactor_config(const seastar::app_template& app);
+
+// Forgets the configuration once the reactor has stopped.
+void forget_reactor_config();
+
+// The name of the reactor backend in use, empty if no reactor is running.
+rust::String reactor_backend_name();
+
+// The names of the reactor backends which seastar can use on this machine.
+rust::Vec<rust::String> available_reactor_backends();
+
+}
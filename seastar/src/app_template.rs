@@ -0,0 +1,338 @@
+use crate::executor::{spawn_into_promise, TaskResult, VoidPromise};
+use futures::FutureExt;
+use std::cell::RefCell;
+use std::future::Future;
+use std::panic::{self, AssertUnwindSafe};
+use std::pin::Pin;
+use std::rc::Rc;
+
+#[cxx::bridge(namespace = "seastar_rs")]
+mod ffi {
+    extern "Rust" {
+        type MainTask;
+
+        fn start_main_task(task: Box<MainTask>, done: UniquePtr<VoidPromise>);
+    }
+
+    unsafe extern "C++" {
+        include!("seastar/src/app_template.hh");
+
+        #[cxx_name = "void_promise"]
+        type VoidPromise = crate::executor::VoidPromise;
+
+        fn run_app_template(args: &[String], task: Box<MainTask>) -> i32;
+        fn reactor_backend_name() -> String;
+        fn available_reactor_backends() -> Vec<String>;
+    }
+}
+
+/// The reactor backend, i.e. the mechanism used by the reactor to wait for
+/// and complete I/O.
+#[derive(Clone, Copy, Debug, PartialEq, Eq, Hash)]
+pub enum ReactorBackend {
+    /// Linux AIO for storage and networking, polled with io_getevents.
+    LinuxAio,
+    /// Linux AIO for storage, epoll for networking.
+    Epoll,
+    /// io_uring for storage and networking. Only available if seastar
+    /// was built with io_uring support, see [`build_config::HAVE_URING`],
+    /// and the kernel supports it.
+    ///
+    /// [`build_config::HAVE_URING`]: crate::build_config::HAVE_URING
+    IoUring,
+}
+
+impl ReactorBackend {
+    /// Returns the name of the backend as used by `--reactor-backend`.
+    pub fn name(self) -> &'static str {
+        match self {
+            ReactorBackend::LinuxAio => "linux-aio",
+            ReactorBackend::Epoll => "epoll",
+            ReactorBackend::IoUring => "io_uring",
+        }
+    }
+
+    /// Parses the name used by `--reactor-backend`.
+    pub fn from_name(name: &str) -> Option<Self> {
+        match name {
+            "linux-aio" => Some(ReactorBackend::LinuxAio),
+            "epoll" => Some(ReactorBackend::Epoll),
+            "io_uring" => Some(ReactorBackend::IoUring),
+            _ => None,
+        }
+    }
+
+    /// Returns the backends which seastar can use on this machine.
+    ///
+    /// Seastar checks at runtime whether the kernel supports them, so
+    /// io_uring is only listed if seastar was built with it and the kernel
+    /// allows setting up a ring. Can be called without a running reactor.
+    pub fn available() -> Vec<Self> {
+        ffi::available_reactor_backends()
+            .iter()
+            .filter_map(|name| Self::from_name(name))
+            .collect()
+    }
+
+    /// Returns the available backend with the best syscall batching:
+    /// io_uring, then linux-aio, then epoll, see [`ReactorBackend::available`].
+    pub fn best_available() -> Self {
+        let available = Self::available();
+        [ReactorBackend::IoUring, ReactorBackend::LinuxAio]
+            .into_iter()
+            .find(|backend| available.contains(backend))
+            .unwrap_or(ReactorBackend::Epoll)
+    }
+}
+
+/// Returns the backend used by the running reactor, or `None` if no reactor
+/// is running.
+pub fn reactor_backend() -> Option<ReactorBackend> {
+    ReactorBackend::from_name(&ffi::reactor_backend_name())
+}
+
+/// Options of the Seastar runtime which are set through the command line.
+///
+/// Options given here are only defaults - when the same option appears
+/// in the command line passed to [`AppTemplate::run`], the command line wins.
+#[derive(Clone, Debug, Default, PartialEq, Eq)]
+pub struct SeastarOptions {
+    smp: Option<u32>,
+    memory: Option<String>,
+    reactor_backend: Option<ReactorBackend>,
+    max_networking_io_control_blocks: Option<u32>,
+    poll_mode: bool,
+    idle_poll_time_us: Option<u32>,
+}
+
+impl SeastarOptions {
+    /// Creates options which leave everything at Seastar's defaults.
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Sets the number of threads (shards) to run, `--smp`.
+    pub fn smp(mut self, smp: u32) -> Self {
+        self.smp = Some(smp);
+        self
+    }
+
+    /// Sets the amount of memory to use, `--memory`, e.g. `"512M"` or `"4G"`.
+    pub fn memory(mut self, memory: impl Into<String>) -> Self {
+        self.memory = Some(memory.into());
+        self
+    }
+
+    /// Selects the reactor backend, `--reactor-backend`.
+    pub fn reactor_backend(mut self, backend: ReactorBackend) -> Self {
+        self.reactor_backend = Some(backend);
+        self
+    }
+
+    /// Sets the maximum number of I/O control blocks to allocate per shard
+    /// for networking, `--max-networking-io-control-blocks`. Only used by
+    /// the linux-aio backend.
+    pub fn max_networking_io_control_blocks(mut self, blocks: u32) -> Self {
+        self.max_networking_io_control_blocks = Some(blocks);
+        self
+    }
+
+    /// Makes the reactor poll continuously instead of sleeping when idle,
+    /// `--poll-mode`. Trades CPU for latency.
+    pub fn poll_mode(mut self, poll_mode: bool) -> Self {
+        self.poll_mode = poll_mode;
+        self
+    }
+
+    /// Sets how long the reactor polls before going to sleep when idle,
+    /// in microseconds, `--idle-poll-time-us`.
+    pub fn idle_poll_time_us(mut self, micros: u32) -> Self {
+        self.idle_poll_time_us = Some(micros);
+        self
+    }
+
+    /// Sets the number of shards and the amount of memory unless they are
+    /// set already.
+    pub(crate) fn with_default_resources(mut self, smp: u32, memory: &str) -> Self {
+        self.smp.get_or_insert(smp);
+        self.memory.get_or_insert_with(|| memory.to_owned());
+        self
+    }
+
+    /// Appends the options to the command line, skipping those which
+    /// the command line already specifies.
+    pub(crate) fn apply_to_args(&self, args: &mut Vec<String>) {
+        if let Some(smp) = self.smp {
+            push_arg_if_absent(args, "--smp", smp.to_string());
+        }
+        if let Some(memory) = &self.memory {
+            push_arg_if_absent(args, "--memory", memory.clone());
+        }
+        if let Some(backend) = self.reactor_backend {
+            push_arg_if_absent(args, "--reactor-backend", backend.name().to_owned());
+        }
+        if let Some(blocks) = self.max_networking_io_control_blocks {
+            push_arg_if_absent(
+                args,
+                "--max-networking-io-control-blocks",
+                blocks.to_string(),
+            );
+        }
+        if self.poll_mode && !has_arg(args, "--poll-mode") {
+            args.push("--poll-mode".to_owned());
+        }
+        if let Some(micros) = self.idle_poll_time_us {
+            push_arg_if_absent(args, "--idle-poll-time-us", micros.to_string());
+        }
+    }
+}
+
+fn has_arg(args: &[String], name: &str) -> bool {
+    args.iter().any(|arg| {
+        arg.strip_prefix(name)
+            .is_some_and(|rest| rest.is_empty() || rest.starts_with('='))
+    })
+}
+
+fn push_arg_if_absent(args: &mut Vec<String>, name: &str, value: String) {
+    if !has_arg(args, name) {
+        args.push(name.to_owned());
+        args.push(value);
+    }
+}
+
+/// The main future of the application, started on shard 0.
+struct MainTask(Pin<Box<dyn Future<Output = ()>>>);
+
+// The signature is dictated by the bridge.
+#[allow(clippy::boxed_local)]
+fn start_main_task(task: Box<MainTask>, done: cxx::UniquePtr<VoidPromise>) {
+    spawn_into_promise(task.0, done);
+}
+
+/// Sets up and runs the Seastar runtime.
+///
+/// Corresponds to `seastar::app_template`.
+#[derive(Default)]
+pub struct AppTemplate {
+    options: SeastarOptions,
+}
+
+impl AppTemplate {
+    /// Creates an app template which starts the runtime with the given options.
+    pub fn new(options: SeastarOptions) -> Self {
+        Self { options }
+    }
+
+    /// Starts the reactor, runs the future on shard 0 and stops the reactor
+    /// after the future completes.
+    ///
+    /// `args` is the command line of the application, including the program
+    /// name, typically `std::env::args()`. The calling thread becomes shard 0.
+    ///
+    /// Returns the output of the future, or Seastar's exit code if the future
+    /// was not run at all - either because the runtime failed to start or because
+    /// the command line only asked for `--help`.
+    ///
+    /// # Panics
+    ///
+    /// If the future panics, the reactor is stopped and the panic is resumed
+    /// on the calling thread.
+    pub fn run<Fut>(
+        self,
+        args: impl IntoIterator<Item = String>,
+        main: Fut,
+    ) -> Result<Fut::Output, i32>
+    where
+        Fut: Future + 'static,
+        Fut::Output: 'static,
+    {
+        let mut args = args.into_iter().collect::<Vec<_>>();
+        if args.is_empty() {
+            args.push("seastar".to_owned());
+        }
+        self.options.apply_to_args(&mut args);
+
+        let result: Rc<RefCell<Option<TaskResult<Fut::Output>>>> = Rc::new(RefCell::new(None));
+        let main_result = result.clone();
+        let task = MainTask(Box::pin(async move {
+            let output = AssertUnwindSafe(main).catch_unwind().await;
+            *main_result.borrow_mut() = Some(output);
+        }));
+
+        let code = ffi::run_app_template(&args, Box::new(task));
+        let output = result.borrow_mut().take();
+        match output {
+            Some(Ok(output)) => Ok(output),
+            Some(Err(payload)) => panic::resume_unwind(payload),
+            None => Err(code),
+        }
+    }
+}
+
+#[test]
+fn test_options_do_not_override_command_line() {
+    let options = SeastarOptions::new().smp(2).memory("1G");
+
+    let mut args = vec!["app".to_owned(), "--smp=4".to_owned()];
+    options.apply_to_args(&mut args);
+    assert_eq!(args, ["app", "--smp=4", "--memory", "1G"]);
+
+    let mut args = vec!["app".to_owned(), "--memory".to_owned(), "2G".to_owned()];
+    options.apply_to_args(&mut args);
+    assert_eq!(args, ["app", "--memory", "2G", "--smp", "2"]);
+}
+
+#[test]
+fn test_default_resources_do_not_override_options() {
+    let options = SeastarOptions::new().smp(4).with_default_resources(2, "1G");
+    assert_eq!(options, SeastarOptions::new().smp(4).memory("1G"));
+}
+
+#[test]
+fn test_reactor_options_to_args() {
+    let options = SeastarOptions::new()
+        .reactor_backend(ReactorBackend::Epoll)
+        .max_networking_io_control_blocks(5000)
+        .poll_mode(true)
+        .idle_poll_time_us(100);
+
+    let mut args = vec!["app".to_owned(), "--reactor-backend=io_uring".to_owned()];
+    options.apply_to_args(&mut args);
+    assert_eq!(
+        args,
+        [
+            "app",
+            "--reactor-backend=io_uring",
+            "--max-networking-io-control-blocks",
+            "5000",
+            "--poll-mode",
+            "--idle-poll-time-us",
+            "100",
+        ]
+    );
+}
+
+#[test]
+fn test_reactor_backend_names() {
+    for backend in [
+        ReactorBackend::LinuxAio,
+        ReactorBackend::Epoll,
+        ReactorBackend::IoUring,
+    ] {
+        assert_eq!(ReactorBackend::from_name(backend.name()), Some(backend));
+    }
+}
+
+#[test]
+fn test_best_available_backend_is_available() {
+    let available = ReactorBackend::available();
+    assert!(!available.is_empty());
+    assert!(available.contains(&ReactorBackend::best_available()));
+}
+
+#[seastar::test]
+async fn test_reactor_backend_is_reported() {
+    let backend = reactor_backend().unwrap();
+    assert!(ReactorBackend::available().contains(&backend));
+}
@@ -0,0 +1,11 @@
+#include "seastar/src/build_config.hh"
+
+#include <seastar/core/scheduling.hh>
+
+namespace seastar_rs {
+
+uint32_t max_scheduling_groups() {
+    return seastar::max_scheduling_groups();
+}
+
+}
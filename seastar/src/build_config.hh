@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+
+namespace seastar_rs {
+
+// The maximum number of scheduling groups, SEASTAR_SCHEDULING_GROUPS_COUNT.
+uint32_t max_scheduling_groups();
+
+}
@@ -0,0 +1,65 @@
+//! The configuration which the linked seastar library was built with.
+//!
+//! It is detected by the build script from seastar's pkg-config file. Code
+//! which depends on it can use the constants below, or the corresponding
+//! cfgs for conditional compilation:
+//!
+//! - `seastar_uring` - seastar supports the io_uring reactor backend,
+//! - `seastar_dpdk` - seastar supports the DPDK network stack,
+//! - `seastar_debug` - seastar was built in debug mode,
+//! - `seastar_debug_shared_ptr` - seastar's shared pointers check that they
+//!   are used by a single thread, as in its debug and sanitize modes,
+//! - `seastar_default_allocator` - seastar uses the system allocator instead
+//!   of its own, so there are no per-shard memory pools,
+//! - `seastar_alloc_failure_injection` - seastar's allocator can be made to
+//!   fail allocations on purpose, see [`crate::memory::fail_allocation_after`].
+
+#[cxx::bridge(namespace = "seastar_rs")]
+mod ffi {
+    unsafe extern "C++" {
+        include!("seastar/src/build_config.hh");
+
+        fn max_scheduling_groups() -> u32;
+    }
+}
+
+// Written by the build script.
+mod detected {
+    include!(concat!(env!("OUT_DIR"), "/seastar_config.rs"));
+}
+
+/// The maximum number of scheduling groups, `SEASTAR_SCHEDULING_GROUPS_COUNT`.
+///
+/// Data kept per scheduling group, such as the queues of an execution
+/// stage, can be stored in an array of this size indexed by the group.
+pub const SCHEDULING_GROUPS_COUNT: usize = detected::SCHEDULING_GROUPS_COUNT;
+
+/// The API level which seastar's headers were configured with,
+/// `SEASTAR_API_LEVEL`, or `None` if it is not set.
+pub const API_LEVEL: Option<u32> = detected::API_LEVEL;
+
+/// Whether seastar supports the io_uring reactor backend.
+pub const HAVE_URING: bool = cfg!(seastar_uring);
+
+/// Whether seastar supports the DPDK network stack.
+pub const HAVE_DPDK: bool = cfg!(seastar_dpdk);
+
+/// Whether seastar was built in debug mode.
+pub const DEBUG: bool = cfg!(seastar_debug);
+
+/// Whether seastar uses the system allocator instead of its own.
+pub const DEFAULT_ALLOCATOR: bool = cfg!(seastar_default_allocator);
+
+/// Whether seastar's allocator supports injecting allocation failures.
+pub const ALLOC_FAILURE_INJECTION: bool = cfg!(seastar_alloc_failure_injection);
+
+// The build script reads the configuration from seastar's pkg-config file
+// rather than from its headers, so check that it got the same values as
+// the C++ code which includes them.
+#[test]
+fn test_scheduling_groups_count_matches_headers() {
+    assert_eq!(
+        SCHEDULING_GROUPS_COUNT,
+        ffi::max_scheduling_groups() as usize
+    );
+}
@@ -0,0 +1,367 @@
+//! A FIFO queue stored in fixed-size chunks, `seastar::chunked_fifo`.
+
+use std::fmt;
+use std::mem::MaybeUninit;
+use std::ptr::{self, NonNull};
+
+/// The default number of items per chunk, the same as in seastar.
+pub const DEFAULT_ITEMS_PER_CHUNK: usize = 128;
+
+struct Chunk<T, const N: usize> {
+    items: [MaybeUninit<T>; N],
+    // Positions of the first and the one-past-last live item. Items are
+    // only added at the end, so a chunk is reused only once it is empty.
+    begin: usize,
+    end: usize,
+    next: Option<NonNull<Chunk<T, N>>>,
+}
+
+impl<T, const N: usize> Chunk<T, N> {
+    fn allocate() -> NonNull<Self> {
+        let mut chunk = Box::<Self>::new_uninit();
+        let raw = chunk.as_mut_ptr();
+        // Safety: the items are MaybeUninit and need no initialization,
+        // the other fields are initialized here.
+        unsafe {
+            ptr::addr_of_mut!((*raw).begin).write(0);
+            ptr::addr_of_mut!((*raw).end).write(0);
+            ptr::addr_of_mut!((*raw).next).write(None);
+            NonNull::new_unchecked(Box::into_raw(chunk.assume_init()))
+        }
+    }
+}
+
+/// A FIFO queue with the allocation behaviour of `seastar::chunked_fifo`.
+///
+/// Items are stored in a linked list of chunks of `N` items each. Pushing
+/// into a full queue allocates one more chunk and never moves existing
+/// items, so unlike with `VecDeque` or [`CircularBuffer`], there is no
+/// occasional large reallocation and copy. An emptied chunk is kept for
+/// reuse, so a queue oscillating around a chunk boundary does not allocate
+/// on every push; [`ChunkedFifo::reserve`] can keep more.
+///
+/// [`CircularBuffer`]: crate::CircularBuffer
+pub struct ChunkedFifo<T, const N: usize = DEFAULT_ITEMS_PER_CHUNK> {
+    front: Option<NonNull<Chunk<T, N>>>,
+    back: Option<NonNull<Chunk<T, N>>>,
+    free: Option<NonNull<Chunk<T, N>>>,
+    free_count: usize,
+    len: usize,
+}
+
+impl<T, const N: usize> ChunkedFifo<T, N> {
+    const ITEMS_PER_CHUNK_IS_POSITIVE: () = assert!(N > 0, "a chunk must hold at least one item");
+
+    /// Creates an empty queue, which does not allocate.
+    pub fn new() -> Self {
+        #[allow(clippy::let_unit_value)]
+        let _ = Self::ITEMS_PER_CHUNK_IS_POSITIVE;
+        Self {
+            front: None,
+            back: None,
+            free: None,
+            free_count: 0,
+            len: 0,
+        }
+    }
+
+    /// Returns the number of items.
+    pub fn len(&self) -> usize {
+        self.len
+    }
+
+    /// Returns whether the queue holds no items.
+    pub fn is_empty(&self) -> bool {
+        self.len == 0
+    }
+
+    fn take_free_chunk(&mut self) -> NonNull<Chunk<T, N>> {
+        match self.free {
+            Some(mut chunk) => {
+                // Safety: free chunks are owned by the queue and hold no items.
+                let chunk_ref = unsafe { chunk.as_mut() };
+                self.free = chunk_ref.next.take();
+                self.free_count -= 1;
+                chunk_ref.begin = 0;
+                chunk_ref.end = 0;
+                chunk
+            }
+            None => Chunk::allocate(),
+        }
+    }
+
+    fn release_chunk(&mut self, mut chunk: NonNull<Chunk<T, N>>) {
+        if self.free_count == 0 {
+            // Safety: the chunk is owned by the queue and holds no items.
+            unsafe { chunk.as_mut().next = None };
+            self.free = Some(chunk);
+            self.free_count = 1;
+        } else {
+            // Safety: as above, and nothing refers to the chunk anymore.
+            drop(unsafe { Box::from_raw(chunk.as_ptr()) });
+        }
+    }
+
+    /// Appends an item to the back.
+    pub fn push_back(&mut self, value: T) {
+        let back = match self.back {
+            // Safety: chunks in the list are owned by the queue.
+            Some(back) if unsafe { back.as_ref().end } < N => back,
+            _ => {
+                let chunk = self.take_free_chunk();
+                match self.back {
+                    // Safety: as above.
+                    Some(mut back) => unsafe { back.as_mut().next = Some(chunk) },
+                    None => self.front = Some(chunk),
+                }
+                self.back = Some(chunk);
+                chunk
+            }
+        };
+        // Safety: as above, and the slot at `end` is free.
+        unsafe {
+            let back = &mut *back.as_ptr();
+            back.items[back.end].write(value);
+            back.end += 1;
+        }
+        self.len += 1;
+    }
+
+    /// Removes and returns the first item.
+    pub fn pop_front(&mut self) -> Option<T> {
+        let front = self.front?;
+        // Safety: chunks in the list are owned by the queue and non-empty.
+        let (value, emptied) = unsafe {
+            let chunk = &mut *front.as_ptr();
+            let value = chunk.items[chunk.begin].assume_init_read();
+            chunk.begin += 1;
+            (value, chunk.begin == chunk.end)
+        };
+        self.len -= 1;
+        if emptied {
+            // Safety: as above.
+            self.front = unsafe { front.as_ref().next };
+            if self.front.is_none() {
+                self.back = None;
+            }
+            self.release_chunk(front);
+        }
+        Some(value)
+    }
+
+    /// Returns the first item.
+    pub fn front(&self) -> Option<&T> {
+        // Safety: chunks in the list are owned by the queue and non-empty.
+        self.front
+            .map(|chunk| unsafe { chunk.as_ref().items[chunk.as_ref().begin].assume_init_ref() })
+    }
+
+    /// Returns the first item.
+    pub fn front_mut(&mut self) -> Option<&mut T> {
+        // Safety: as above.
+        self.front.map(|chunk| unsafe {
+            let chunk = &mut *chunk.as_ptr();
+            chunk.items[chunk.begin].assume_init_mut()
+        })
+    }
+
+    /// Returns the last item.
+    pub fn back(&self) -> Option<&T> {
+        // Safety: as above.
+        self.back
+            .map(|chunk| unsafe { chunk.as_ref().items[chunk.as_ref().end - 1].assume_init_ref() })
+    }
+
+    /// Returns the last item.
+    pub fn back_mut(&mut self) -> Option<&mut T> {
+        // Safety: as above.
+        self.back.map(|chunk| unsafe {
+            let chunk = &mut *chunk.as_ptr();
+            chunk.items[chunk.end - 1].assume_init_mut()
+        })
+    }
+
+    /// Removes all items. One chunk is kept for reuse, like after popping.
+    pub fn clear(&mut self) {
+        while self.pop_front().is_some() {}
+    }
+
+    /// Allocates chunks in advance, so that at least `capacity` items can be
+    /// held in total without allocating. The chunks are kept until they are
+    /// used or until [`ChunkedFifo::shrink_to_fit`] is called.
+    pub fn reserve(&mut self, capacity: usize) {
+        // Room left in the back chunk.
+        let available = match self.back {
+            // Safety: chunks in the list are owned by the queue.
+            Some(back) => N - unsafe { back.as_ref().end },
+            None => 0,
+        };
+        let needed = capacity.saturating_sub(self.len + available);
+        let chunks = needed.div_ceil(N);
+        while self.free_count < chunks {
+            let mut chunk = Chunk::allocate();
+            // Safety: the chunk has just been allocated.
+            unsafe { chunk.as_mut().next = self.free };
+            self.free = Some(chunk);
+            self.free_count += 1;
+        }
+    }
+
+    /// Frees the chunks kept for reuse.
+    pub fn shrink_to_fit(&mut self) {
+        while let Some(chunk) = self.free {
+            // Safety: free chunks are owned by the queue and hold no items.
+            let chunk = unsafe { Box::from_raw(chunk.as_ptr()) };
+            self.free = chunk.next;
+        }
+        self.free_count = 0;
+    }
+
+    /// Iterates over the items from front to back.
+    pub fn iter(&self) -> Iter<'_, T, N> {
+        Iter {
+            chunk: self.front,
+            position: self.front.map_or(0, |chunk| {
+                // Safety: chunks in the list are owned by the queue.
+                unsafe { chunk.as_ref().begin }
+            }),
+            remaining: self.len,
+            _queue: self,
+        }
+    }
+}
+
+// Safety: the queue owns its chunks and items like a Vec would.
+unsafe impl<T: Send, const N: usize> Send for ChunkedFifo<T, N> {}
+unsafe impl<T: Sync, const N: usize> Sync for ChunkedFifo<T, N> {}
+
+impl<T, const N: usize> Drop for ChunkedFifo<T, N> {
+    fn drop(&mut self) {
+        self.clear();
+        self.shrink_to_fit();
+    }
+}
+
+impl<T, const N: usize> Default for ChunkedFifo<T, N> {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl<T: fmt::Debug, const N: usize> fmt::Debug for ChunkedFifo<T, N> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_list().entries(self.iter()).finish()
+    }
+}
+
+impl<T, const N: usize> Extend<T> for ChunkedFifo<T, N> {
+    fn extend<I: IntoIterator<Item = T>>(&mut self, iter: I) {
+        for value in iter {
+            self.push_back(value);
+        }
+    }
+}
+
+impl<T, const N: usize> FromIterator<T> for ChunkedFifo<T, N> {
+    fn from_iter<I: IntoIterator<Item = T>>(iter: I) -> Self {
+        let mut queue = Self::new();
+        queue.extend(iter);
+        queue
+    }
+}
+
+impl<'a, T, const N: usize> IntoIterator for &'a ChunkedFifo<T, N> {
+    type Item = &'a T;
+    type IntoIter = Iter<'a, T, N>;
+
+    fn into_iter(self) -> Iter<'a, T, N> {
+        self.iter()
+    }
+}
+
+/// An iterator over the items of a [`ChunkedFifo`].
+pub struct Iter<'a, T, const N: usize> {
+    chunk: Option<NonNull<Chunk<T, N>>>,
+    position: usize,
+    remaining: usize,
+    _queue: &'a ChunkedFifo<T, N>,
+}
+
+impl<'a, T, const N: usize> Iterator for Iter<'a, T, N> {
+    type Item = &'a T;
+
+    fn next(&mut self) -> Option<&'a T> {
+        if self.remaining == 0 {
+            return None;
+        }
+        // Safety: the queue is borrowed, so its chunks are alive, and there
+        // are items left, so the current chunk is in the list.
+        let chunk = unsafe { &*self.chunk?.as_ptr() };
+        let value = unsafe { chunk.items[self.position].assume_init_ref() };
+        self.position += 1;
+        self.remaining -= 1;
+        if self.position == chunk.end {
+            self.chunk = chunk.next;
+            // Chunks after the first one are filled from the start.
+            self.position = 0;
+        }
+        Some(value)
+    }
+
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        (self.remaining, Some(self.remaining))
+    }
+}
+
+impl<T, const N: usize> ExactSizeIterator for Iter<'_, T, N> {}
+
+#[test]
+fn test_chunked_fifo_is_fifo() {
+    let mut queue = ChunkedFifo::<_, 4>::new();
+    queue.extend(0..10);
+    assert_eq!(queue.len(), 10);
+    assert_eq!(queue.front(), Some(&0));
+    assert_eq!(queue.back(), Some(&9));
+    assert!(queue.iter().copied().eq(0..10));
+    for i in 0..10 {
+        assert_eq!(queue.pop_front(), Some(i));
+    }
+    assert_eq!(queue.pop_front(), None);
+    assert!(queue.is_empty());
+}
+
+#[test]
+fn test_chunked_fifo_does_not_move_items() {
+    let mut queue = ChunkedFifo::<_, 4>::new();
+    queue.push_back(0);
+    let first = queue.front().unwrap() as *const i32;
+    queue.extend(1..100);
+    assert_eq!(queue.front().unwrap() as *const i32, first);
+}
+
+#[test]
+fn test_chunked_fifo_reuses_chunks() {
+    let mut queue = ChunkedFifo::<_, 4>::new();
+    queue.extend(0..4);
+    // Crossing the chunk boundary back and forth reuses the spare chunk.
+    for i in 4..20 {
+        queue.push_back(i);
+        queue.pop_front();
+    }
+    assert_eq!(queue.free_count, 1);
+    queue.clear();
+    queue.reserve(10);
+    assert_eq!(queue.free_count, 3);
+    queue.shrink_to_fit();
+    assert_eq!(queue.free_count, 0);
+}
+
+#[test]
+fn test_chunked_fifo_drops_items() {
+    let value = std::rc::Rc::new(());
+    let mut queue: ChunkedFifo<_, 4> = (0..10).map(|_| value.clone()).collect();
+    queue.pop_front();
+    assert_eq!(std::rc::Rc::strong_count(&value), 10);
+    drop(queue);
+    assert_eq!(std::rc::Rc::strong_count(&value), 1);
+}
@@ -0,0 +1,367 @@
+//! A double-ended queue, `seastar::circular_buffer`.
+
+use std::fmt;
+use std::mem::MaybeUninit;
+use std::ops::{Index, IndexMut};
+
+/// A double-ended queue stored in a single ring buffer, with the allocation
+/// behaviour of `seastar::circular_buffer`.
+///
+/// The capacity is always a power of two, so that positions are wrapped
+/// with a mask, and doubles when the buffer is full. The buffer never
+/// shrinks on its own. Positions of the first and the one-past-last item
+/// are kept unwrapped, so a full buffer is distinguished from an empty one
+/// without a separate length.
+pub struct CircularBuffer<T> {
+    storage: Box<[MaybeUninit<T>]>,
+    begin: usize,
+    end: usize,
+}
+
+impl<T> CircularBuffer<T> {
+    /// Creates an empty buffer, which does not allocate.
+    pub fn new() -> Self {
+        Self {
+            storage: Box::new([]),
+            begin: 0,
+            end: 0,
+        }
+    }
+
+    /// Creates an empty buffer with room for at least `capacity` items.
+    pub fn with_capacity(capacity: usize) -> Self {
+        let mut buffer = Self::new();
+        buffer.reserve(capacity);
+        buffer
+    }
+
+    fn mask(&self, position: usize) -> usize {
+        position & (self.storage.len().wrapping_sub(1))
+    }
+
+    /// Returns the number of items.
+    pub fn len(&self) -> usize {
+        self.end.wrapping_sub(self.begin)
+    }
+
+    /// Returns whether the buffer holds no items.
+    pub fn is_empty(&self) -> bool {
+        self.begin == self.end
+    }
+
+    /// Returns the number of items the buffer can hold without growing.
+    pub fn capacity(&self) -> usize {
+        self.storage.len()
+    }
+
+    /// Makes room for at least `capacity` items in total.
+    pub fn reserve(&mut self, capacity: usize) {
+        if capacity > self.capacity() {
+            self.grow(capacity.next_power_of_two());
+        }
+    }
+
+    fn grow(&mut self, new_capacity: usize) {
+        let mut storage = Box::new_uninit_slice(new_capacity);
+        let len = self.len();
+        for (i, slot) in storage.iter_mut().take(len).enumerate() {
+            let from = self.mask(self.begin.wrapping_add(i));
+            // Safety: the slot holds a live item, which is moved out of the
+            // old storage exactly once.
+            slot.write(unsafe { self.storage[from].assume_init_read() });
+        }
+        self.storage = storage;
+        self.begin = 0;
+        self.end = len;
+    }
+
+    fn grow_if_full(&mut self) {
+        if self.len() == self.capacity() {
+            self.grow(std::cmp::max(self.capacity() * 2, 1));
+        }
+    }
+
+    /// Appends an item to the back.
+    pub fn push_back(&mut self, value: T) {
+        self.grow_if_full();
+        let slot = self.mask(self.end);
+        self.storage[slot].write(value);
+        self.end = self.end.wrapping_add(1);
+    }
+
+    /// Prepends an item to the front.
+    pub fn push_front(&mut self, value: T) {
+        self.grow_if_full();
+        self.begin = self.begin.wrapping_sub(1);
+        let slot = self.mask(self.begin);
+        self.storage[slot].write(value);
+    }
+
+    /// Removes and returns the first item.
+    pub fn pop_front(&mut self) -> Option<T> {
+        if self.is_empty() {
+            return None;
+        }
+        let slot = self.mask(self.begin);
+        self.begin = self.begin.wrapping_add(1);
+        // Safety: the slot held the first item, which is no longer tracked.
+        Some(unsafe { self.storage[slot].assume_init_read() })
+    }
+
+    /// Removes and returns the last item.
+    pub fn pop_back(&mut self) -> Option<T> {
+        if self.is_empty() {
+            return None;
+        }
+        self.end = self.end.wrapping_sub(1);
+        let slot = self.mask(self.end);
+        // Safety: the slot held the last item, which is no longer tracked.
+        Some(unsafe { self.storage[slot].assume_init_read() })
+    }
+
+    /// Returns the item at `index`, counting from the front.
+    pub fn get(&self, index: usize) -> Option<&T> {
+        if index >= self.len() {
+            return None;
+        }
+        let slot = self.mask(self.begin.wrapping_add(index));
+        // Safety: slots between begin and end hold live items.
+        Some(unsafe { self.storage[slot].assume_init_ref() })
+    }
+
+    /// Returns the item at `index`, counting from the front.
+    pub fn get_mut(&mut self, index: usize) -> Option<&mut T> {
+        if index >= self.len() {
+            return None;
+        }
+        let slot = self.mask(self.begin.wrapping_add(index));
+        // Safety: slots between begin and end hold live items.
+        Some(unsafe { self.storage[slot].assume_init_mut() })
+    }
+
+    /// Returns the first item.
+    pub fn front(&self) -> Option<&T> {
+        self.get(0)
+    }
+
+    /// Returns the first item.
+    pub fn front_mut(&mut self) -> Option<&mut T> {
+        self.get_mut(0)
+    }
+
+    /// Returns the last item.
+    pub fn back(&self) -> Option<&T> {
+        self.get(self.len().wrapping_sub(1))
+    }
+
+    /// Returns the last item.
+    pub fn back_mut(&mut self) -> Option<&mut T> {
+        self.get_mut(self.len().wrapping_sub(1))
+    }
+
+    /// Removes all items, keeping the capacity.
+    pub fn clear(&mut self) {
+        while self.pop_front().is_some() {}
+    }
+
+    /// Iterates over the items from front to back.
+    pub fn iter(&self) -> Iter<'_, T> {
+        Iter {
+            buffer: self,
+            front: 0,
+            back: self.len(),
+        }
+    }
+}
+
+impl<T> Drop for CircularBuffer<T> {
+    fn drop(&mut self) {
+        self.clear();
+    }
+}
+
+impl<T> Default for CircularBuffer<T> {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl<T: Clone> Clone for CircularBuffer<T> {
+    fn clone(&self) -> Self {
+        let mut buffer = Self::with_capacity(self.len());
+        buffer.extend(self.iter().cloned());
+        buffer
+    }
+}
+
+impl<T: fmt::Debug> fmt::Debug for CircularBuffer<T> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_list().entries(self.iter()).finish()
+    }
+}
+
+impl<T: PartialEq> PartialEq for CircularBuffer<T> {
+    fn eq(&self, other: &Self) -> bool {
+        self.len() == other.len() && self.iter().eq(other.iter())
+    }
+}
+
+impl<T: Eq> Eq for CircularBuffer<T> {}
+
+impl<T> Index<usize> for CircularBuffer<T> {
+    type Output = T;
+
+    fn index(&self, index: usize) -> &T {
+        self.get(index).expect("index out of bounds")
+    }
+}
+
+impl<T> IndexMut<usize> for CircularBuffer<T> {
+    fn index_mut(&mut self, index: usize) -> &mut T {
+        self.get_mut(index).expect("index out of bounds")
+    }
+}
+
+impl<T> Extend<T> for CircularBuffer<T> {
+    fn extend<I: IntoIterator<Item = T>>(&mut self, iter: I) {
+        let iter = iter.into_iter();
+        self.reserve(self.len() + iter.size_hint().0);
+        for value in iter {
+            self.push_back(value);
+        }
+    }
+}
+
+impl<T> FromIterator<T> for CircularBuffer<T> {
+    fn from_iter<I: IntoIterator<Item = T>>(iter: I) -> Self {
+        let mut buffer = Self::new();
+        buffer.extend(iter);
+        buffer
+    }
+}
+
+impl<'a, T> IntoIterator for &'a CircularBuffer<T> {
+    type Item = &'a T;
+    type IntoIter = Iter<'a, T>;
+
+    fn into_iter(self) -> Iter<'a, T> {
+        self.iter()
+    }
+}
+
+impl<T> IntoIterator for CircularBuffer<T> {
+    type Item = T;
+    type IntoIter = IntoIter<T>;
+
+    fn into_iter(self) -> IntoIter<T> {
+        IntoIter(self)
+    }
+}
+
+/// An iterator over the items of a [`CircularBuffer`].
+pub struct Iter<'a, T> {
+    buffer: &'a CircularBuffer<T>,
+    front: usize,
+    back: usize,
+}
+
+impl<'a, T> Iterator for Iter<'a, T> {
+    type Item = &'a T;
+
+    fn next(&mut self) -> Option<&'a T> {
+        if self.front == self.back {
+            return None;
+        }
+        self.front += 1;
+        self.buffer.get(self.front - 1)
+    }
+
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        let len = self.back - self.front;
+        (len, Some(len))
+    }
+}
+
+impl<T> DoubleEndedIterator for Iter<'_, T> {
+    fn next_back(&mut self) -> Option<Self::Item> {
+        if self.front == self.back {
+            return None;
+        }
+        self.back -= 1;
+        self.buffer.get(self.back)
+    }
+}
+
+impl<T> ExactSizeIterator for Iter<'_, T> {}
+
+/// An iterator which moves the items out of a [`CircularBuffer`].
+pub struct IntoIter<T>(CircularBuffer<T>);
+
+impl<T> Iterator for IntoIter<T> {
+    type Item = T;
+
+    fn next(&mut self) -> Option<T> {
+        self.0.pop_front()
+    }
+
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        (self.0.len(), Some(self.0.len()))
+    }
+}
+
+impl<T> DoubleEndedIterator for IntoIter<T> {
+    fn next_back(&mut self) -> Option<T> {
+        self.0.pop_back()
+    }
+}
+
+impl<T> ExactSizeIterator for IntoIter<T> {}
+
+#[test]
+fn test_circular_buffer_grows_in_powers_of_two() {
+    let mut buffer = CircularBuffer::new();
+    assert_eq!(buffer.capacity(), 0);
+    for i in 0..5 {
+        buffer.push_back(i);
+    }
+    assert_eq!(buffer.capacity(), 8);
+    assert_eq!(CircularBuffer::<u8>::with_capacity(100).capacity(), 128);
+}
+
+#[test]
+fn test_circular_buffer_wraps_around() {
+    let mut buffer = CircularBuffer::with_capacity(4);
+    for round in 0..10 {
+        buffer.push_back(round);
+        buffer.push_back(round + 100);
+        buffer.push_front(round + 200);
+        assert_eq!(buffer.pop_front(), Some(round + 200));
+        assert_eq!(buffer.pop_back(), Some(round + 100));
+        assert_eq!(buffer.pop_front(), Some(round));
+    }
+    assert!(buffer.is_empty());
+    assert_eq!(buffer.capacity(), 4);
+}
+
+#[test]
+fn test_circular_buffer_keeps_order_when_growing() {
+    let mut buffer = CircularBuffer::new();
+    buffer.extend(0..3);
+    buffer.pop_front();
+    buffer.extend(3..20);
+    buffer.push_front(0);
+    buffer[1] = 1;
+    assert!(buffer.iter().copied().eq(0..20));
+    assert!(buffer.iter().rev().copied().eq((0..20).rev()));
+    assert!(buffer.into_iter().eq(0..20));
+}
+
+#[test]
+fn test_circular_buffer_drops_items() {
+    let value = std::rc::Rc::new(());
+    let mut buffer: CircularBuffer<_> = (0..10).map(|_| value.clone()).collect();
+    buffer.pop_front();
+    assert_eq!(std::rc::Rc::strong_count(&value), 10);
+    drop(buffer);
+    assert_eq!(std::rc::Rc::strong_count(&value), 1);
+}
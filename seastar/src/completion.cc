@@ -0,0 +1,65 @@
+#include "seastar/src/completion.hh"
+#include "seastar/src/completion.rs.h"
+
+#include <system_error>
+#include <type_traits>
+
+namespace seastar_rs {
+
+static_assert(std::is_trivially_copyable_v<completion> && sizeof(completion) == sizeof(void*),
+        "the layout of Completion in completion.rs must match seastar_rs::completion");
+
+static void fail(completion c, std::exception_ptr ex) noexcept {
+    try {
+        std::rethrow_exception(std::move(ex));
+    } catch (const std::system_error& e) {
+        // seastar reports failed syscalls with their errno.
+        bool is_errno = e.code().category() == std::system_category();
+        complete_with_error(c, is_errno ? e.code().value() : 0, e.what());
+    } catch (const std::exception& e) {
+        complete_with_error(c, 0, e.what());
+    } catch (...) {
+        complete_with_error(c, 0, "unknown exception");
+    }
+}
+
+template <typename T, typename Resolve>
+static void complete(completion c, seastar::future<T> f, Resolve resolve) noexcept {
+    if (f.available()) {
+        // Spare the continuation when the operation did not have to wait.
+        if (f.failed()) {
+            fail(c, f.get_exception());
+        } else {
+            resolve(c, std::move(f));
+        }
+        return;
+    }
+    (void)f.then_wrapped([c, resolve = std::move(resolve)] (seastar::future<T> f) {
+        if (f.failed()) {
+            fail(c, f.get_exception());
+        } else {
+            resolve(c, std::move(f));
+        }
+    });
+}
+
+void complete_void(completion c, seastar::future<> f) noexcept {
+    complete(c, std::move(f), [] (completion c, seastar::future<> f) {
+        f.get();
+        complete_with_unit(c);
+    });
+}
+
+void complete_u64(completion c, seastar::future<uint64_t> f) noexcept {
+    complete(c, std::move(f), [] (completion c, seastar::future<uint64_t> f) {
+        complete_with_u64(c, f.get());
+    });
+}
+
+void complete_buffer(completion c, seastar::future<temporary_buffer> f) noexcept {
+    complete(c, std::move(f), [] (completion c, seastar::future<temporary_buffer> f) {
+        complete_with_buffer(c, f.get());
+    });
+}
+
+}
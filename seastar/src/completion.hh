@@ -0,0 +1,23 @@
+#pragma once
+
+#include "seastar/src/temporary_buffer.hh"
+
+#include <seastar/core/future.hh>
+
+#include <cstdint>
+
+namespace seastar_rs {
+
+// The Rust end of an operation, see completion.rs. It is a plain pointer
+// which is handed back to Rust exactly once, when the operation resolves.
+struct completion {
+    const void* state;
+};
+
+// Resolve the completion with the outcome of the future, once it is
+// available. Exceptions are passed to Rust as std::io::Error.
+void complete_void(completion c, seastar::future<> f) noexcept;
+void complete_u64(completion c, seastar::future<uint64_t> f) noexcept;
+void complete_buffer(completion c, seastar::future<temporary_buffer> f) noexcept;
+
+}
@@ -0,0 +1,218 @@
+//! Resolving Rust futures with the outcome of Seastar futures.
+//!
+//! An operation which returns a `seastar::future` is started by a bridged
+//! function that takes a [`Completion`]. The C++ side attaches a
+//! continuation to the future (see completion.hh), which hands the
+//! completion back to one of the functions below together with the value
+//! or the exception. The matching [`Pending`] future then wakes up its task.
+
+use crate::TemporaryBuffer;
+use std::any::Any;
+use std::cell::RefCell;
+use std::future::Future;
+use std::io;
+use std::pin::Pin;
+use std::rc::Rc;
+use std::task::{Context, Poll, Waker};
+
+#[cxx::bridge(namespace = "seastar_rs")]
+mod ffi {
+    extern "Rust" {
+        fn complete_with_unit(c: Completion);
+        fn complete_with_u64(c: Completion, value: u64);
+        fn complete_with_buffer(c: Completion, buf: TemporaryBuffer);
+        fn complete_with_error(c: Completion, errno: i32, message: &str);
+    }
+
+    unsafe extern "C++" {
+        include!("seastar/src/completion.hh");
+
+        #[cxx_name = "completion"]
+        type Completion = crate::completion::Completion;
+        #[cxx_name = "temporary_buffer"]
+        type TemporaryBuffer = crate::TemporaryBuffer;
+    }
+}
+
+/// The value of a completed operation.
+pub(crate) enum Completed {
+    Unit,
+    U64(u64),
+    Buffer(TemporaryBuffer),
+}
+
+impl Completed {
+    pub(crate) fn into_u64(self) -> u64 {
+        match self {
+            Completed::U64(value) => value,
+            _ => panic!("the operation completed with a value of another type"),
+        }
+    }
+
+    pub(crate) fn into_buffer(self) -> TemporaryBuffer {
+        match self {
+            Completed::Buffer(buf) => buf,
+            _ => panic!("the operation completed with a value of another type"),
+        }
+    }
+}
+
+#[derive(Default)]
+struct State {
+    result: Option<io::Result<Completed>>,
+    waker: Option<Waker>,
+    // Whatever the C++ side uses until it completes, see Pending::keeping.
+    kept: Option<Box<dyn Any>>,
+}
+
+/// The C++ end of an operation, a counted reference to its state.
+///
+/// It is passed to C++ by value and has to be passed back exactly once,
+/// which the helpers in completion.hh take care of.
+#[repr(C)]
+pub(crate) struct Completion {
+    state: *const RefCell<State>,
+}
+
+// Safety: the type is a plain pointer on both sides and the layouts are
+// checked to match in completion.cc.
+unsafe impl cxx::ExternType for Completion {
+    type Id = cxx::type_id!("seastar_rs::completion");
+    type Kind = cxx::kind::Trivial;
+}
+
+/// Creates a completion for an operation and the future of its result.
+pub(crate) fn completion() -> (Completion, Pending) {
+    let state = Rc::new(RefCell::new(State::default()));
+    let completion = Completion {
+        state: Rc::into_raw(state.clone()),
+    };
+    (completion, Pending { state })
+}
+
+fn resolve(c: Completion, result: io::Result<Completed>) {
+    // Safety: the pointer was created by Rc::into_raw in completion() and
+    // the C++ side passes each completion back only once, on the shard
+    // which created it.
+    let state = unsafe { Rc::from_raw(c.state) };
+    let (waker, kept) = {
+        let mut state = state.borrow_mut();
+        state.result = Some(result);
+        (state.waker.take(), state.kept.take())
+    };
+    drop(kept);
+    if let Some(waker) = waker {
+        waker.wake();
+    }
+}
+
+fn complete_with_unit(c: Completion) {
+    resolve(c, Ok(Completed::Unit));
+}
+
+fn complete_with_u64(c: Completion, value: u64) {
+    resolve(c, Ok(Completed::U64(value)));
+}
+
+fn complete_with_buffer(c: Completion, buf: TemporaryBuffer) {
+    resolve(c, Ok(Completed::Buffer(buf)));
+}
+
+fn complete_with_error(c: Completion, errno: i32, message: &str) {
+    let error = if errno != 0 {
+        io::Error::from_raw_os_error(errno)
+    } else {
+        io::Error::other(message.to_owned())
+    };
+    resolve(c, Err(error));
+}
+
+/// The result of an operation, available once its completion is resolved.
+///
+/// Dropping it does not cancel the operation, which keeps running in the
+/// background.
+pub(crate) struct Pending {
+    state: Rc<RefCell<State>>,
+}
+
+impl Pending {
+    /// Keeps `value` alive until the operation completes, even if the
+    /// future is dropped, and returns it together with the result.
+    ///
+    /// Used for objects which the C++ side writes to or reads from.
+    pub(crate) fn keeping<T: 'static>(self, value: T) -> Keeping<T> {
+        Keeping {
+            pending: self,
+            value: Some(value),
+        }
+    }
+}
+
+impl Future for Pending {
+    type Output = io::Result<Completed>;
+
+    fn poll(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Self::Output> {
+        let mut state = self.state.borrow_mut();
+        match state.result.take() {
+            Some(result) => Poll::Ready(result),
+            None => {
+                state.waker = Some(cx.waker().clone());
+                Poll::Pending
+            }
+        }
+    }
+}
+
+/// A [`Pending`] result which keeps an object alive, see
+/// [`Pending::keeping`].
+pub(crate) struct Keeping<T: 'static> {
+    pending: Pending,
+    value: Option<T>,
+}
+
+// The value is never pinned.
+impl<T> Unpin for Keeping<T> {}
+
+impl<T> Future for Keeping<T> {
+    type Output = (io::Result<Completed>, T);
+
+    fn poll(mut self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Self::Output> {
+        let result = std::task::ready!(Pin::new(&mut self.pending).poll(cx));
+        let value = self.value.take().expect("polled after completion");
+        Poll::Ready((result, value))
+    }
+}
+
+impl<T> Drop for Keeping<T> {
+    fn drop(&mut self) {
+        if let Some(value) = self.value.take() {
+            let mut state = self.pending.state.borrow_mut();
+            if state.result.is_none() {
+                state.kept = Some(Box::new(value));
+            }
+        }
+    }
+}
+
+#[test]
+fn test_completion_wakes_pending() {
+    let (c, mut pending) = completion();
+    let waker = futures::task::noop_waker();
+    let mut cx = Context::from_waker(&waker);
+    assert!(Pin::new(&mut pending).poll(&mut cx).is_pending());
+    complete_with_u64(c, 42);
+    match Pin::new(&mut pending).poll(&mut cx) {
+        Poll::Ready(Ok(completed)) => assert_eq!(completed.into_u64(), 42),
+        _ => panic!("the operation should have completed"),
+    }
+}
+
+#[test]
+fn test_completion_keeps_value_alive() {
+    let value = Rc::new(());
+    let (c, pending) = completion();
+    drop(pending.keeping(value.clone()));
+    assert_eq!(Rc::strong_count(&value), 2);
+    complete_with_error(c, 2, "");
+    assert_eq!(Rc::strong_count(&value), 1);
+}
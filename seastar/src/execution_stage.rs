@@ -0,0 +1,313 @@
+//! Execution stages, `seastar::inheriting_concurrent_execution_stage`.
+
+use crate::executor::TaskResult;
+use crate::{need_preempt, spawn, yield_now, ChunkedFifo, SchedulingGroup};
+use std::cell::{Cell, RefCell};
+use std::future::Future;
+use std::mem;
+use std::panic::{self, AssertUnwindSafe};
+use std::pin::Pin;
+use std::rc::Rc;
+use std::task::{Context, Poll, Waker};
+
+/// Statistics of an execution stage in one scheduling group, the same
+/// as those which seastar exports for its stages.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct ExecutionStageStats {
+    /// Tasks started to run a batch of calls.
+    pub tasks_scheduled: u64,
+    /// Times a batch was interrupted because the task had to yield.
+    pub tasks_preempted: u64,
+    /// Calls queued in the stage.
+    pub function_calls_enqueued: u64,
+    /// Calls run by the stage.
+    pub function_calls_executed: u64,
+}
+
+enum CallState<Args, Fut: Future> {
+    Queued(Args),
+    Running(Fut),
+    Done(TaskResult<Fut::Output>),
+    Taken,
+}
+
+/// A queued call, shared by the stage and the caller's future. The future
+/// returned by the function is kept in it and polled in place: first by
+/// the stage, then by the caller's task.
+struct CallSlot<Args, Fut: Future> {
+    state: RefCell<CallState<Args, Fut>>,
+    // The caller's waker, until the function's future has one.
+    waker: Cell<Option<Waker>>,
+}
+
+impl<Args, Fut: Future> CallSlot<Args, Fut> {
+    /// Polls the function's future if it is running, keeping its output or
+    /// its panic.
+    fn poll_running(&self, cx: &mut Context<'_>) {
+        let mut state = self.state.borrow_mut();
+        let CallState::Running(future) = &mut *state else {
+            return;
+        };
+        // Safety: the slot is kept in an Rc, so the future never moves, and
+        // it is dropped in place when the state is overwritten.
+        let future = unsafe { Pin::new_unchecked(future) };
+        match panic::catch_unwind(AssertUnwindSafe(|| future.poll(cx))) {
+            Ok(Poll::Pending) => {}
+            Ok(Poll::Ready(output)) => *state = CallState::Done(Ok(output)),
+            Err(payload) => *state = CallState::Done(Err(payload)),
+        }
+    }
+}
+
+struct GroupQueue<Args, Fut: Future> {
+    calls: ChunkedFifo<Rc<CallSlot<Args, Fut>>>,
+    flush_scheduled: bool,
+    stats: ExecutionStageStats,
+}
+
+struct Stage<F, Args, Fut: Future> {
+    name: String,
+    function: F,
+    // Indexed by scheduling group.
+    queues: RefCell<Vec<GroupQueue<Args, Fut>>>,
+}
+
+/// Batches calls of a function, so that it runs over many queued calls in
+/// a row while its code and data are hot in the CPU caches.
+///
+/// Calling the stage queues the call and returns a future of its result.
+/// Queued calls are run by a task of the stage, until the queue is empty or
+/// the task has to yield. Like `inheriting_concurrent_execution_stage`, the
+/// stage keeps a separate queue and task for each scheduling group, so calls
+/// run in the scheduling group of their caller.
+///
+/// The function is called and its future polled once inside the batch; if
+/// the future does not complete right away, the caller's task finishes it.
+/// Dropping the caller's future cancels the call: if the function has not
+/// been called yet, it is not called at all, and otherwise its future is
+/// dropped.
+///
+/// A stage belongs to a single shard and is cheap to clone; it is usually
+/// kept in a `thread_local!`.
+pub struct ExecutionStage<F, Args, Fut: Future> {
+    stage: Rc<Stage<F, Args, Fut>>,
+}
+
+impl<F, Args, Fut: Future> Clone for ExecutionStage<F, Args, Fut> {
+    fn clone(&self) -> Self {
+        Self {
+            stage: self.stage.clone(),
+        }
+    }
+}
+
+impl<F, Fut, Args> ExecutionStage<F, Args, Fut>
+where
+    F: Fn(Args) -> Fut + 'static,
+    Fut: Future + 'static,
+    Args: 'static,
+    Fut::Output: 'static,
+{
+    /// Creates a stage which runs `function`, `seastar::make_execution_stage`.
+    pub fn new(name: impl Into<String>, function: F) -> Self {
+        let queues = (0..crate::build_config::SCHEDULING_GROUPS_COUNT)
+            .map(|_| GroupQueue {
+                calls: ChunkedFifo::new(),
+                flush_scheduled: false,
+                stats: ExecutionStageStats::default(),
+            })
+            .collect();
+        Self {
+            stage: Rc::new(Stage {
+                name: name.into(),
+                function,
+                queues: RefCell::new(queues),
+            }),
+        }
+    }
+
+    /// Returns the name of the stage.
+    pub fn name(&self) -> &str {
+        &self.stage.name
+    }
+
+    /// Returns the statistics of the stage in the given scheduling group.
+    pub fn stats(&self, group: SchedulingGroup) -> ExecutionStageStats {
+        self.stage.queues.borrow()[group.index()].stats
+    }
+
+    /// Queues a call of the function and returns a future of its result.
+    ///
+    /// If the function panics, the panic is resumed in the task which awaits
+    /// the returned future.
+    pub fn call(&self, args: Args) -> impl Future<Output = Fut::Output> + 'static {
+        let group = SchedulingGroup::current().index();
+        let slot = Rc::new(CallSlot {
+            state: RefCell::new(CallState::Queued(args)),
+            waker: Cell::new(None),
+        });
+        let schedule = {
+            let mut queues = self.stage.queues.borrow_mut();
+            let queue = &mut queues[group];
+            queue.calls.push_back(slot.clone());
+            queue.stats.function_calls_enqueued += 1;
+            let schedule = !queue.flush_scheduled;
+            if schedule {
+                queue.flush_scheduled = true;
+                queue.stats.tasks_scheduled += 1;
+            }
+            schedule
+        };
+        if schedule {
+            // Tasks inherit the scheduling group of their creator.
+            spawn(flush(self.stage.clone(), group));
+        }
+        CallFuture { slot }
+    }
+}
+
+/// The caller's side of a queued call.
+struct CallFuture<Args, Fut: Future> {
+    slot: Rc<CallSlot<Args, Fut>>,
+}
+
+impl<Args, Fut: Future> Future for CallFuture<Args, Fut> {
+    type Output = Fut::Output;
+
+    fn poll(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Fut::Output> {
+        let slot = &self.slot;
+        slot.poll_running(cx);
+        let mut state = slot.state.borrow_mut();
+        match &*state {
+            CallState::Queued(_) => {
+                // The stage polls the function's future with this waker.
+                slot.waker.set(Some(cx.waker().clone()));
+                Poll::Pending
+            }
+            CallState::Running(_) => Poll::Pending,
+            CallState::Done(_) => match mem::replace(&mut *state, CallState::Taken) {
+                CallState::Done(Ok(output)) => Poll::Ready(output),
+                CallState::Done(Err(payload)) => panic::resume_unwind(payload),
+                _ => unreachable!(),
+            },
+            CallState::Taken => panic!("the call was polled after it completed"),
+        }
+    }
+}
+
+impl<F, Fut, Args> Stage<F, Args, Fut>
+where
+    F: Fn(Args) -> Fut + 'static,
+    Fut: Future + 'static,
+{
+    /// Takes the next call to run, skipping the calls whose callers are
+    /// gone.
+    fn pop(&self, group: usize) -> Option<Rc<CallSlot<Args, Fut>>> {
+        let mut queues = self.queues.borrow_mut();
+        let queue = &mut queues[group];
+        loop {
+            let call = queue.calls.pop_front()?;
+            if Rc::strong_count(&call) > 1 {
+                queue.stats.function_calls_executed += 1;
+                return Some(call);
+            }
+        }
+    }
+
+    fn run(&self, slot: &CallSlot<Args, Fut>) {
+        {
+            let mut state = slot.state.borrow_mut();
+            let CallState::Queued(args) = mem::replace(&mut *state, CallState::Taken) else {
+                unreachable!("a call was run twice");
+            };
+            *state = match panic::catch_unwind(AssertUnwindSafe(|| (self.function)(args))) {
+                Ok(future) => CallState::Running(future),
+                Err(payload) => CallState::Done(Err(payload)),
+            };
+        }
+        // If the caller has not been polled yet, it polls the future itself
+        // when it is; otherwise the future wakes it when it can make progress.
+        let waker = slot.waker.take();
+        let noop = futures::task::noop_waker_ref();
+        let mut cx = Context::from_waker(waker.as_ref().unwrap_or(noop));
+        slot.poll_running(&mut cx);
+        if let (CallState::Done(_), Some(waker)) = (&*slot.state.borrow(), waker) {
+            waker.wake();
+        }
+    }
+}
+
+/// Runs the calls queued in a scheduling group until there are none left.
+async fn flush<F, Fut, Args>(stage: Rc<Stage<F, Args, Fut>>, group: usize)
+where
+    F: Fn(Args) -> Fut + 'static,
+    Fut: Future + 'static,
+{
+    loop {
+        while let Some(call) = stage.pop(group) {
+            stage.run(&call);
+            if need_preempt() {
+                break;
+            }
+        }
+        {
+            let mut queues = stage.queues.borrow_mut();
+            let queue = &mut queues[group];
+            if queue.calls.is_empty() {
+                queue.flush_scheduled = false;
+                return;
+            }
+            queue.stats.tasks_preempted += 1;
+        }
+        yield_now().await;
+    }
+}
+
+#[seastar::test]
+async fn test_execution_stage_batches_calls() {
+    let stage = ExecutionStage::new("double", |x: u32| async move { x * 2 });
+    let calls: Vec<_> = (0..10).map(|i| stage.call(i)).collect();
+    let results = futures::future::join_all(calls).await;
+    assert_eq!(results, (0..10).map(|i| i * 2).collect::<Vec<_>>());
+
+    let stats = stage.stats(SchedulingGroup::current());
+    assert_eq!(stats.function_calls_enqueued, 10);
+    assert_eq!(stats.function_calls_executed, 10);
+    assert_eq!(stats.tasks_scheduled, 1);
+}
+
+#[seastar::test]
+async fn test_execution_stage_finishes_pending_calls() {
+    let stage = ExecutionStage::new("yield", |x: u32| async move {
+        yield_now().await;
+        x + 1
+    });
+    assert_eq!(stage.call(1).await, 2);
+}
+
+#[seastar::test]
+#[should_panic(expected = "boom")]
+async fn test_execution_stage_propagates_panic() {
+    let stage = ExecutionStage::new("panic", |_: ()| async { panic!("boom") });
+    stage.call(()).await
+}
+
+#[seastar::test]
+async fn test_execution_stage_skips_cancelled_calls() {
+    let called = Rc::new(Cell::new(0));
+    let stage = ExecutionStage::new("count", {
+        let called = called.clone();
+        move |x: u32| {
+            called.set(called.get() + 1);
+            async move { x }
+        }
+    });
+    // Both calls are queued before the stage's task runs.
+    drop(stage.call(1));
+    assert_eq!(stage.call(2).await, 2);
+    assert_eq!(called.get(), 1);
+
+    let stats = stage.stats(SchedulingGroup::current());
+    assert_eq!(stats.function_calls_enqueued, 2);
+    assert_eq!(stats.function_calls_executed, 1);
+}
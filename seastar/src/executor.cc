@@ -0,0 +1,41 @@
+#include "seastar/src/executor.hh"
+#include "seastar/src/executor.rs.h"
+
+#include <stdexcept>
+#include <string>
+
+namespace seastar_rs {
+
+rust_task::rust_task(const TaskCore* core) noexcept
+        : _core(core) {
+}
+
+void rust_task::run_and_dispose() noexcept {
+    run_task(_core);
+}
+
+seastar::task* rust_task::waiting_task() noexcept {
+    return nullptr;
+}
+
+std::unique_ptr<rust_task> make_rust_task(const TaskCore* core) {
+    return std::make_unique<rust_task>(core);
+}
+
+void schedule_rust_task(rust_task& task) {
+    seastar::schedule(&task);
+}
+
+void_promise::void_promise(seastar::promise<> pr) noexcept
+        : _pr(std::move(pr)) {
+}
+
+void void_promise::set_value() {
+    _pr.set_value();
+}
+
+void void_promise::set_exception(rust::Str message) {
+    _pr.set_exception(std::runtime_error(std::string(message)));
+}
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "rust/cxx.h"
+
+#include <seastar/core/future.hh>
+#include <seastar/core/task.hh>
+
+#include <memory>
+
+namespace seastar_rs {
+
+struct TaskCore;
+
+// A seastar task which polls a Rust future each time the reactor runs it.
+//
+// The task is owned by its Rust counterpart (TaskCore), which keeps itself
+// alive while the task sits in the reactor's queue, so run_and_dispose()
+// never destroys the task.
+class rust_task final : public seastar::task {
+    const TaskCore* _core;
+public:
+    explicit rust_task(const TaskCore* core) noexcept;
+    virtual void run_and_dispose() noexcept override;
+    virtual seastar::task* waiting_task() noexcept override;
+};
+
+std::unique_ptr<rust_task> make_rust_task(const TaskCore* core);
+void schedule_rust_task(rust_task& task);
+
+// Lets a Rust task resolve a seastar::future<> returned to C++ code.
+class void_promise {
+    seastar::promise<> _pr;
+public:
+    explicit void_promise(seastar::promise<> pr) noexcept;
+    void set_value();
+    void set_exception(rust::Str message);
+};
+
+}
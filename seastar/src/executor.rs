@@ -0,0 +1,316 @@
+use crate::task_stats::TaskTypeStats;
+use futures::FutureExt;
+use std::any::Any;
+use std::cell::{Cell, RefCell};
+use std::future::Future;
+use std::mem::ManuallyDrop;
+use std::panic::{self, AssertUnwindSafe};
+use std::pin::Pin;
+use std::rc::Rc;
+use std::task::{Context, Poll, RawWaker, RawWakerVTable, Waker};
+use std::time::Instant;
+
+#[cxx::bridge(namespace = "seastar_rs")]
+mod ffi {
+    extern "Rust" {
+        type TaskCore;
+
+        unsafe fn run_task(core: *const TaskCore);
+    }
+
+    unsafe extern "C++" {
+        include!("seastar/src/executor.hh");
+
+        #[cxx_name = "rust_task"]
+        type RustTask;
+
+        #[cxx_name = "void_promise"]
+        type VoidPromise;
+
+        unsafe fn make_rust_task(core: *const TaskCore) -> UniquePtr<RustTask>;
+        fn schedule_rust_task(task: Pin<&mut RustTask>);
+
+        fn set_value(self: Pin<&mut VoidPromise>);
+        fn set_exception(self: Pin<&mut VoidPromise>, message: &str);
+    }
+}
+
+pub(crate) use ffi::VoidPromise;
+
+thread_local! {
+    static THREAD_MARKER: u8 = const { 0 };
+}
+
+/// Returns a value which uniquely identifies the current thread (and thus
+/// the current shard) for as long as the thread lives.
+fn current_thread_marker() -> usize {
+    THREAD_MARKER.with(|marker| marker as *const u8 as usize)
+}
+
+/// The Rust half of a task. The C++ half is a `seastar::task` which calls
+/// back into [`run_task`] each time the reactor runs it.
+///
+/// `TaskCore` always lives inside an `Rc`. Wakers hold strong references
+/// to it, and so does the reactor's task queue while the task is scheduled.
+pub(crate) struct TaskCore {
+    future: RefCell<Option<Pin<Box<dyn Future<Output = ()>>>>>,
+    cpp_task: RefCell<cxx::UniquePtr<ffi::RustTask>>,
+    scheduled: Cell<bool>,
+    done: Cell<bool>,
+    owner: usize,
+    // Set for tasks spawned with a label.
+    stats: Option<&'static TaskTypeStats>,
+}
+
+impl TaskCore {
+    fn check_owner(&self) {
+        assert_eq!(
+            self.owner,
+            current_thread_marker(),
+            "a waker of a seastar task was used outside of the shard which owns the task",
+        );
+    }
+
+    fn schedule(&self) {
+        if self.done.get() || self.scheduled.replace(true) {
+            return;
+        }
+        // The reactor's task queue holds a strong reference to the task
+        // while it is scheduled, it is released again in `run_task`.
+        // Safety: `self` always lives inside an `Rc`.
+        unsafe { Rc::increment_strong_count(self as *const Self) };
+        ffi::schedule_rust_task(self.cpp_task.borrow_mut().pin_mut());
+    }
+
+    fn poll(self: &Rc<Self>) {
+        // The task outlives the poll, so the waker can borrow our reference.
+        let waker = ManuallyDrop::new(unsafe { Waker::from_raw(raw_waker(Rc::as_ptr(self))) });
+        let mut cx = Context::from_waker(&waker);
+        let mut future = self.future.borrow_mut();
+        let Some(fut) = future.as_mut() else {
+            return;
+        };
+        let start = self.stats.map(|_| Instant::now());
+        let ready = fut.as_mut().poll(&mut cx).is_ready();
+        if let (Some(stats), Some(start)) = (self.stats, start) {
+            stats.record(start.elapsed());
+        }
+        if ready {
+            self.done.set(true);
+            *future = None;
+        }
+    }
+}
+
+/// Runs a task which was scheduled by a waker. Called by the reactor.
+unsafe fn run_task(core: *const TaskCore) {
+    // Take over the reference which was acquired when scheduling the task.
+    let core = Rc::from_raw(core);
+    core.scheduled.set(false);
+    core.poll();
+}
+
+static TASK_WAKER_VTABLE: RawWakerVTable =
+    RawWakerVTable::new(clone_waker, wake, wake_by_ref, drop_waker);
+
+fn raw_waker(core: *const TaskCore) -> RawWaker {
+    RawWaker::new(core.cast(), &TASK_WAKER_VTABLE)
+}
+
+unsafe fn clone_waker(data: *const ()) -> RawWaker {
+    let core = data.cast::<TaskCore>();
+    (*core).check_owner();
+    Rc::increment_strong_count(core);
+    raw_waker(core)
+}
+
+unsafe fn wake(data: *const ()) {
+    let core = data.cast::<TaskCore>();
+    (*core).check_owner();
+    Rc::from_raw(core).schedule();
+}
+
+unsafe fn wake_by_ref(data: *const ()) {
+    let core = &*data.cast::<TaskCore>();
+    core.check_owner();
+    core.schedule();
+}
+
+unsafe fn drop_waker(data: *const ()) {
+    let core = data.cast::<TaskCore>();
+    (*core).check_owner();
+    drop(Rc::from_raw(core));
+}
+
+/// Schedules the future to be run as a task on the current shard.
+///
+/// The future must not panic, see [`spawn`] for a variant which handles that.
+fn spawn_detached(
+    future: impl Future<Output = ()> + 'static,
+    stats: Option<&'static TaskTypeStats>,
+) {
+    let core = Rc::new(TaskCore {
+        future: RefCell::new(Some(Box::pin(future))),
+        cpp_task: RefCell::new(cxx::UniquePtr::null()),
+        scheduled: Cell::new(false),
+        done: Cell::new(false),
+        owner: current_thread_marker(),
+        stats,
+    });
+    *core.cpp_task.borrow_mut() = unsafe { ffi::make_rust_task(Rc::as_ptr(&core)) };
+    core.schedule();
+}
+
+/// The output of a task, or the payload of its panic.
+pub(crate) type TaskResult<T> = Result<T, Box<dyn Any + Send>>;
+
+struct JoinState<T> {
+    result: Option<TaskResult<T>>,
+    waker: Option<Waker>,
+}
+
+/// A handle which allows waiting for the result of a task started with
+/// [`spawn`].
+///
+/// Dropping the handle detaches the task - it keeps running in the
+/// background, but its output is discarded.
+pub struct JoinHandle<T> {
+    state: Rc<RefCell<JoinState<T>>>,
+}
+
+impl<T> Future for JoinHandle<T> {
+    type Output = T;
+
+    /// Resolves to the output of the task.
+    ///
+    /// # Panics
+    ///
+    /// If the task panicked, the panic is resumed in the task which awaits
+    /// the handle.
+    fn poll(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<T> {
+        let mut state = self.state.borrow_mut();
+        match state.result.take() {
+            Some(Ok(output)) => Poll::Ready(output),
+            Some(Err(payload)) => {
+                drop(state);
+                panic::resume_unwind(payload)
+            }
+            None => {
+                state.waker = Some(cx.waker().clone());
+                Poll::Pending
+            }
+        }
+    }
+}
+
+/// Runs the future as a new task on the current shard.
+///
+/// The task is run by the Seastar reactor in the scheduling group which
+/// is current at the moment of spawning. The future does not have to be
+/// `Send` because it never leaves the shard on which it was spawned.
+///
+/// This function must be called from a reactor thread.
+pub fn spawn<F>(future: F) -> JoinHandle<F::Output>
+where
+    F: Future + 'static,
+    F::Output: 'static,
+{
+    spawn_with_stats(future, None)
+}
+
+/// Runs the future as a new task on the current shard, like [`spawn`],
+/// and accounts for its polls under `label`.
+///
+/// Tasks spawned with the same label on a shard share their statistics:
+/// the number of polls, the total time spent in them and the longest one,
+/// see [`task_stats`](crate::task_stats()). They are exported as metrics,
+/// too. Timing the polls costs two clock reads per poll, which is why
+/// tasks spawned with [`spawn`] are not accounted for.
+pub fn spawn_labeled<F>(label: &'static str, future: F) -> JoinHandle<F::Output>
+where
+    F: Future + 'static,
+    F::Output: 'static,
+{
+    spawn_with_stats(future, Some(TaskTypeStats::get(label)))
+}
+
+fn spawn_with_stats<F>(future: F, stats: Option<&'static TaskTypeStats>) -> JoinHandle<F::Output>
+where
+    F: Future + 'static,
+    F::Output: 'static,
+{
+    let state = Rc::new(RefCell::new(JoinState {
+        result: None,
+        waker: None,
+    }));
+    let task_state = state.clone();
+    spawn_detached(
+        async move {
+            let result = AssertUnwindSafe(future).catch_unwind().await;
+            let mut state = task_state.borrow_mut();
+            state.result = Some(result);
+            if let Some(waker) = state.waker.take() {
+                waker.wake();
+            }
+        },
+        stats,
+    );
+    JoinHandle { state }
+}
+
+/// Runs the future as a new task and resolves the C++ promise
+/// once the future completes. The future must not panic.
+pub(crate) fn spawn_into_promise(
+    future: impl Future<Output = ()> + 'static,
+    mut promise: cxx::UniquePtr<VoidPromise>,
+) {
+    spawn_detached(
+        async move {
+            future.await;
+            promise.pin_mut().set_value();
+        },
+        None,
+    );
+}
+
+#[seastar::test]
+async fn test_spawn_and_join() {
+    let handle = spawn(async { 21 * 2 });
+    assert_eq!(handle.await, 42);
+}
+
+#[seastar::test]
+async fn test_spawn_wakes_joiner() {
+    let (tx, rx) = futures::channel::oneshot::channel();
+    let handle = spawn(async move { rx.await.unwrap() });
+    spawn(async move { tx.send("done").unwrap() });
+    assert_eq!(handle.await, "done");
+}
+
+#[seastar::test]
+async fn test_spawn_labeled_records_polls() {
+    let label = "test_spawn_labeled_records_polls";
+    assert_eq!(crate::task_stats(label), None);
+    let (tx, rx) = futures::channel::oneshot::channel::<()>();
+    let handle = spawn_labeled(label, async move {
+        rx.await.unwrap();
+        // Spin briefly rather than sleep, so that the shared reactor is not
+        // stalled for the other tests.
+        let start = std::time::Instant::now();
+        while start.elapsed() < std::time::Duration::from_micros(100) {
+            std::hint::spin_loop();
+        }
+    });
+    spawn(async move { tx.send(()).unwrap() });
+    handle.await;
+    let stats = crate::task_stats(label).unwrap();
+    assert_eq!(stats.polls, 2);
+    assert!(stats.longest_poll >= std::time::Duration::from_micros(100));
+    assert!(stats.runtime >= stats.longest_poll);
+}
+
+#[seastar::test]
+#[should_panic(expected = "boom")]
+async fn test_spawn_propagates_panic() {
+    spawn(async { panic!("boom") }).await
+}
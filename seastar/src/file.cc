@@ -0,0 +1,75 @@
+#include "seastar/src/file.hh"
+#include "seastar/src/file.rs.h"
+
+#include <seastar/core/sstring.hh>
+
+namespace seastar_rs {
+
+std::unique_ptr<seastar::file> new_file() {
+    return std::make_unique<seastar::file>();
+}
+
+static seastar::open_flags to_open_flags(const FileOpenOptions& options) {
+    auto flags = options.write
+            ? (options.read ? seastar::open_flags::rw : seastar::open_flags::wo)
+            : seastar::open_flags::ro;
+    if (options.create) {
+        flags = flags | seastar::open_flags::create;
+    }
+    if (options.truncate) {
+        flags = flags | seastar::open_flags::truncate;
+    }
+    if (options.exclusive) {
+        flags = flags | seastar::open_flags::exclusive;
+    }
+    if (options.dsync) {
+        flags = flags | seastar::open_flags::dsync;
+    }
+    return flags;
+}
+
+void open_file_dma(rust::Str name, const FileOpenOptions& options, seastar::file& file, completion c) {
+    auto opened = seastar::futurize_invoke([&] {
+        return seastar::open_file_dma(seastar::sstring(name.data(), name.size()), to_open_flags(options));
+    });
+    // The Rust side keeps the file alive until the completion is resolved.
+    complete_void(c, opened.then([&file] (seastar::file opened) {
+        file = std::move(opened);
+    }));
+}
+
+void file_size(const seastar::file& file, completion c) {
+    // Copies share the underlying file, which has to outlive the operation.
+    auto f = file;
+    complete_u64(c, f.size().finally([f] {}));
+}
+
+void file_close(const seastar::file& file, completion c) {
+    auto f = file;
+    complete_void(c, f.close().finally([f] {}));
+}
+
+std::unique_ptr<input_stream> make_file_input_stream(const seastar::file& file,
+        uint64_t offset, const FileInputStreamOptions& options) {
+    seastar::file_input_stream_options opts;
+    opts.buffer_size = options.buffer_size;
+    opts.read_ahead = options.read_ahead;
+    if (options.dynamic_adjustments) {
+        opts.dynamic_adjustments = seastar::make_lw_shared<seastar::file_input_stream_history>();
+    }
+    return std::make_unique<input_stream>(seastar::make_file_input_stream(file, offset, std::move(opts)));
+}
+
+void make_file_output_stream(const seastar::file& file, const FileOutputStreamOptions& options,
+        output_stream& stream, completion c) {
+    seastar::file_output_stream_options opts;
+    opts.buffer_size = options.buffer_size;
+    opts.preallocation_size = options.preallocation_size;
+    opts.write_behind = options.write_behind;
+    // The Rust side keeps the stream alive until the completion is resolved.
+    complete_void(c, seastar::make_file_output_stream(file, opts).then([&stream] (seastar::output_stream<char> out) {
+        stream.init(std::move(out));
+    }));
+}
+
+}
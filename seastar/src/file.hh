@@ -0,0 +1,30 @@
+#pragma once
+
+#include "seastar/src/completion.hh"
+#include "seastar/src/iostream.hh"
+
+#include <seastar/core/file.hh>
+#include <seastar/core/fstream.hh>
+
+#include <memory>
+
+namespace seastar_rs {
+
+struct FileOpenOptions;
+struct FileInputStreamOptions;
+struct FileOutputStreamOptions;
+
+std::unique_ptr<seastar::file> new_file();
+// The file is assigned once the completion is resolved.
+void open_file_dma(rust::Str name, const FileOpenOptions& options, seastar::file& file, completion c);
+void file_size(const seastar::file& file, completion c);
+void file_close(const seastar::file& file, completion c);
+
+std::unique_ptr<input_stream> make_file_input_stream(const seastar::file& file,
+        uint64_t offset, const FileInputStreamOptions& options);
+
+// The stream is initialized once the completion is resolved.
+void make_file_output_stream(const seastar::file& file, const FileOutputStreamOptions& options,
+        output_stream& stream, completion c);
+
+}
@@ -0,0 +1,394 @@
+//! File I/O, `seastar::file` and the streams built on top of it.
+//!
+//! Files are opened with `O_DIRECT`, so reads and writes bypass the page
+//! cache and go through the reactor's I/O scheduler. The streams take care
+//! of the alignment requirements which this imposes.
+
+use crate::completion::completion;
+use crate::{InputStream, OutputStream};
+use cxx::UniquePtr;
+use std::io;
+
+/// The stream returned by [`File::input_stream`].
+pub type FileInputStream = InputStream;
+
+/// The stream returned by [`File::output_stream`].
+pub type FileOutputStream = OutputStream;
+
+#[cxx::bridge(namespace = "seastar_rs")]
+mod ffi {
+    #[derive(Clone, Debug)]
+    struct FileOpenOptions {
+        read: bool,
+        write: bool,
+        create: bool,
+        truncate: bool,
+        exclusive: bool,
+        dsync: bool,
+    }
+
+    struct FileInputStreamOptions {
+        buffer_size: usize,
+        read_ahead: u32,
+        dynamic_adjustments: bool,
+    }
+
+    struct FileOutputStreamOptions {
+        buffer_size: u32,
+        preallocation_size: u32,
+        write_behind: u32,
+    }
+
+    unsafe extern "C++" {
+        include!("seastar/src/file.hh");
+
+        #[cxx_name = "completion"]
+        type Completion = crate::completion::Completion;
+
+        #[namespace = "seastar"]
+        #[cxx_name = "file"]
+        type CppFile;
+
+        #[cxx_name = "input_stream"]
+        type CppInputStream = crate::iostream::CppInputStream;
+
+        #[cxx_name = "output_stream"]
+        type CppOutputStream = crate::iostream::CppOutputStream;
+
+        fn new_file() -> UniquePtr<CppFile>;
+        fn open_file_dma(
+            name: &str,
+            options: &FileOpenOptions,
+            file: Pin<&mut CppFile>,
+            c: Completion,
+        );
+        fn file_size(file: &CppFile, c: Completion);
+        fn file_close(file: &CppFile, c: Completion);
+
+        fn make_file_input_stream(
+            file: &CppFile,
+            offset: u64,
+            options: &FileInputStreamOptions,
+        ) -> UniquePtr<CppInputStream>;
+
+        fn make_file_output_stream(
+            file: &CppFile,
+            options: &FileOutputStreamOptions,
+            stream: Pin<&mut CppOutputStream>,
+            c: Completion,
+        );
+    }
+}
+
+/// Options for opening a file, like [`std::fs::OpenOptions`].
+#[derive(Clone, Debug)]
+pub struct OpenOptions {
+    options: ffi::FileOpenOptions,
+}
+
+impl OpenOptions {
+    /// Creates options with every flag unset.
+    pub fn new() -> Self {
+        Self {
+            options: ffi::FileOpenOptions {
+                read: false,
+                write: false,
+                create: false,
+                truncate: false,
+                exclusive: false,
+                dsync: false,
+            },
+        }
+    }
+
+    /// Opens the file for reading.
+    pub fn read(&mut self, read: bool) -> &mut Self {
+        self.options.read = read;
+        self
+    }
+
+    /// Opens the file for writing.
+    pub fn write(&mut self, write: bool) -> &mut Self {
+        self.options.write = write;
+        self
+    }
+
+    /// Creates the file if it does not exist, `open_flags::create`.
+    pub fn create(&mut self, create: bool) -> &mut Self {
+        self.options.create = create;
+        self
+    }
+
+    /// Truncates the file to zero length, `open_flags::truncate`.
+    pub fn truncate(&mut self, truncate: bool) -> &mut Self {
+        self.options.truncate = truncate;
+        self
+    }
+
+    /// Fails if the file exists already, `open_flags::exclusive`.
+    pub fn exclusive(&mut self, exclusive: bool) -> &mut Self {
+        self.options.exclusive = exclusive;
+        self
+    }
+
+    /// Makes each write durable before it completes, `open_flags::dsync`.
+    pub fn dsync(&mut self, dsync: bool) -> &mut Self {
+        self.options.dsync = dsync;
+        self
+    }
+
+    /// Opens the file at `path`, `seastar::open_file_dma`.
+    pub async fn open(&self, path: &str) -> io::Result<File> {
+        let mut file = ffi::new_file();
+        let (c, pending) = completion();
+        ffi::open_file_dma(path, &self.options, file.pin_mut(), c);
+        // The file is assigned by the C++ side when the open completes.
+        let (result, file) = pending.keeping(file).await;
+        result?;
+        Ok(File { file })
+    }
+}
+
+impl Default for OpenOptions {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+/// A file opened for direct I/O, `seastar::file`.
+///
+/// A file belongs to the shard which opened it. Dropping it closes the
+/// file descriptor synchronously, [`File::close`] does it in the background
+/// and reports errors.
+pub struct File {
+    file: UniquePtr<ffi::CppFile>,
+}
+
+impl File {
+    /// Opens the file at `path` for reading.
+    pub async fn open(path: &str) -> io::Result<File> {
+        OpenOptions::new().read(true).open(path).await
+    }
+
+    /// Opens the file at `path` for writing, creating it if it does not
+    /// exist and truncating it if it does.
+    pub async fn create(path: &str) -> io::Result<File> {
+        OpenOptions::new()
+            .write(true)
+            .create(true)
+            .truncate(true)
+            .open(path)
+            .await
+    }
+
+    /// Returns the size of the file in bytes.
+    pub async fn size(&self) -> io::Result<u64> {
+        let (c, pending) = completion();
+        ffi::file_size(&self.file, c);
+        Ok(pending.await?.into_u64())
+    }
+
+    /// Closes the file.
+    pub async fn close(self) -> io::Result<()> {
+        let (c, pending) = completion();
+        ffi::file_close(&self.file, c);
+        pending.await?;
+        Ok(())
+    }
+
+    /// Creates a stream which reads the file from `offset` until its end,
+    /// `seastar::make_file_input_stream`.
+    ///
+    /// Its reads are aligned DMA reads, with read-ahead if configured.
+    pub fn input_stream(&self, offset: u64, options: FileInputStreamOptions) -> InputStream {
+        let options = ffi::FileInputStreamOptions {
+            buffer_size: options.buffer_size,
+            read_ahead: options.read_ahead,
+            dynamic_adjustments: options.dynamic_adjustments,
+        };
+        InputStream::new(ffi::make_file_input_stream(&self.file, offset, &options))
+    }
+
+    /// Creates a stream which writes the file from its beginning,
+    /// `seastar::make_file_output_stream`.
+    ///
+    /// Full buffers are written to the disk with aligned DMA writes. With
+    /// write-behind, several such writes can be in flight while more bytes
+    /// are written.
+    ///
+    /// Flushing the stream also flushes the file itself (`fdatasync`), so
+    /// a batch of writes is made durable with a single flush. Closing it
+    /// trims the file to the written size.
+    pub async fn output_stream(
+        &self,
+        options: FileOutputStreamOptions,
+    ) -> io::Result<OutputStream> {
+        let options = ffi::FileOutputStreamOptions {
+            buffer_size: options.buffer_size,
+            preallocation_size: options.preallocation_size,
+            write_behind: options.write_behind,
+        };
+        let mut stream = OutputStream::uninit();
+        let (c, pending) = completion();
+        ffi::make_file_output_stream(&self.file, &options, stream.pin_mut(), c);
+        // The stream is initialized by the C++ side when it is made.
+        let (result, stream) = pending.keeping(stream).await;
+        result?;
+        Ok(OutputStream::new(stream))
+    }
+}
+
+/// Options of a [`FileInputStream`], `seastar::file_input_stream_options`.
+#[derive(Clone, Copy, Debug)]
+pub struct FileInputStreamOptions {
+    buffer_size: usize,
+    read_ahead: u32,
+    dynamic_adjustments: bool,
+}
+
+impl FileInputStreamOptions {
+    /// Sets the size of each read; buffers handed out by the stream are at
+    /// most this large. 8 KiB by default.
+    pub fn buffer_size(mut self, buffer_size: usize) -> Self {
+        self.buffer_size = buffer_size;
+        self
+    }
+
+    /// Sets the number of reads issued ahead of the one being consumed,
+    /// so that sequential reads are not slowed down by the disk latency.
+    /// No read-ahead by default.
+    pub fn read_ahead(mut self, read_ahead: u32) -> Self {
+        self.read_ahead = read_ahead;
+        self
+    }
+
+    /// Lets the stream tune the buffer size and read-ahead to how much of
+    /// the data it reads is actually consumed, `dynamic_adjustments`.
+    /// The history of the stream is its own, it is not shared with other
+    /// streams.
+    pub fn dynamic_adjustments(mut self, enabled: bool) -> Self {
+        self.dynamic_adjustments = enabled;
+        self
+    }
+}
+
+impl Default for FileInputStreamOptions {
+    fn default() -> Self {
+        Self {
+            buffer_size: 8192,
+            read_ahead: 0,
+            dynamic_adjustments: false,
+        }
+    }
+}
+
+/// Options of a [`FileOutputStream`], `seastar::file_output_stream_options`.
+#[derive(Clone, Copy, Debug)]
+pub struct FileOutputStreamOptions {
+    buffer_size: u32,
+    preallocation_size: u32,
+    write_behind: u32,
+}
+
+impl FileOutputStreamOptions {
+    /// Sets the size of each write, which is rounded to the disk's
+    /// alignment. 64 KiB by default.
+    pub fn buffer_size(mut self, buffer_size: u32) -> Self {
+        self.buffer_size = buffer_size;
+        self
+    }
+
+    /// Sets how much the file is extended by ahead of the writes, so that
+    /// the filesystem can allocate it in large extents. Off by default.
+    pub fn preallocation_size(mut self, preallocation_size: u32) -> Self {
+        self.preallocation_size = preallocation_size;
+        self
+    }
+
+    /// Sets the number of buffers which may be written to the disk at
+    /// once. Writing goes on while they are in flight, and only waits when
+    /// all of them are. 1 by default.
+    pub fn write_behind(mut self, write_behind: u32) -> Self {
+        assert!(write_behind > 0, "at least one write has to be allowed");
+        self.write_behind = write_behind;
+        self
+    }
+}
+
+impl Default for FileOutputStreamOptions {
+    fn default() -> Self {
+        Self {
+            buffer_size: 65536,
+            preallocation_size: 0,
+            write_behind: 1,
+        }
+    }
+}
+
+#[cfg(test)]
+pub(crate) fn temp_path(name: &str) -> String {
+    let dir = std::env::temp_dir();
+    format!(
+        "{}/seastar-rs-{}-{}",
+        dir.display(),
+        std::process::id(),
+        name
+    )
+}
+
+#[seastar::test]
+async fn test_file_input_stream_reads_whole_file() {
+    use futures::TryStreamExt;
+
+    let path = temp_path("input-stream");
+    let contents: Vec<u8> = (0..100_000u32).map(|i| i as u8).collect();
+    std::fs::write(&path, &contents).unwrap();
+
+    let file = File::open(&path).await.unwrap();
+    assert_eq!(file.size().await.unwrap(), contents.len() as u64);
+    let options = FileInputStreamOptions::default()
+        .buffer_size(4096)
+        .read_ahead(2)
+        .dynamic_adjustments(true);
+    let mut stream = file.input_stream(0, options);
+    let mut read = Vec::new();
+    while let Some(buf) = stream.try_next().await.unwrap() {
+        assert!(buf.len() <= 4096);
+        read.extend_from_slice(&buf);
+    }
+    assert_eq!(read, contents);
+    stream.close().await.unwrap();
+    file.close().await.unwrap();
+    std::fs::remove_file(&path).unwrap();
+}
+
+#[seastar::test]
+async fn test_file_open_missing() {
+    let error = File::open(&temp_path("missing")).await.err().unwrap();
+    assert_eq!(error.kind(), io::ErrorKind::NotFound);
+}
+
+#[seastar::test]
+async fn test_file_output_stream_writes_behind() {
+    use futures::AsyncWriteExt;
+
+    let path = temp_path("output-stream");
+    let contents: Vec<u8> = (0..100_000u32).map(|i| (i % 251) as u8).collect();
+    let file = File::create(&path).await.unwrap();
+    let options = FileOutputStreamOptions::default()
+        .buffer_size(4096)
+        .preallocation_size(1 << 20)
+        .write_behind(4);
+    let mut stream = file.output_stream(options).await.unwrap();
+    for chunk in contents.chunks(1000) {
+        stream.write_all(chunk).await.unwrap();
+    }
+    stream.flush().await.unwrap();
+    stream.close().await.unwrap();
+    assert!(stream.write(b"x").await.is_err());
+    file.close().await.unwrap();
+
+    // Closing trims the file from the aligned and preallocated size.
+    assert_eq!(std::fs::read(&path).unwrap(), contents);
+    std::fs::remove_file(&path).unwrap();
+}
@@ -0,0 +1,236 @@
+#include "seastar/src/httpd.hh"
+#include "seastar/src/httpd.rs.h"
+
+#include <seastar/http/matcher.hh>
+#include <seastar/http/matchrules.hh>
+
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+namespace seastar_rs {
+
+http_exchange::http_exchange(std::unique_ptr<seastar::http::request> req, std::unique_ptr<seastar::http::reply> rep)
+    : _state(seastar::make_lw_shared<state>())
+{
+    _state->req = std::move(req);
+    _state->rep = std::move(rep);
+}
+
+http_exchange::~http_exchange() {
+    if (!_state->finished) {
+        (void)_state->reads.close().then([st = _state] {
+            st->done.set_exception(std::runtime_error("the handler dropped the request"));
+        });
+    }
+}
+
+seastar::future<std::unique_ptr<seastar::http::reply>> http_exchange::get_future() {
+    return _state->done.get_future();
+}
+
+const seastar::http::request& http_exchange::request() const {
+    return *_state->req;
+}
+
+seastar::http::reply& http_exchange::reply() const {
+    return *_state->rep;
+}
+
+void http_exchange::read_body(completion c) const {
+    complete_buffer(c, seastar::with_gate(_state->reads, [st = _state] {
+        if (st->req->content_stream) {
+            return st->req->content_stream->read();
+        }
+        // Without content streaming, the server has read the body already.
+        if (std::exchange(st->content_read, true)) {
+            return seastar::make_ready_future<temporary_buffer>();
+        }
+        const auto& content = st->req->content;
+        return seastar::make_ready_future<temporary_buffer>(temporary_buffer(content.data(), content.size()));
+    }));
+}
+
+void http_exchange::finish() const {
+    _state->finished = true;
+    (void)_state->reads.close().then([st = _state] {
+        st->rep->done();
+        st->done.set_value(std::move(st->rep));
+    });
+}
+
+const seastar::sstring& http_request_method(const http_exchange& ex) noexcept {
+    return ex.request()._method;
+}
+
+const seastar::sstring& http_request_path(const http_exchange& ex) noexcept {
+    return ex.request()._url;
+}
+
+const seastar::sstring* http_request_header(const http_exchange& ex, rust::Str name) {
+    const auto& headers = ex.request()._headers;
+    auto it = headers.find(seastar::sstring(name.data(), name.size()));
+    return it != headers.end() ? &it->second : nullptr;
+}
+
+const seastar::sstring* http_request_query_param(const http_exchange& ex, rust::Str name) {
+    const auto& params = ex.request().query_parameters;
+    auto it = params.find(seastar::sstring(name.data(), name.size()));
+    return it != params.end() ? &it->second : nullptr;
+}
+
+seastar::sstring http_request_path_param(const http_exchange& ex, rust::Str name, bool& found) {
+    const auto& params = ex.request().param;
+    auto key = seastar::sstring(name.data(), name.size());
+    found = params.exists(key);
+    // The raw value starts with the '/' of its segment and is still
+    // URL-encoded.
+    return found ? params.get_decoded_param(key) : seastar::sstring();
+}
+
+uint64_t http_request_content_length(const http_exchange& ex) noexcept {
+    return ex.request().content_length;
+}
+
+void http_request_read_body(const http_exchange& ex, completion c) {
+    ex.read_body(c);
+}
+
+void http_reply_set_status(const http_exchange& ex, uint16_t status) noexcept {
+    ex.reply().set_status(static_cast<seastar::http::reply::status_type>(status));
+}
+
+void http_reply_add_header(const http_exchange& ex, seastar::sstring name, seastar::sstring value) {
+    ex.reply()._headers[std::move(name)] = std::move(value);
+}
+
+void http_reply_write_body(const http_exchange& ex, const seastar::sstring& content_type, seastar::sstring body) {
+    // write_body() maps a file extension to a content type, which is then
+    // replaced with the type given by Rust.
+    ex.reply().write_body("txt", std::move(body));
+    ex.reply().set_mime_type(content_type);
+}
+
+void http_reply_write_body_stream(const http_exchange& ex, const seastar::sstring& content_type,
+        rust::Box<BodyWriter> writer) {
+    ex.reply().write_body("txt", [writer = std::move(writer)] (seastar::output_stream<char>&& out) mutable {
+        seastar::promise<> pr;
+        auto f = pr.get_future();
+        write_http_body(std::move(writer), std::make_unique<output_stream>(std::move(out)),
+                std::make_unique<void_promise>(std::move(pr)));
+        return f;
+    });
+    ex.reply().set_mime_type(content_type);
+}
+
+void http_exchange_finish(const http_exchange& ex) {
+    ex.finish();
+}
+
+rust_handler::rust_handler(rust::Box<HttpHandler> handler) noexcept
+    : _handler(std::move(handler))
+{}
+
+seastar::future<std::unique_ptr<seastar::http::reply>> rust_handler::handle(const seastar::sstring& path,
+        std::unique_ptr<seastar::http::request> req, std::unique_ptr<seastar::http::reply> rep) {
+    auto ex = std::make_unique<http_exchange>(std::move(req), std::move(rep));
+    auto f = ex->get_future();
+    handle_http_request(*_handler, std::move(ex));
+    return f;
+}
+
+// Method in httpd.rs lists the operations in the same order.
+static_assert(seastar::httpd::GET == 0 && seastar::httpd::PATCH == 8);
+
+void routes_add(seastar::httpd::routes& routes, uint8_t method, rust::Str path, rust::Box<HttpHandler> handler) {
+    auto op = static_cast<seastar::httpd::operation_type>(method);
+    auto h = new rust_handler(std::move(handler));
+    std::string_view rest(path.data(), path.size());
+    if (rest.find('{') == std::string_view::npos) {
+        routes.put(op, seastar::sstring(rest), h);
+        return;
+    }
+    // Parameters match a whole segment of the path, or with a trailing *
+    // the rest of it.
+    auto rule = std::make_unique<seastar::httpd::match_rule>(h);
+    while (!rest.empty()) {
+        auto end = rest.find('/', 1);
+        auto segment = rest.substr(0, end);
+        rest = end == std::string_view::npos ? std::string_view() : rest.substr(end);
+        if (segment.size() > 3 && segment[1] == '{' && segment.back() == '}') {
+            auto name = segment.substr(2, segment.size() - 3);
+            bool all_path = name.back() == '*';
+            if (all_path) {
+                name.remove_suffix(1);
+            }
+            rule->add_param(seastar::sstring(name), all_path);
+        } else {
+            rule->add_str(seastar::sstring(segment));
+        }
+    }
+    // routes takes ownership of the rule.
+    routes.add(rule.release(), op);
+}
+
+http_server::http_server()
+    : _state(seastar::make_lw_shared<state>())
+{}
+
+http_server::~http_server() {
+    if (_state->started) {
+        (void)_state->control.stop().handle_exception([] (std::exception_ptr) {}).finally([st = _state] {});
+    }
+}
+
+void http_server::start(rust::Str name, completion c) {
+    complete_void(c, _state->control.start(seastar::sstring(name.data(), name.size())).then([st = _state] {
+        st->started = true;
+        // Request bodies are handed to Rust as they arrive.
+        return st->control.server().invoke_on_all([] (seastar::httpd::http_server& server) {
+            server.set_content_streaming(true);
+        });
+    }));
+}
+
+void http_server::set_routes(rust::Box<RoutesFactory> factory, completion c) const {
+    // The function is copied to every shard, which all call the factory.
+    auto shared = std::make_shared<rust::Box<RoutesFactory>>(std::move(factory));
+    complete_void(c, _state->control.set_routes([shared] (seastar::httpd::routes& routes) {
+        configure_routes(**shared, routes);
+    }).finally([st = _state] {}));
+}
+
+void http_server::listen(const SockAddr& addr, const ListenOptions& options, completion c) const {
+    auto listen = [addr = to_socket_address(addr), opts = to_listen_options(options)] (seastar::httpd::http_server& server) {
+        return server.listen(addr, opts);
+    };
+    complete_void(c, _state->control.server().invoke_on_all(std::move(listen)).finally([st = _state] {}));
+}
+
+void http_server::stop(completion c) {
+    _state->started = false;
+    complete_void(c, _state->control.stop().finally([st = _state] {}));
+}
+
+std::unique_ptr<http_server> new_http_server() {
+    return std::make_unique<http_server>();
+}
+
+void start_http_server(http_server& server, rust::Str name, completion c) {
+    server.start(name, c);
+}
+
+void http_server_set_routes(const http_server& server, rust::Box<RoutesFactory> factory, completion c) {
+    server.set_routes(std::move(factory), c);
+}
+
+void http_server_listen(const http_server& server, const SockAddr& addr, const ListenOptions& options,
+        completion c) {
+    server.listen(addr, options, c);
+}
+
+void http_server_stop(http_server& server, completion c) {
+    server.stop(c);
+}
+
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "seastar/src/completion.hh"
+#include "seastar/src/executor.hh"
+#include "seastar/src/iostream.hh"
+#include "seastar/src/net.hh"
+
+#include <seastar/core/gate.hh>
+#include <seastar/core/shared_ptr.hh>
+#include <seastar/core/sstring.hh>
+#include <seastar/http/handlers.hh>
+#include <seastar/http/httpd.hh>
+#include <seastar/http/routes.hh>
+
+#include <memory>
+
+namespace seastar_rs {
+
+struct HttpHandler;
+struct BodyWriter;
+struct RoutesFactory;
+
+// A request handed to a Rust handler together with its reply, which Rust
+// can drop at any time. Finishing the exchange hands the reply back to the
+// server, while dropping it unfinished fails the request; either happens
+// once the reads of the body in flight are done.
+class http_exchange {
+    struct state {
+        std::unique_ptr<seastar::http::request> req;
+        std::unique_ptr<seastar::http::reply> rep;
+        seastar::promise<std::unique_ptr<seastar::http::reply>> done;
+        seastar::gate reads;
+        bool content_read = false;
+        bool finished = false;
+    };
+    seastar::lw_shared_ptr<state> _state;
+public:
+    http_exchange(std::unique_ptr<seastar::http::request> req, std::unique_ptr<seastar::http::reply> rep);
+    http_exchange(const http_exchange&) = delete;
+    ~http_exchange();
+
+    seastar::future<std::unique_ptr<seastar::http::reply>> get_future();
+    const seastar::http::request& request() const;
+    seastar::http::reply& reply() const;
+    void read_body(completion c) const;
+    void finish() const;
+};
+
+const seastar::sstring& http_request_method(const http_exchange& ex) noexcept;
+const seastar::sstring& http_request_path(const http_exchange& ex) noexcept;
+// These return null if the request has no such header or parameter.
+const seastar::sstring* http_request_header(const http_exchange& ex, rust::Str name);
+const seastar::sstring* http_request_query_param(const http_exchange& ex, rust::Str name);
+seastar::sstring http_request_path_param(const http_exchange& ex, rust::Str name, bool& found);
+uint64_t http_request_content_length(const http_exchange& ex) noexcept;
+void http_request_read_body(const http_exchange& ex, completion c);
+void http_reply_set_status(const http_exchange& ex, uint16_t status) noexcept;
+void http_reply_add_header(const http_exchange& ex, seastar::sstring name, seastar::sstring value);
+void http_reply_write_body(const http_exchange& ex, const seastar::sstring& content_type, seastar::sstring body);
+// The body is written by Rust after the exchange is finished.
+void http_reply_write_body_stream(const http_exchange& ex, const seastar::sstring& content_type,
+        rust::Box<BodyWriter> writer);
+void http_exchange_finish(const http_exchange& ex);
+
+// A handler which passes each request to a Rust function.
+class rust_handler final : public seastar::httpd::handler_base {
+    rust::Box<HttpHandler> _handler;
+public:
+    explicit rust_handler(rust::Box<HttpHandler> handler) noexcept;
+    virtual seastar::future<std::unique_ptr<seastar::http::reply>> handle(const seastar::sstring& path,
+            std::unique_ptr<seastar::http::request> req, std::unique_ptr<seastar::http::reply> rep) override;
+};
+
+// Adds a route for a path such as "/users/{id}", see Routes::add in
+// httpd.rs.
+void routes_add(seastar::httpd::routes& routes, uint8_t method, rust::Str path, rust::Box<HttpHandler> handler);
+
+// An http_server_control which Rust can drop at any time. A server which
+// was started and not stopped is stopped in the background.
+class http_server {
+    struct state {
+        seastar::httpd::http_server_control control;
+        bool started = false;
+    };
+    seastar::lw_shared_ptr<state> _state;
+public:
+    http_server();
+    http_server(const http_server&) = delete;
+    ~http_server();
+
+    void start(rust::Str name, completion c);
+    void set_routes(rust::Box<RoutesFactory> factory, completion c) const;
+    void listen(const SockAddr& addr, const ListenOptions& options, completion c) const;
+    void stop(completion c);
+};
+
+std::unique_ptr<http_server> new_http_server();
+// The server is started once the completion is resolved.
+void start_http_server(http_server& server, rust::Str name, completion c);
+void http_server_set_routes(const http_server& server, rust::Box<RoutesFactory> factory, completion c);
+void http_server_listen(const http_server& server, const SockAddr& addr, const ListenOptions& options,
+        completion c);
+void http_server_stop(http_server& server, completion c);
+
+}
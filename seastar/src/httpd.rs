@@ -0,0 +1,595 @@
+//! HTTP server, `seastar::httpd::http_server`.
+//!
+//! A server runs on every shard. Its routes are set up on each shard by a
+//! function which adds the handlers, so handlers are plain async functions
+//! which need not be `Send`, and each request is handled on the shard whose
+//! connection it arrived on.
+//!
+//! ```ignore
+//! let server = HttpServer::start("api").await?;
+//! server
+//!     .set_routes(|routes| {
+//!         routes.add(Method::Get, "/hello/{name}", |request: Request| async move {
+//!             let name = request.path_param("name").unwrap_or_default();
+//!             Response::ok().body("text/plain", format!("hello {name}"))
+//!         });
+//!     })
+//!     .await?;
+//! server.listen(SocketAddr::from(([0, 0, 0, 0], 8080))).await?;
+//! ```
+
+use crate::completion::{completion, Pending};
+use crate::executor::VoidPromise;
+use crate::iostream::CppOutputStream;
+use crate::net::{ListenOptions, SocketAddress};
+use crate::{spawn, OutputStream, Sstring, TemporaryBuffer};
+use cxx::UniquePtr;
+use futures::future::LocalBoxFuture;
+use futures::stream::LocalBoxStream;
+use futures::{FutureExt, Stream, StreamExt, TryStreamExt};
+use std::future::Future;
+use std::io;
+use std::pin::Pin;
+use std::rc::Rc;
+use std::task::{ready, Context, Poll};
+
+#[cxx::bridge(namespace = "seastar_rs")]
+mod ffi {
+    extern "Rust" {
+        type HttpHandler;
+        type BodyWriter;
+        type RoutesFactory;
+
+        fn handle_http_request(handler: &HttpHandler, exchange: UniquePtr<CppHttpExchange>);
+        fn write_http_body(
+            writer: Box<BodyWriter>,
+            stream: UniquePtr<CppOutputStream>,
+            done: UniquePtr<VoidPromise>,
+        );
+        fn configure_routes(factory: &RoutesFactory, routes: Pin<&mut CppRoutes>);
+    }
+
+    unsafe extern "C++" {
+        include!("seastar/src/httpd.hh");
+
+        #[cxx_name = "completion"]
+        type Completion = crate::completion::Completion;
+        #[namespace = "seastar"]
+        #[cxx_name = "sstring"]
+        type Sstring = crate::Sstring;
+        #[cxx_name = "output_stream"]
+        type CppOutputStream = crate::iostream::CppOutputStream;
+        #[cxx_name = "void_promise"]
+        type VoidPromise = crate::executor::VoidPromise;
+        #[cxx_name = "SockAddr"]
+        type SockAddr = crate::net::SockAddr;
+        #[cxx_name = "ListenOptions"]
+        type ListenOptionsRepr = crate::net::ListenOptionsRepr;
+
+        #[cxx_name = "http_exchange"]
+        type CppHttpExchange;
+
+        #[namespace = "seastar::httpd"]
+        #[cxx_name = "routes"]
+        type CppRoutes;
+
+        #[cxx_name = "http_server"]
+        type CppHttpServer;
+
+        fn http_request_method(ex: &CppHttpExchange) -> &Sstring;
+        fn http_request_path(ex: &CppHttpExchange) -> &Sstring;
+        fn http_request_header(ex: &CppHttpExchange, name: &str) -> *const Sstring;
+        fn http_request_query_param(ex: &CppHttpExchange, name: &str) -> *const Sstring;
+        fn http_request_path_param(ex: &CppHttpExchange, name: &str, found: &mut bool) -> Sstring;
+        fn http_request_content_length(ex: &CppHttpExchange) -> u64;
+        fn http_request_read_body(ex: &CppHttpExchange, c: Completion);
+        fn http_reply_set_status(ex: &CppHttpExchange, status: u16);
+        fn http_reply_add_header(ex: &CppHttpExchange, name: Sstring, value: Sstring);
+        fn http_reply_write_body(ex: &CppHttpExchange, content_type: &Sstring, body: Sstring);
+        fn http_reply_write_body_stream(
+            ex: &CppHttpExchange,
+            content_type: &Sstring,
+            writer: Box<BodyWriter>,
+        );
+        fn http_exchange_finish(ex: &CppHttpExchange);
+
+        fn routes_add(
+            routes: Pin<&mut CppRoutes>,
+            method: u8,
+            path: &str,
+            handler: Box<HttpHandler>,
+        );
+
+        fn new_http_server() -> UniquePtr<CppHttpServer>;
+        fn start_http_server(server: Pin<&mut CppHttpServer>, name: &str, c: Completion);
+        fn http_server_set_routes(
+            server: &CppHttpServer,
+            factory: Box<RoutesFactory>,
+            c: Completion,
+        );
+        fn http_server_listen(
+            server: &CppHttpServer,
+            addr: &SockAddr,
+            options: &ListenOptionsRepr,
+            c: Completion,
+        );
+        fn http_server_stop(server: Pin<&mut CppHttpServer>, c: Completion);
+    }
+}
+
+type Exchange = Rc<UniquePtr<ffi::CppHttpExchange>>;
+
+// Shared with the tasks which run the handler.
+struct HttpHandler(Rc<dyn Fn(Request) -> LocalBoxFuture<'static, Response>>);
+
+struct BodyWriter(LocalBoxStream<'static, io::Result<TemporaryBuffer>>);
+
+struct RoutesFactory(Box<dyn Fn(&mut Routes<'_>) + Send + Sync>);
+
+fn handle_http_request(handler: &HttpHandler, exchange: UniquePtr<ffi::CppHttpExchange>) {
+    let exchange = Rc::new(exchange);
+    let request = Request {
+        body: RequestBody {
+            exchange: exchange.clone(),
+            read: None,
+            eof: false,
+        },
+    };
+    let handler = handler.0.clone();
+    // The handler is called inside the task, so that a panic, even before
+    // its first await, is caught by the task instead of unwinding into C++.
+    // The exchange is then dropped unfinished and the server fails the
+    // request.
+    spawn(async move {
+        handler(request).await.write_to(&exchange);
+        ffi::http_exchange_finish(&exchange);
+    });
+}
+
+// The signature is dictated by the bridge.
+#[allow(clippy::boxed_local)]
+fn write_http_body(
+    writer: Box<BodyWriter>,
+    stream: UniquePtr<CppOutputStream>,
+    mut done: UniquePtr<VoidPromise>,
+) {
+    let mut body = writer.0;
+    let mut out = OutputStream::new(stream);
+    spawn(async move {
+        let written = async {
+            // The chunked sink of a reply only supports copying writes.
+            while let Some(buf) = body.try_next().await? {
+                futures::AsyncWriteExt::write_all(&mut out, &buf).await?;
+            }
+            futures::AsyncWriteExt::close(&mut out).await
+        };
+        // The stream is released before the server learns the outcome. After
+        // a failure it is abandoned rather than closed, so that nothing, such
+        // as the last chunk, is written to the connection, which the server
+        // then drops as the reply is incomplete.
+        match written.await {
+            Ok(()) => {
+                drop(out);
+                done.pin_mut().set_value();
+            }
+            Err(error) => {
+                out.abandon();
+                done.pin_mut().set_exception(&error.to_string());
+            }
+        }
+    });
+}
+
+fn configure_routes(factory: &RoutesFactory, routes: Pin<&mut ffi::CppRoutes>) {
+    (factory.0)(&mut Routes { routes });
+}
+
+/// An HTTP method, `seastar::httpd::operation_type`.
+#[derive(Clone, Copy, Debug, PartialEq, Eq, Hash)]
+#[repr(u8)]
+pub enum Method {
+    Get = 0,
+    Post,
+    Put,
+    Delete,
+    Head,
+    Options,
+    Trace,
+    Connect,
+    Patch,
+}
+
+/// The routes of a server on one shard, `seastar::httpd::routes`.
+pub struct Routes<'a> {
+    routes: Pin<&'a mut ffi::CppRoutes>,
+}
+
+impl Routes<'_> {
+    /// Makes `handler` serve the requests with the given method and path.
+    ///
+    /// A segment of the path written as `{name}` matches any segment, which
+    /// the handler gets with [`Request::path_param`]; `{name*}` matches the
+    /// rest of the path. Other paths have to match exactly.
+    pub fn add<F, Fut>(&mut self, method: Method, path: &str, handler: F) -> &mut Self
+    where
+        F: Fn(Request) -> Fut + 'static,
+        Fut: Future<Output = Response> + 'static,
+    {
+        let handler = HttpHandler(Rc::new(move |request| handler(request).boxed_local()));
+        ffi::routes_add(self.routes.as_mut(), method as u8, path, Box::new(handler));
+        self
+    }
+}
+
+/// A request, `seastar::http::request`.
+///
+/// Its strings are borrowed from the request as Seastar parsed it. Like
+/// other strings received from C++, they are not guaranteed to be valid
+/// UTF-8.
+pub struct Request {
+    body: RequestBody,
+}
+
+impl Request {
+    fn exchange(&self) -> &ffi::CppHttpExchange {
+        &self.body.exchange
+    }
+
+    /// Returns the method, such as `GET`.
+    pub fn method(&self) -> &Sstring {
+        ffi::http_request_method(self.exchange())
+    }
+
+    /// Returns the path, without the query string.
+    pub fn path(&self) -> &Sstring {
+        ffi::http_request_path(self.exchange())
+    }
+
+    /// Returns the value of a header; names are not case sensitive.
+    pub fn header(&self, name: &str) -> Option<&Sstring> {
+        let value = ffi::http_request_header(self.exchange(), name);
+        // Safety: the value points into the request, which outlives `self`.
+        unsafe { value.as_ref() }
+    }
+
+    /// Returns the decoded value of a parameter of the query string.
+    pub fn query_param(&self, name: &str) -> Option<&Sstring> {
+        let value = ffi::http_request_query_param(self.exchange(), name);
+        // Safety: as in header().
+        unsafe { value.as_ref() }
+    }
+
+    /// Returns the segment of the path matched by `{name}` in the route,
+    /// URL-decoded and without its leading `/`.
+    pub fn path_param(&self, name: &str) -> Option<Sstring> {
+        let mut found = false;
+        let value = ffi::http_request_path_param(self.exchange(), name, &mut found);
+        found.then_some(value)
+    }
+
+    /// Returns the length of the body declared by the client.
+    pub fn content_length(&self) -> u64 {
+        ffi::http_request_content_length(self.exchange())
+    }
+
+    /// Returns the body of the request.
+    pub fn body(&mut self) -> &mut RequestBody {
+        &mut self.body
+    }
+
+    /// Takes the body of the request.
+    pub fn into_body(self) -> RequestBody {
+        self.body
+    }
+}
+
+/// The body of a [`Request`], a stream of the buffers read from the
+/// connection, which are handed over without copying.
+///
+/// The body can be read only until the handler returns its response; it is
+/// read from the connection, which carries the response and the next
+/// request afterwards.
+pub struct RequestBody {
+    exchange: Exchange,
+    read: Option<Pending>,
+    eof: bool,
+}
+
+impl Stream for RequestBody {
+    type Item = io::Result<TemporaryBuffer>;
+
+    fn poll_next(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Option<Self::Item>> {
+        let this = self.get_mut();
+        if this.eof {
+            return Poll::Ready(None);
+        }
+        let read = this.read.get_or_insert_with(|| {
+            let (c, pending) = completion();
+            ffi::http_request_read_body(&this.exchange, c);
+            pending
+        });
+        let result = ready!(Pin::new(read).poll(cx));
+        this.read = None;
+        match result {
+            // The end of the body is signalled with an empty buffer.
+            Ok(completed) => {
+                let buf = completed.into_buffer();
+                if buf.is_empty() {
+                    this.eof = true;
+                    Poll::Ready(None)
+                } else {
+                    Poll::Ready(Some(Ok(buf)))
+                }
+            }
+            Err(error) => Poll::Ready(Some(Err(error))),
+        }
+    }
+}
+
+enum BodyRepr {
+    Bytes(Sstring),
+    Stream(LocalBoxStream<'static, io::Result<TemporaryBuffer>>),
+}
+
+/// The body of a [`Response`].
+///
+/// A body held in memory is an [`Sstring`], which the reply takes over as
+/// it is; building it from `&str`, `String` or bytes copies them once,
+/// straight into the string. A streamed body is written to the connection
+/// buffer by buffer after the handler returns, each copied into the
+/// chunked encoding of the reply.
+pub struct Body(BodyRepr);
+
+impl Body {
+    /// Creates a body which streams the buffers of `stream`, sent with
+    /// chunked transfer encoding. If the stream fails, the connection is
+    /// dropped.
+    pub fn stream(stream: impl Stream<Item = io::Result<TemporaryBuffer>> + 'static) -> Self {
+        Body(BodyRepr::Stream(stream.boxed_local()))
+    }
+}
+
+impl From<Sstring> for Body {
+    fn from(body: Sstring) -> Self {
+        Body(BodyRepr::Bytes(body))
+    }
+}
+
+impl From<&str> for Body {
+    fn from(body: &str) -> Self {
+        Sstring::from(body).into()
+    }
+}
+
+impl From<String> for Body {
+    fn from(body: String) -> Self {
+        Sstring::from(body).into()
+    }
+}
+
+impl From<&[u8]> for Body {
+    fn from(body: &[u8]) -> Self {
+        Sstring::from_bytes(body).into()
+    }
+}
+
+impl From<Vec<u8>> for Body {
+    fn from(body: Vec<u8>) -> Self {
+        body.as_slice().into()
+    }
+}
+
+/// A response returned by a handler, `seastar::http::reply`.
+pub struct Response {
+    status: u16,
+    headers: Vec<(Sstring, Sstring)>,
+    body: Option<(Sstring, Body)>,
+}
+
+impl Response {
+    /// Creates a response with the given status code and no body.
+    pub fn new(status: u16) -> Self {
+        Self {
+            status,
+            headers: Vec::new(),
+            body: None,
+        }
+    }
+
+    /// Creates a `200 OK` response.
+    pub fn ok() -> Self {
+        Self::new(200)
+    }
+
+    /// Sets a header, replacing an earlier value.
+    pub fn header(mut self, name: impl Into<Sstring>, value: impl Into<Sstring>) -> Self {
+        self.headers.push((name.into(), value.into()));
+        self
+    }
+
+    /// Sets the body and its MIME type, such as `application/json`.
+    pub fn body(mut self, content_type: impl Into<Sstring>, body: impl Into<Body>) -> Self {
+        self.body = Some((content_type.into(), body.into()));
+        self
+    }
+
+    fn write_to(self, exchange: &ffi::CppHttpExchange) {
+        ffi::http_reply_set_status(exchange, self.status);
+        for (name, value) in self.headers {
+            ffi::http_reply_add_header(exchange, name, value);
+        }
+        match self.body {
+            None => {}
+            Some((content_type, Body(BodyRepr::Bytes(body)))) => {
+                ffi::http_reply_write_body(exchange, &content_type, body)
+            }
+            Some((content_type, Body(BodyRepr::Stream(stream)))) => {
+                let writer = Box::new(BodyWriter(stream));
+                ffi::http_reply_write_body_stream(exchange, &content_type, writer)
+            }
+        }
+    }
+}
+
+/// An HTTP server running on every shard, `seastar::httpd::http_server_control`.
+///
+/// The server is controlled from the shard which started it. Dropping it
+/// stops it in the background; [`HttpServer::stop`] waits for the
+/// connections to be closed.
+pub struct HttpServer {
+    server: UniquePtr<ffi::CppHttpServer>,
+}
+
+impl HttpServer {
+    /// Starts a server on every shard, without routes or listening sockets.
+    /// The name labels its metrics.
+    pub async fn start(name: &str) -> io::Result<HttpServer> {
+        let mut server = ffi::new_http_server();
+        let (c, pending) = completion();
+        ffi::start_http_server(server.pin_mut(), name, c);
+        let (result, server) = pending.keeping(server).await;
+        result?;
+        Ok(HttpServer { server })
+    }
+
+    /// Calls `configure` on every shard to add the routes of the server on
+    /// that shard.
+    pub async fn set_routes(
+        &self,
+        configure: impl Fn(&mut Routes<'_>) + Send + Sync + 'static,
+    ) -> io::Result<()> {
+        let (c, pending) = completion();
+        let factory = Box::new(RoutesFactory(Box::new(configure)));
+        ffi::http_server_set_routes(&self.server, factory, c);
+        pending.await?;
+        Ok(())
+    }
+
+    /// Listens on `addr` on every shard, with the default options.
+    pub async fn listen(&self, addr: impl Into<SocketAddress>) -> io::Result<()> {
+        self.listen_with(addr, &ListenOptions::new()).await
+    }
+
+    /// Listens on `addr` on every shard. Which shard serves a connection
+    /// depends on the network stack and `options`, see
+    /// [`crate::net::LoadBalancing`].
+    pub async fn listen_with(
+        &self,
+        addr: impl Into<SocketAddress>,
+        options: &ListenOptions,
+    ) -> io::Result<()> {
+        let (c, pending) = completion();
+        let addr: SocketAddress = addr.into();
+        ffi::http_server_listen(&self.server, &(&addr).into(), options.repr(), c);
+        pending.await?;
+        Ok(())
+    }
+
+    /// Stops the server on every shard.
+    pub async fn stop(mut self) -> io::Result<()> {
+        let (c, pending) = completion();
+        ffi::http_server_stop(self.server.pin_mut(), c);
+        pending.await?;
+        Ok(())
+    }
+}
+
+#[cfg(test)]
+async fn http_exchange(addr: SocketAddress, request: &[u8]) -> String {
+    use futures::AsyncWriteExt;
+
+    let (mut input, mut output) = crate::net::connect(addr).await.unwrap().split();
+    output.write_all(request).await.unwrap();
+    output.flush().await.unwrap();
+    let mut response = Vec::new();
+    while let Some(buf) = input.try_next().await.unwrap() {
+        response.extend_from_slice(&buf);
+    }
+    String::from_utf8(response).unwrap()
+}
+
+#[seastar::test]
+async fn test_http_server_routes() {
+    let server = HttpServer::start("test").await.unwrap();
+    server
+        .set_routes(|routes| {
+            routes
+                .add(
+                    Method::Get,
+                    "/hello/{name}",
+                    |request: Request| async move {
+                        let name = request.path_param("name").unwrap();
+                        Response::ok().body("text/plain", format!("hello {name}"))
+                    },
+                )
+                .add(Method::Post, "/echo", |mut request: Request| async move {
+                    let mut body = Vec::new();
+                    while let Some(buf) = request.body().try_next().await.unwrap() {
+                        body.extend_from_slice(&buf);
+                    }
+                    Response::ok()
+                        .header("X-Length", request.content_length().to_string())
+                        .body("application/octet-stream", body)
+                })
+                .add(Method::Get, "/stream", |_| async {
+                    let chunks =
+                        ["one", "two"].map(|chunk| Ok(TemporaryBuffer::copy_of(chunk.as_bytes())));
+                    Response::ok().body("text/plain", Body::stream(futures::stream::iter(chunks)))
+                })
+                .add(Method::Get, "/panic", |_| -> std::future::Ready<Response> {
+                    panic!("the handler failed")
+                });
+        })
+        .await
+        .unwrap();
+    let path = crate::file::temp_path("httpd");
+    let _ = std::fs::remove_file(&path);
+    server.listen(SocketAddress::unix(&path)).await.unwrap();
+    let addr = SocketAddress::unix(&path);
+
+    let response = http_exchange(
+        addr.clone(),
+        b"GET /hello/big%20world HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n",
+    )
+    .await;
+    assert!(response.starts_with("HTTP/1.1 200"), "{response}");
+    assert!(response.ends_with("\r\n\r\nhello big world"), "{response}");
+
+    let response = http_exchange(
+        addr.clone(),
+        b"POST /echo HTTP/1.1\r\nHost: localhost\r\nContent-Length: 5\r\nConnection: close\r\n\r\nhello",
+    )
+    .await;
+    assert!(response.contains("X-Length: 5"), "{response}");
+    assert!(response.ends_with("hello"), "{response}");
+
+    let response = http_exchange(
+        addr.clone(),
+        b"GET /stream HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n",
+    )
+    .await;
+    assert!(
+        response.contains("Transfer-Encoding: chunked"),
+        "{response}"
+    );
+    assert!(response.contains("one"), "{response}");
+    assert!(response.contains("two"), "{response}");
+
+    // The panic happens before the handler returns its future.
+    let response = http_exchange(
+        addr.clone(),
+        b"GET /panic HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n",
+    )
+    .await;
+    assert!(response.starts_with("HTTP/1.1 500"), "{response}");
+
+    let response = http_exchange(
+        addr,
+        b"GET /missing HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n",
+    )
+    .await;
+    assert!(response.starts_with("HTTP/1.1 404"), "{response}");
+
+    server.stop().await.unwrap();
+    std::fs::remove_file(&path).unwrap();
+}
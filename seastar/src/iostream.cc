@@ -0,0 +1,114 @@
+#include "seastar/src/iostream.hh"
+#include "seastar/src/iostream.rs.h"
+
+namespace seastar_rs {
+
+input_stream::input_stream(seastar::input_stream<char> in)
+    : _state(seastar::make_lw_shared<state>(std::move(in)))
+{}
+
+input_stream::~input_stream() {
+    if (!_state->closed) {
+        (void)_state->reads.close().then([st = _state] {
+            return st->in.close();
+        }).handle_exception([] (std::exception_ptr) {});
+    }
+}
+
+void input_stream::read(completion c) {
+    // The state has to outlive the read, even if Rust drops the stream.
+    complete_buffer(c, seastar::with_gate(_state->reads, [st = _state] {
+        return st->in.read();
+    }));
+}
+
+void input_stream::close(completion c) {
+    _state->closed = true;
+    complete_void(c, _state->reads.close().then([st = _state] {
+        return st->in.close();
+    }));
+}
+
+void input_stream_read(input_stream& in, completion c) {
+    in.read(c);
+}
+
+void input_stream_close(input_stream& in, completion c) {
+    in.close(c);
+}
+
+output_stream::output_stream(seastar::output_stream<char> out) {
+    init(std::move(out));
+}
+
+output_stream::~output_stream() {
+    if (_state && !_state->closed) {
+        (void)_state->ops.close().then([st = _state] {
+            return st->out.close();
+        }).handle_exception([] (std::exception_ptr) {});
+    }
+}
+
+void output_stream::init(seastar::output_stream<char> out) {
+    _state = seastar::make_lw_shared<state>(std::move(out));
+}
+
+void output_stream::write(rust::Slice<const uint8_t> bytes, completion c) {
+    // Small writes are copied into the stream's buffer and complete right
+    // away; the future only waits when the buffers in flight are at their
+    // limit.
+    complete_void(c, seastar::with_gate(_state->ops, [st = _state, bytes] {
+        return st->out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }));
+}
+
+void output_stream::write(temporary_buffer buf, completion c) {
+    complete_void(c, seastar::with_gate(_state->ops, [st = _state, buf = std::move(buf)] () mutable {
+        return st->out.write(std::move(buf));
+    }));
+}
+
+void output_stream::flush(completion c) {
+    complete_void(c, seastar::with_gate(_state->ops, [st = _state] {
+        return st->out.flush();
+    }));
+}
+
+void output_stream::close(completion c) {
+    _state->closed = true;
+    complete_void(c, _state->ops.close().then([st = _state] {
+        return st->out.close();
+    }));
+}
+
+void output_stream::abandon() noexcept {
+    if (_state) {
+        _state->closed = true;
+    }
+}
+
+std::unique_ptr<output_stream> new_output_stream() {
+    return std::make_unique<output_stream>();
+}
+
+void output_stream_write(output_stream& out, rust::Slice<const uint8_t> bytes, completion c) {
+    out.write(bytes, c);
+}
+
+void output_stream_write_buffer(output_stream& out, temporary_buffer buf, completion c) {
+    out.write(std::move(buf), c);
+}
+
+void output_stream_flush(output_stream& out, completion c) {
+    out.flush(c);
+}
+
+void output_stream_close(output_stream& out, completion c) {
+    out.close(c);
+}
+
+void output_stream_abandon(output_stream& out) noexcept {
+    out.abandon();
+}
+
+}
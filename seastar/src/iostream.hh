@@ -0,0 +1,71 @@
+#pragma once
+
+#include "seastar/src/completion.hh"
+
+#include <seastar/core/gate.hh>
+#include <seastar/core/iostream.hh>
+#include <seastar/core/shared_ptr.hh>
+
+#include <memory>
+
+namespace seastar_rs {
+
+// An input_stream which Rust can drop at any time. The stream is closed in
+// the background once the read in flight, if any, is done.
+class input_stream {
+    struct state {
+        seastar::input_stream<char> in;
+        seastar::gate reads;
+        bool closed = false;
+
+        explicit state(seastar::input_stream<char> in) : in(std::move(in)) {}
+    };
+    seastar::lw_shared_ptr<state> _state;
+public:
+    explicit input_stream(seastar::input_stream<char> in);
+    input_stream(const input_stream&) = delete;
+    ~input_stream();
+
+    void read(completion c);
+    void close(completion c);
+};
+
+void input_stream_read(input_stream& in, completion c);
+void input_stream_close(input_stream& in, completion c);
+
+// An output_stream which Rust can drop at any time, like input_stream.
+// It can be created empty and initialized once the stream is made.
+class output_stream {
+    struct state {
+        seastar::output_stream<char> out;
+        seastar::gate ops;
+        bool closed = false;
+
+        explicit state(seastar::output_stream<char> out) : out(std::move(out)) {}
+    };
+    seastar::lw_shared_ptr<state> _state;
+public:
+    output_stream() = default;
+    explicit output_stream(seastar::output_stream<char> out);
+    output_stream(const output_stream&) = delete;
+    ~output_stream();
+
+    void init(seastar::output_stream<char> out);
+    // The bytes are copied before write() returns.
+    void write(rust::Slice<const uint8_t> bytes, completion c);
+    void write(temporary_buffer buf, completion c);
+    void flush(completion c);
+    void close(completion c);
+    // Lets the stream be destroyed without being closed, so that nothing is
+    // written after a failure, e.g. the end of a chunked reply.
+    void abandon() noexcept;
+};
+
+std::unique_ptr<output_stream> new_output_stream();
+void output_stream_write(output_stream& out, rust::Slice<const uint8_t> bytes, completion c);
+void output_stream_write_buffer(output_stream& out, temporary_buffer buf, completion c);
+void output_stream_flush(output_stream& out, completion c);
+void output_stream_close(output_stream& out, completion c);
+void output_stream_abandon(output_stream& out) noexcept;
+
+}
@@ -0,0 +1,267 @@
+//! Byte streams, `seastar::input_stream<char>` and `seastar::output_stream<char>`.
+//!
+//! The same stream types serve files and sockets; what is behind them is
+//! chosen by whoever creates them, such as [`crate::file::File::input_stream`].
+
+use crate::completion::{completion, Pending};
+use crate::TemporaryBuffer;
+use cxx::UniquePtr;
+use futures::io::AsyncWrite;
+use futures::Stream;
+use std::future::{poll_fn, Future};
+use std::io;
+use std::pin::Pin;
+use std::task::{ready, Context, Poll};
+
+pub(crate) use ffi::{CppInputStream, CppOutputStream};
+
+#[cxx::bridge(namespace = "seastar_rs")]
+mod ffi {
+    unsafe extern "C++" {
+        include!("seastar/src/iostream.hh");
+
+        #[cxx_name = "completion"]
+        type Completion = crate::completion::Completion;
+        #[cxx_name = "temporary_buffer"]
+        type TemporaryBuffer = crate::TemporaryBuffer;
+
+        #[cxx_name = "input_stream"]
+        type CppInputStream;
+
+        #[cxx_name = "output_stream"]
+        type CppOutputStream;
+
+        fn input_stream_read(stream: Pin<&mut CppInputStream>, c: Completion);
+        fn input_stream_close(stream: Pin<&mut CppInputStream>, c: Completion);
+
+        fn new_output_stream() -> UniquePtr<CppOutputStream>;
+        fn output_stream_write(stream: Pin<&mut CppOutputStream>, bytes: &[u8], c: Completion);
+        fn output_stream_write_buffer(
+            stream: Pin<&mut CppOutputStream>,
+            buf: TemporaryBuffer,
+            c: Completion,
+        );
+        fn output_stream_flush(stream: Pin<&mut CppOutputStream>, c: Completion);
+        fn output_stream_close(stream: Pin<&mut CppOutputStream>, c: Completion);
+        fn output_stream_abandon(stream: Pin<&mut CppOutputStream>);
+    }
+
+    impl UniquePtr<CppInputStream> {}
+}
+
+/// A stream of bytes read from a file or a socket, `seastar::input_stream<char>`.
+///
+/// The stream yields the buffers of its source until the end of the data.
+/// They are handed out without copying.
+///
+/// Dropping the stream closes it in the background; [`InputStream::close`]
+/// waits for the reads in flight and reports errors.
+pub struct InputStream {
+    stream: UniquePtr<ffi::CppInputStream>,
+    read: Option<Pending>,
+    eof: bool,
+}
+
+impl InputStream {
+    pub(crate) fn new(stream: UniquePtr<ffi::CppInputStream>) -> Self {
+        Self {
+            stream,
+            read: None,
+            eof: false,
+        }
+    }
+
+    /// Closes the stream, after the reads in flight, such as read-ahead,
+    /// are done.
+    pub async fn close(mut self) -> io::Result<()> {
+        let (c, pending) = completion();
+        ffi::input_stream_close(self.stream.pin_mut(), c);
+        pending.await?;
+        Ok(())
+    }
+}
+
+impl Stream for InputStream {
+    type Item = io::Result<TemporaryBuffer>;
+
+    fn poll_next(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Option<Self::Item>> {
+        let this = self.get_mut();
+        if this.eof {
+            return Poll::Ready(None);
+        }
+        let read = this.read.get_or_insert_with(|| {
+            let (c, pending) = completion();
+            ffi::input_stream_read(this.stream.pin_mut(), c);
+            pending
+        });
+        let result = ready!(Pin::new(read).poll(cx));
+        this.read = None;
+        match result {
+            // The end of the file is signalled with an empty buffer.
+            Ok(completed) => {
+                let buf = completed.into_buffer();
+                if buf.is_empty() {
+                    this.eof = true;
+                    Poll::Ready(None)
+                } else {
+                    Poll::Ready(Some(Ok(buf)))
+                }
+            }
+            Err(error) => Poll::Ready(Some(Err(error))),
+        }
+    }
+}
+
+#[derive(Clone, Copy, PartialEq, Eq)]
+enum Op {
+    Write,
+    Flush,
+    Close,
+}
+
+/// A buffered writer of a file or a socket, `seastar::output_stream<char>`.
+///
+/// Written bytes are copied into a buffer, which is handed to the sink
+/// once it is full. Several buffers can be in flight while more bytes are
+/// written, as many as the sink allows, and a write only has to wait when
+/// all of them are.
+///
+/// Flushing writes out the buffer and waits for all buffers in flight;
+/// what else it does depends on the sink, see [`crate::file::File::output_stream`].
+/// A stream which is dropped without being closed is closed in the
+/// background, without reporting errors.
+pub struct OutputStream {
+    stream: UniquePtr<ffi::CppOutputStream>,
+    // The stream runs one operation at a time.
+    op: Option<(Op, Pending)>,
+    closed: bool,
+    // Seastar does not support mixing copying writes with zero-copy ones.
+    zero_copy: Option<bool>,
+}
+
+impl OutputStream {
+    pub(crate) fn new(stream: UniquePtr<ffi::CppOutputStream>) -> Self {
+        Self {
+            stream,
+            op: None,
+            closed: false,
+            zero_copy: None,
+        }
+    }
+
+    /// Drops the stream without closing it, not even in the background, so
+    /// that nothing more reaches the sink, e.g. after a failure which leaves
+    /// the data incomplete.
+    pub(crate) fn abandon(mut self) {
+        ffi::output_stream_abandon(self.stream.pin_mut());
+    }
+
+    /// Creates a stream which is initialized by the C++ side later, see
+    /// [`crate::file::File::output_stream`].
+    pub(crate) fn uninit() -> UniquePtr<ffi::CppOutputStream> {
+        ffi::new_output_stream()
+    }
+
+    /// Waits for the operation in flight, returning which one it was.
+    fn poll_op(&mut self, cx: &mut Context<'_>) -> Poll<io::Result<Option<Op>>> {
+        let Some((op, pending)) = &mut self.op else {
+            return Poll::Ready(Ok(None));
+        };
+        let op = *op;
+        let result = ready!(Pin::new(pending).poll(cx));
+        self.op = None;
+        if op == Op::Close {
+            self.closed = true;
+        }
+        Poll::Ready(result.map(|_| Some(op)))
+    }
+
+    /// Writes `buf` without copying it, `output_stream::write(temporary_buffer)`.
+    ///
+    /// The buffer is handed to the sink as it is, so a stream either copies
+    /// all of its writes or none: once this is called, writing through
+    /// [`AsyncWrite`] fails, and vice versa. Not every sink supports it;
+    /// the chunked body of an HTTP reply, for one, only takes copying
+    /// writes.
+    pub async fn write_buffer(&mut self, buf: TemporaryBuffer) -> io::Result<()> {
+        self.check_zero_copy(true)?;
+        poll_fn(|cx| self.poll_op(cx)).await?;
+        if self.closed {
+            return Err(closed_error());
+        }
+        // Like a copying write, the write is reported as done once it is
+        // started, and the next operation waits for it.
+        let (c, pending) = completion();
+        ffi::output_stream_write_buffer(self.stream.pin_mut(), buf, c);
+        self.op = Some((Op::Write, pending));
+        Ok(())
+    }
+
+    fn check_zero_copy(&mut self, zero_copy: bool) -> io::Result<()> {
+        if *self.zero_copy.get_or_insert(zero_copy) != zero_copy {
+            return Err(io::Error::new(
+                io::ErrorKind::InvalidInput,
+                "copying and zero-copy writes cannot be mixed in one stream",
+            ));
+        }
+        Ok(())
+    }
+
+    fn start(&mut self, op: Op, bytes: &[u8]) {
+        let (c, pending) = completion();
+        let stream = self.stream.pin_mut();
+        match op {
+            Op::Write => ffi::output_stream_write(stream, bytes, c),
+            Op::Flush => ffi::output_stream_flush(stream, c),
+            Op::Close => ffi::output_stream_close(stream, c),
+        }
+        self.op = Some((op, pending));
+    }
+
+    /// Waits for the operation in flight, then runs `op` to completion.
+    fn poll_run(&mut self, cx: &mut Context<'_>, op: Op) -> Poll<io::Result<()>> {
+        loop {
+            match ready!(self.poll_op(cx))? {
+                Some(done) if done == op => return Poll::Ready(Ok(())),
+                _ if self.closed => return Poll::Ready(Err(closed_error())),
+                Some(_) => {}
+                None => self.start(op, &[]),
+            }
+        }
+    }
+}
+
+fn closed_error() -> io::Error {
+    io::Error::new(io::ErrorKind::BrokenPipe, "the stream is closed")
+}
+
+impl AsyncWrite for OutputStream {
+    fn poll_write(
+        self: Pin<&mut Self>,
+        cx: &mut Context<'_>,
+        buf: &[u8],
+    ) -> Poll<io::Result<usize>> {
+        let this = self.get_mut();
+        this.check_zero_copy(false)?;
+        ready!(this.poll_op(cx))?;
+        if this.closed {
+            return Poll::Ready(Err(closed_error()));
+        }
+        // The bytes are copied right away, so the write is reported as done
+        // and the next operation waits for it instead.
+        this.start(Op::Write, buf);
+        Poll::Ready(Ok(buf.len()))
+    }
+
+    fn poll_flush(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<io::Result<()>> {
+        self.get_mut().poll_run(cx, Op::Flush)
+    }
+
+    fn poll_close(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<io::Result<()>> {
+        let this = self.get_mut();
+        if this.closed && this.op.is_none() {
+            return Poll::Ready(Ok(()));
+        }
+        this.poll_run(cx, Op::Close)
+    }
+}
@@ -2,6 +2,46 @@
 //!
 //! Work in progress! Definitely not for use in production yet.
 
+// Lets the procedural macros refer to `::seastar` from within this crate, too.
+extern crate self as seastar;
+
+mod app_template;
+pub mod build_config;
+pub mod chunked_fifo;
+pub mod circular_buffer;
+mod completion;
+mod execution_stage;
+mod executor;
+pub mod file;
+pub mod httpd;
+mod iostream;
+pub mod logging;
+mod lw_shared_ptr;
+pub mod memory;
+pub mod net;
+pub mod perf_tests;
 mod preempt;
+mod queue;
+mod scheduling;
+pub mod smp;
+pub mod smp_channel;
+mod sstring;
+mod task_stats;
+mod temporary_buffer;
+pub mod testing;
 
+pub use app_template::*;
+pub use chunked_fifo::ChunkedFifo;
+pub use circular_buffer::CircularBuffer;
+pub use execution_stage::*;
+pub use executor::*;
+pub use iostream::*;
+pub use lw_shared_ptr::*;
 pub use preempt::*;
+pub use queue::*;
+pub use scheduling::*;
+pub use sstring::*;
+pub use task_stats::*;
+pub use temporary_buffer::*;
+
+pub use seastar_macros::{main, perf_test, test};
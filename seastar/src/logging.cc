@@ -0,0 +1,113 @@
+#include "seastar/src/logging.hh"
+#include "seastar/src/logging.rs.h"
+
+#include <seastar/core/app-template.hh>
+#include <seastar/util/log-cli.hh>
+
+#include <algorithm>
+#include <atomic>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+namespace seastar_rs {
+
+static_assert(int(LogLevel::Error) == int(seastar::log_level::error)
+        && int(LogLevel::Warn) == int(seastar::log_level::warn)
+        && int(LogLevel::Info) == int(seastar::log_level::info)
+        && int(LogLevel::Debug) == int(seastar::log_level::debug)
+        && int(LogLevel::Trace) == int(seastar::log_level::trace),
+        "LogLevel must match seastar::log_level");
+
+static seastar::log_level to_seastar(LogLevel level) noexcept {
+    return seastar::log_level(int(level));
+}
+
+// Seastar applies --default-log-level only to the loggers which exist when
+// the reactor starts; Rust loggers created afterwards start at this level.
+static std::atomic<seastar::log_level> default_log_level = seastar::log_level::info;
+
+std::unique_ptr<seastar::logger> make_logger(rust::Str name) {
+    auto logger = std::make_unique<seastar::logger>(seastar::sstring(name.data(), name.size()));
+    logger->set_level(default_log_level.load(std::memory_order_relaxed));
+    return logger;
+}
+
+bool logger_is_enabled(const seastar::logger& logger, LogLevel level) noexcept {
+    return logger.is_enabled(to_seastar(level));
+}
+
+LogLevel logger_level(const seastar::logger& logger) noexcept {
+    return LogLevel(int(logger.level()));
+}
+
+void logger_set_level(const seastar::logger& logger, LogLevel level) noexcept {
+    // set_level() is not const, but only stores an atomic.
+    const_cast<seastar::logger&>(logger).set_level(to_seastar(level));
+}
+
+void logger_log(const seastar::logger& logger, LogLevel level, rust::Str message) noexcept {
+    const_cast<seastar::logger&>(logger).log(to_seastar(level), "{}",
+            std::string_view(message.data(), message.size()));
+}
+
+LogLevel max_enabled_log_level() {
+    auto& registry = seastar::global_logger_registry();
+    auto max = seastar::log_level::error;
+    for (auto& name : registry.get_all_logger_names()) {
+        max = std::max(max, registry.get_logger_level(name));
+    }
+    return LogLevel(int(max));
+}
+
+void remember_log_config(const seastar::app_template& app) {
+    auto settings = seastar::log_cli::extract_settings(app.options().log_opts);
+    default_log_level.store(settings.default_level, std::memory_order_relaxed);
+    log_levels_changed();
+}
+
+namespace {
+
+// Collects the output of seastar loggers into lines and passes them to Rust.
+// Every shard logs concurrently, so lines are assembled per thread; seastar
+// writes each message with a single call, so they are never interleaved.
+class rust_log_streambuf final : public std::streambuf {
+    static thread_local std::string _line;
+
+    void put(char c) {
+        if (c == '\n') {
+            forward_seastar_log_line(rust::Slice<const uint8_t>(
+                    reinterpret_cast<const uint8_t*>(_line.data()), _line.size()));
+            _line.clear();
+        } else {
+            _line.push_back(c);
+        }
+    }
+protected:
+    virtual int_type overflow(int_type c) override {
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            put(traits_type::to_char_type(c));
+        }
+        return traits_type::not_eof(c);
+    }
+    virtual std::streamsize xsputn(const char* s, std::streamsize n) override {
+        for (std::streamsize i = 0; i < n; ++i) {
+            put(s[i]);
+        }
+        return n;
+    }
+};
+
+thread_local std::string rust_log_streambuf::_line;
+
+}
+
+void forward_seastar_logs_to_rust() {
+    static rust_log_streambuf buf;
+    static std::ostream out(&buf);
+    seastar::logger::set_ostream(out);
+    seastar::logger::set_ostream_enabled(true);
+}
+
+}
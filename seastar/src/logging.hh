@@ -0,0 +1,38 @@
+#pragma once
+
+#include "rust/cxx.h"
+
+#include <seastar/util/log.hh>
+
+#include <cstdint>
+#include <memory>
+
+namespace seastar {
+
+class app_template;
+
+}
+
+namespace seastar_rs {
+
+enum class LogLevel : uint8_t;
+
+std::unique_ptr<seastar::logger> make_logger(rust::Str name);
+bool logger_is_enabled(const seastar::logger& logger, LogLevel level) noexcept;
+LogLevel logger_level(const seastar::logger& logger) noexcept;
+void logger_set_level(const seastar::logger& logger, LogLevel level) noexcept;
+void logger_log(const seastar::logger& logger, LogLevel level, rust::Str message) noexcept;
+
+// The most verbose level enabled in any logger registered with seastar.
+LogLevel max_enabled_log_level();
+
+// Records the --default-log-level of a started app_template for loggers
+// created later on, and tells Rust that seastar has applied the log levels
+// from the command line.
+void remember_log_config(const seastar::app_template& app);
+
+// Makes seastar write its log lines to forward_seastar_log_line()
+// instead of stderr.
+void forward_seastar_logs_to_rust();
+
+}
@@ -0,0 +1,618 @@
+//! Integration of Seastar's loggers with the `log` crate.
+//!
+//! [`init`] installs a `log` backend which routes records to
+//! `seastar::logger`s, one per record target, so that logs from Rust and C++
+//! end up in the same stream with the same format (including the shard id)
+//! and are configured with the same `--default-log-level` and
+//! `--logger-log-level` options. Targets which `--logger-log-level` names
+//! have to be registered with [`register_targets`] before the reactor
+//! starts, like C++ loggers, which are usually static. `tracing` events
+//! reach the backend too when the `log` feature of `tracing` is enabled.
+//!
+//! [`forward_seastar_logs`] does the opposite: it sends the lines logged by
+//! Seastar to whichever `log` backend the application uses. Only one of the
+//! two can be used in a process, since together they would send every line
+//! back to where it came from.
+
+use log::{Level, Log, Metadata, Record};
+use std::cell::{Cell, RefCell};
+use std::collections::{BTreeMap, HashMap};
+use std::fmt::{self, Write};
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::RwLock;
+use std::time::{Duration, Instant};
+
+#[doc(hidden)]
+pub use log as __log;
+
+#[cxx::bridge(namespace = "seastar_rs")]
+mod ffi {
+    #[repr(u8)]
+    enum LogLevel {
+        Error,
+        Warn,
+        Info,
+        Debug,
+        Trace,
+    }
+
+    extern "Rust" {
+        fn forward_seastar_log_line(line: &[u8]);
+        fn log_levels_changed();
+    }
+
+    unsafe extern "C++" {
+        include!("seastar/src/logging.hh");
+
+        #[namespace = "seastar"]
+        #[cxx_name = "logger"]
+        type CppLogger;
+
+        fn make_logger(name: &str) -> Result<UniquePtr<CppLogger>>;
+        fn logger_is_enabled(logger: &CppLogger, level: LogLevel) -> bool;
+        fn logger_level(logger: &CppLogger) -> LogLevel;
+        fn logger_set_level(logger: &CppLogger, level: LogLevel);
+        fn logger_log(logger: &CppLogger, level: LogLevel, message: &str);
+        fn max_enabled_log_level() -> LogLevel;
+        fn forward_seastar_logs_to_rust();
+    }
+}
+
+// Safety: seastar::logger can be used from any thread, its level is atomic
+// and its registration is protected by a lock.
+unsafe impl Send for ffi::CppLogger {}
+unsafe impl Sync for ffi::CppLogger {}
+
+fn to_ffi(level: Level) -> ffi::LogLevel {
+    match level {
+        Level::Error => ffi::LogLevel::Error,
+        Level::Warn => ffi::LogLevel::Warn,
+        Level::Info => ffi::LogLevel::Info,
+        Level::Debug => ffi::LogLevel::Debug,
+        Level::Trace => ffi::LogLevel::Trace,
+    }
+}
+
+fn from_ffi(level: ffi::LogLevel) -> Level {
+    match level {
+        ffi::LogLevel::Error => Level::Error,
+        ffi::LogLevel::Warn => Level::Warn,
+        ffi::LogLevel::Info => Level::Info,
+        ffi::LogLevel::Debug => Level::Debug,
+        _ => Level::Trace,
+    }
+}
+
+/// A `seastar::logger`.
+///
+/// Like in C++, loggers are registered under unique names, which can be
+/// used to configure their levels from the command line.
+pub struct Logger {
+    inner: cxx::UniquePtr<ffi::CppLogger>,
+}
+
+impl Logger {
+    /// Creates and registers a logger.
+    ///
+    /// Fails if a logger with the same name is already registered.
+    pub fn new(name: &str) -> Result<Self, cxx::Exception> {
+        Ok(Self {
+            inner: ffi::make_logger(name)?,
+        })
+    }
+
+    /// Returns whether messages of the given level are logged.
+    pub fn is_enabled(&self, level: Level) -> bool {
+        ffi::logger_is_enabled(&self.inner, to_ffi(level))
+    }
+
+    /// Returns the most verbose level logged by this logger.
+    pub fn level(&self) -> Level {
+        from_ffi(ffi::logger_level(&self.inner))
+    }
+
+    /// Sets the most verbose level logged by this logger.
+    ///
+    /// Records of the `log` crate are filtered by `log::max_level()` before
+    /// they reach any logger, so it is raised as well if needed.
+    pub fn set_level(&self, level: Level) {
+        ffi::logger_set_level(&self.inner, to_ffi(level));
+        LEVELS_GENERATION.fetch_add(1, Ordering::Release);
+        if level > log::max_level() {
+            log::set_max_level(level.to_level_filter());
+        }
+    }
+
+    /// Logs a message unless the level is disabled, in which case the
+    /// message is not even formatted.
+    pub fn log(&self, level: Level, args: fmt::Arguments<'_>) {
+        if self.is_enabled(level) {
+            self.log_unchecked(level, args);
+        }
+    }
+
+    /// Logs a message unless the level is disabled or the rate limit has
+    /// been exceeded. See [`RateLimit`].
+    pub fn log_rate_limited(&self, level: Level, limit: &RateLimit, args: fmt::Arguments<'_>) {
+        if !self.is_enabled(level) {
+            return;
+        }
+        match limit.check() {
+            Some(0) => self.log_unchecked(level, args),
+            Some(dropped) => self.log_unchecked(
+                level,
+                format_args!("{args} (rate limiting dropped {dropped} similar messages)"),
+            ),
+            None => {}
+        }
+    }
+
+    fn log_unchecked(&self, level: Level, args: fmt::Arguments<'_>) {
+        thread_local! {
+            static BUFFER: RefCell<String> = const { RefCell::new(String::new()) };
+        }
+        match args.as_str() {
+            Some(message) => ffi::logger_log(&self.inner, to_ffi(level), message),
+            None => BUFFER.with(|buffer| match buffer.try_borrow_mut() {
+                Ok(mut buffer) => {
+                    buffer.clear();
+                    let _ = buffer.write_fmt(args);
+                    ffi::logger_log(&self.inner, to_ffi(level), &buffer);
+                }
+                // Formatting the arguments logged something, too.
+                Err(_) => ffi::logger_log(&self.inner, to_ffi(level), &args.to_string()),
+            }),
+        }
+    }
+}
+
+/// Limits how often a message is logged, the counterpart of
+/// `seastar::logger::rate_limit`.
+///
+/// At most `burst` messages are let through per `interval`. The first
+/// message let through after some were suppressed is suffixed with their
+/// count, in the same way as in seastar. A suppressed message costs a
+/// clock read and is neither formatted nor passed to the logger.
+///
+/// A `RateLimit` is meant to be used by a single call site on a single
+/// shard, so it is not `Sync`; see [`log_rate_limited!`](crate::log_rate_limited).
+pub struct RateLimit {
+    interval: Duration,
+    burst: u32,
+    window_start: Cell<Option<Instant>>,
+    in_window: Cell<u32>,
+    dropped: Cell<u64>,
+}
+
+impl RateLimit {
+    /// Creates a limit of `burst` messages per `interval`.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `burst` is zero.
+    pub const fn new(interval: Duration, burst: u32) -> Self {
+        assert!(burst > 0, "the burst of a RateLimit must be positive");
+        Self {
+            interval,
+            burst,
+            window_start: Cell::new(None),
+            in_window: Cell::new(0),
+            dropped: Cell::new(0),
+        }
+    }
+
+    /// Checks whether a message may be logged now. If so, returns the number
+    /// of messages suppressed since the last one which was let through.
+    pub fn check(&self) -> Option<u64> {
+        let now = Instant::now();
+        match self.window_start.get() {
+            Some(start) if now.duration_since(start) < self.interval => {
+                if self.in_window.get() < self.burst {
+                    self.in_window.set(self.in_window.get() + 1);
+                    Some(self.dropped.take())
+                } else {
+                    self.dropped.set(self.dropped.get() + 1);
+                    None
+                }
+            }
+            _ => {
+                self.window_start.set(Some(now));
+                self.in_window.set(1);
+                Some(self.dropped.take())
+            }
+        }
+    }
+}
+
+/// Logs through the `log` crate, at most `burst` times per `interval` per
+/// call site and shard.
+///
+/// Meant for error paths which can fire at a high rate under overload,
+/// e.g. connection resets. Records which the `log` backend would discard,
+/// because their level is disabled for the call site's module, neither
+/// count against the limit nor reset it.
+///
+/// `interval` and `burst` must be constant expressions, because the limit
+/// of each call site is kept in a `const`-initialized thread local:
+///
+/// ```ignore
+/// seastar::log_rate_limited!(Duration::from_secs(10), 1, Level::Warn, "connection reset: {err}");
+/// ```
+#[macro_export]
+macro_rules! log_rate_limited {
+    ($interval:expr, $burst:expr, $level:expr, $($arg:tt)+) => {{
+        let level: $crate::logging::__log::Level = $level;
+        if $crate::logging::__log::log_enabled!(level) {
+            ::std::thread_local! {
+                static LIMIT: $crate::logging::RateLimit =
+                    const { $crate::logging::RateLimit::new($interval, $burst) };
+            }
+            LIMIT.with(|limit| match limit.check() {
+                ::std::option::Option::Some(0) => $crate::logging::__log::log!(level, $($arg)+),
+                ::std::option::Option::Some(dropped) => $crate::logging::__log::log!(
+                    level,
+                    "{} (rate limiting dropped {} similar messages)",
+                    ::std::format_args!($($arg)+),
+                    dropped
+                ),
+                ::std::option::Option::None => {}
+            });
+        }
+    }};
+}
+
+/// The `log` backend installed by [`init`].
+struct SeastarLog {
+    // Loggers are created on first use and live until the process exits,
+    // the same as seastar's loggers which are usually static. Logger names
+    // are global, so this map is shared by all shards; each shard looks
+    // loggers up in its own cache, see cached_logger().
+    loggers: RwLock<BTreeMap<String, &'static Logger>>,
+}
+
+static SEASTAR_LOG: SeastarLog = SeastarLog {
+    loggers: RwLock::new(BTreeMap::new()),
+};
+
+/// Whether [`forward_seastar_logs`] was called.
+static FORWARDED: AtomicBool = AtomicBool::new(false);
+
+/// Marks one direction of forwarding as used, and returns whether the other
+/// one is used too. Each side stores its own flag before it loads the other,
+/// so when both are used concurrently at least one of them notices.
+fn claim_direction(mine: &AtomicBool, other: &AtomicBool) -> bool {
+    mine.store(true, Ordering::SeqCst);
+    other.load(Ordering::SeqCst)
+}
+
+/// Whether [`init`] has installed [`SEASTAR_LOG`].
+static INSTALLED: AtomicBool = AtomicBool::new(false);
+
+/// Incremented whenever the level of a logger may have changed, so that
+/// the levels cached by the shards are refreshed.
+static LEVELS_GENERATION: AtomicU64 = AtomicU64::new(0);
+
+/// A shard's copy of the level of a logger.
+struct CachedLogger {
+    logger: &'static Logger,
+    level: Level,
+    generation: u64,
+}
+
+thread_local! {
+    static CACHED_LOGGERS: RefCell<HashMap<String, CachedLogger>> = RefCell::new(HashMap::new());
+}
+
+/// The logger used for targets whose names are taken by C++ loggers.
+const FALLBACK_LOGGER_NAME: &str = "rust";
+
+impl SeastarLog {
+    fn logger(&self, target: &str) -> &'static Logger {
+        if let Some(logger) = self.loggers.read().unwrap().get(target) {
+            return logger;
+        }
+        let mut loggers = self.loggers.write().unwrap();
+        if let Some(logger) = loggers.get(target) {
+            return logger;
+        }
+        let logger = match Logger::new(target) {
+            Ok(logger) => &*Box::leak(Box::new(logger)),
+            Err(_) if target != FALLBACK_LOGGER_NAME => {
+                drop(loggers);
+                let fallback = self.logger(FALLBACK_LOGGER_NAME);
+                loggers = self.loggers.write().unwrap();
+                fallback
+            }
+            Err(err) => panic!("cannot create the fallback logger: {err}"),
+        };
+        loggers.insert(target.to_owned(), logger);
+        logger
+    }
+
+    /// Returns the logger of `target` and its level from the current
+    /// thread's cache, so that records of disabled levels are rejected
+    /// without taking locks or calling into C++.
+    fn cached_logger(&self, target: &str) -> (&'static Logger, Level) {
+        let generation = LEVELS_GENERATION.load(Ordering::Acquire);
+        CACHED_LOGGERS.with_borrow_mut(|cache| {
+            if let Some(cached) = cache.get_mut(target) {
+                if cached.generation != generation {
+                    cached.level = cached.logger.level();
+                    cached.generation = generation;
+                }
+                return (cached.logger, cached.level);
+            }
+            let logger = self.logger(target);
+            let level = logger.level();
+            let cached = CachedLogger {
+                logger,
+                level,
+                generation,
+            };
+            cache.insert(target.to_owned(), cached);
+            (logger, level)
+        })
+    }
+}
+
+impl Log for SeastarLog {
+    fn enabled(&self, metadata: &Metadata<'_>) -> bool {
+        metadata.level() <= self.cached_logger(metadata.target()).1
+    }
+
+    fn log(&self, record: &Record<'_>) {
+        let (logger, level) = self.cached_logger(record.target());
+        if record.level() <= level {
+            logger.log_unchecked(record.level(), *record.args());
+        }
+    }
+
+    fn flush(&self) {}
+}
+
+/// Installs the `log` backend which routes records to seastar loggers.
+///
+/// Each record target, which by default is the module path, gets its own
+/// seastar logger of the same name. The backend can be installed before or
+/// after the reactor starts; `log::max_level()` is updated when the reactor
+/// applies the log levels from the command line. After changing levels
+/// through seastar itself (e.g. its REST API), call [`sync_max_level`].
+///
+/// # Panics
+///
+/// Panics if [`forward_seastar_logs`] was called.
+pub fn init() -> Result<(), log::SetLoggerError> {
+    log::set_logger(&SEASTAR_LOG)?;
+    assert!(
+        !claim_direction(&INSTALLED, &FORWARDED),
+        "logging::init() cannot be combined with forward_seastar_logs(), \
+         which would send every log line back to where it came from"
+    );
+    sync_max_level();
+    Ok(())
+}
+
+/// Creates the seastar loggers of the given targets now, instead of when
+/// the first record is logged for them.
+///
+/// Seastar applies `--logger-log-level` to the loggers which exist when the
+/// reactor starts, and refuses to start if it names an unknown logger, so
+/// targets configured on the command line have to be registered before
+/// [`AppTemplate::run`](crate::AppTemplate::run). Targets which are created
+/// later start at the `--default-log-level`.
+pub fn register_targets<'a>(targets: impl IntoIterator<Item = &'a str>) {
+    for target in targets {
+        SEASTAR_LOG.logger(target);
+    }
+}
+
+/// Updates `log::max_level()` to the most verbose level of all seastar
+/// loggers.
+///
+/// Records above `log::max_level()` are discarded by the `log` macros
+/// with a single comparison, before anything is formatted or crosses
+/// the FFI boundary. Records of other targets below it are discarded
+/// after a lookup of their level in a per-shard cache, which this
+/// refreshes as well.
+pub fn sync_max_level() {
+    LEVELS_GENERATION.fetch_add(1, Ordering::Release);
+    log::set_max_level(from_ffi(ffi::max_enabled_log_level()).to_level_filter());
+}
+
+/// Called by the C++ side once seastar has applied the log levels from the
+/// command line.
+fn log_levels_changed() {
+    if INSTALLED.load(Ordering::Relaxed) {
+        sync_max_level();
+    } else {
+        LEVELS_GENERATION.fetch_add(1, Ordering::Release);
+    }
+}
+
+thread_local! {
+    // Set while a forwarded line is handed to the `log` backend, in case the
+    // backend logs through seastar in turn.
+    static FORWARDING: Cell<bool> = const { Cell::new(false) };
+}
+
+fn is_forwarding() -> bool {
+    FORWARDING.get()
+}
+
+/// Sends the lines logged by seastar to the current `log` backend, instead
+/// of writing them to stderr. Lines are logged with the `seastar` target.
+///
+/// Must be called from inside the reactor, because starting the reactor
+/// resets seastar's log output.
+///
+/// # Panics
+///
+/// Panics if [`init`] has installed its backend, which sends records to
+/// seastar.
+pub fn forward_seastar_logs() {
+    assert!(
+        !claim_direction(&FORWARDED, &INSTALLED),
+        "forward_seastar_logs() cannot be combined with logging::init(), \
+         which would send every log line back to where it came from"
+    );
+    ffi::forward_seastar_logs_to_rust();
+}
+
+/// Splits a line formatted by seastar into its level and the rest.
+fn parse_seastar_log_line(line: &str) -> (Level, &str) {
+    let (level, rest) = line.split_once(' ').unwrap_or(("", line));
+    match level {
+        "ERROR" => (Level::Error, rest.trim_start()),
+        "WARN" => (Level::Warn, rest.trim_start()),
+        "INFO" => (Level::Info, rest.trim_start()),
+        "DEBUG" => (Level::Debug, rest.trim_start()),
+        "TRACE" => (Level::Trace, rest.trim_start()),
+        _ => (Level::Info, line),
+    }
+}
+
+fn forward_seastar_log_line(line: &[u8]) {
+    if is_forwarding() {
+        return;
+    }
+    let line = String::from_utf8_lossy(line);
+    let (level, message) = parse_seastar_log_line(&line);
+    if level > log::max_level() {
+        return;
+    }
+    FORWARDING.set(true);
+    log::logger().log(
+        &Record::builder()
+            .target("seastar")
+            .level(level)
+            .args(format_args!("{message}"))
+            .build(),
+    );
+    FORWARDING.set(false);
+}
+
+#[test]
+fn test_parse_seastar_log_line() {
+    assert_eq!(
+        parse_seastar_log_line("WARN  2024-01-01 00:00:00,000 [shard 0:main] seastar - hello"),
+        (
+            Level::Warn,
+            "2024-01-01 00:00:00,000 [shard 0:main] seastar - hello"
+        ),
+    );
+    assert_eq!(
+        parse_seastar_log_line("no level here"),
+        (Level::Info, "no level here"),
+    );
+}
+
+#[test]
+fn test_claim_direction() {
+    let to_seastar = AtomicBool::new(false);
+    let from_seastar = AtomicBool::new(false);
+    assert!(!claim_direction(&to_seastar, &from_seastar));
+    assert!(claim_direction(&from_seastar, &to_seastar));
+}
+
+#[test]
+fn test_rate_limit() {
+    let limit = RateLimit::new(Duration::from_secs(3600), 2);
+    assert_eq!(limit.check(), Some(0));
+    assert_eq!(limit.check(), Some(0));
+    assert_eq!(limit.check(), None);
+    assert_eq!(limit.check(), None);
+
+    let limit = RateLimit::new(Duration::ZERO, 1);
+    assert_eq!(limit.check(), Some(0));
+    assert_eq!(limit.check(), Some(0));
+}
+
+#[test]
+fn test_rate_limit_reports_dropped() {
+    let limit = RateLimit::new(Duration::from_millis(10), 1);
+    assert_eq!(limit.check(), Some(0));
+    assert_eq!(limit.check(), None);
+    assert_eq!(limit.check(), None);
+    std::thread::sleep(Duration::from_millis(20));
+    assert_eq!(limit.check(), Some(2));
+}
+
+/// A `log` backend which keeps the messages of the enabled records, up to
+/// `Level::Info`.
+#[cfg(test)]
+struct CapturingLog {
+    messages: std::sync::Mutex<Vec<String>>,
+}
+
+#[cfg(test)]
+impl Log for CapturingLog {
+    fn enabled(&self, metadata: &Metadata<'_>) -> bool {
+        metadata.level() <= Level::Info
+    }
+
+    fn log(&self, record: &Record<'_>) {
+        if self.enabled(record.metadata()) {
+            let message = record.args().to_string();
+            self.messages.lock().unwrap().push(message);
+        }
+    }
+
+    fn flush(&self) {}
+}
+
+// The only test which installs a `log` backend.
+#[test]
+fn test_log_rate_limited() {
+    static CAPTURE: CapturingLog = CapturingLog {
+        messages: std::sync::Mutex::new(Vec::new()),
+    };
+    log::set_logger(&CAPTURE).unwrap();
+    log::set_max_level(log::LevelFilter::Trace);
+
+    // A single call site, logged to at different levels.
+    fn log_at(level: Level, i: u32) {
+        crate::log_rate_limited!(Duration::from_secs(3600), 3, level, "rate limited {i}");
+    }
+    // Disabled records do not use up the budget.
+    for i in 0..5 {
+        log_at(Level::Trace, i);
+    }
+    for i in 0..10 {
+        log_at(Level::Info, i);
+    }
+    let messages = CAPTURE.messages.lock().unwrap();
+    let limited = messages
+        .iter()
+        .filter(|message| message.starts_with("rate limited"))
+        .collect::<Vec<_>>();
+    assert_eq!(
+        limited,
+        ["rate limited 0", "rate limited 1", "rate limited 2"]
+    );
+}
+
+#[seastar::test]
+async fn test_cached_levels_follow_changes() {
+    let target = "seastar_rs_test_cached_target";
+    let enabled =
+        |level| SEASTAR_LOG.enabled(&Metadata::builder().target(target).level(level).build());
+    let (logger, _) = SEASTAR_LOG.cached_logger(target);
+    logger.set_level(Level::Warn);
+    assert!(enabled(Level::Warn));
+    assert!(!enabled(Level::Info));
+    logger.set_level(Level::Debug);
+    assert!(enabled(Level::Debug));
+    assert!(!enabled(Level::Trace));
+}
+
+#[seastar::test]
+async fn test_logger_levels() {
+    let logger = Logger::new("seastar_rs_test_logger").unwrap();
+    logger.set_level(Level::Warn);
+    assert!(logger.is_enabled(Level::Error));
+    assert!(!logger.is_enabled(Level::Info));
+    assert_eq!(logger.level(), Level::Warn);
+    logger.set_level(Level::Trace);
+    assert!(logger.is_enabled(Level::Trace));
+    assert!(Logger::new("seastar_rs_test_logger").is_err());
+}
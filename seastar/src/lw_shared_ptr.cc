@@ -0,0 +1,58 @@
+#include "seastar/src/lw_shared_ptr.hh"
+#include "seastar/src/lw_shared_ptr.rs.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace seastar_rs {
+
+// LwSharedPtr in lw_shared_ptr.rs lays out its node as #[repr(C)] with
+// the counter followed by the value. The counter is a long, followed by
+// the owning thread's id when SEASTAR_DEBUG_SHARED_PTR is defined. Its size
+// and the offset of the value, which is measured on a live object since
+// shared_ptr_no_esft<T> is not standard-layout, are compared in
+// lw_shared_ptr.rs.
+size_t lw_shared_ptr_counter_size() {
+    return sizeof(seastar::lw_shared_ptr_counter_base);
+}
+
+template <lw_shared_with_rust T>
+static size_t value_offset() {
+    auto ptr = seastar::make_lw_shared<T>();
+    auto value = reinterpret_cast<const char*>(ptr.get());
+    auto raw = static_cast<const char*>(lw_shared_ptr_into_rust(std::move(ptr)));
+    auto offset = size_t(value - raw);
+    lw_shared_ptr_from_rust<T>(const_cast<char*>(raw));
+    return offset;
+}
+
+size_t lw_shared_ptr_value_offset_u8() {
+    return value_offset<uint8_t>();
+}
+
+size_t lw_shared_ptr_value_offset_u64() {
+    return value_offset<uint64_t>();
+}
+
+// Nodes are deleted by seastar with a sized delete-expression, which uses the
+// aligned overloads for over-aligned types; these match it.
+uint8_t* lw_shared_ptr_alloc(size_t size, size_t align) noexcept {
+    void* ptr = align > __STDCPP_DEFAULT_NEW_ALIGNMENT__
+            ? ::operator new(size, std::align_val_t(align), std::nothrow)
+            : ::operator new(size, std::nothrow);
+    if (ptr) {
+        new (ptr) seastar::lw_shared_ptr_counter_base();
+    }
+    return static_cast<uint8_t*>(ptr);
+}
+
+void lw_shared_ptr_free(uint8_t* ptr, size_t size, size_t align) noexcept {
+    if (align > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+        ::operator delete(ptr, size, std::align_val_t(align));
+    } else {
+        ::operator delete(ptr, size);
+    }
+}
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <seastar/core/shared_ptr.hh>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Conversions between seastar::lw_shared_ptr<T> and the pointers exchanged
+// with LwSharedPtr<T> in Rust (LwSharedPtr::into_raw/from_raw).
+//
+// Both sides use the same layout for the shared object, a reference count
+// followed by the value, and allocate it with the same operator new, so an
+// object created on one side can be released on the other. Since the value may be destroyed by
+// either side, it must be trivially destructible.
+
+namespace seastar_rs {
+
+template <typename T>
+concept lw_shared_with_rust = std::is_trivially_destructible_v<T>
+        && !std::is_base_of_v<seastar::enable_lw_shared_from_this<T>, T>;
+
+// Takes over the reference released by LwSharedPtr::into_raw().
+template <lw_shared_with_rust T>
+seastar::lw_shared_ptr<T> lw_shared_ptr_from_rust(void* raw) noexcept {
+    seastar::lw_shared_ptr<T> ptr;
+    static_assert(sizeof(ptr) == sizeof(raw));
+    std::memcpy(static_cast<void*>(&ptr), &raw, sizeof(raw));
+    return ptr;
+}
+
+// Releases a reference, to be taken over by LwSharedPtr::from_raw().
+template <lw_shared_with_rust T>
+void* lw_shared_ptr_into_rust(seastar::lw_shared_ptr<T> ptr) noexcept {
+    // The union keeps the pointer's destructor from dropping the reference.
+    union holder {
+        seastar::lw_shared_ptr<T> ptr;
+        ~holder() {}
+    } released{std::move(ptr)};
+    void* raw;
+    std::memcpy(&raw, static_cast<const void*>(&released.ptr), sizeof(raw));
+    return raw;
+}
+
+// The allocation functions which Rust uses for the nodes. Allocation also
+// constructs the counter, whose debug variant records the current thread.
+uint8_t* lw_shared_ptr_alloc(size_t size, size_t align) noexcept;
+void lw_shared_ptr_free(uint8_t* ptr, size_t size, size_t align) noexcept;
+
+// The size of the counter and the offset of the value in the node of a
+// seastar::lw_shared_ptr<T>, for checking that LwSharedPtr lays out its
+// nodes the same way.
+size_t lw_shared_ptr_counter_size();
+size_t lw_shared_ptr_value_offset_u8();
+size_t lw_shared_ptr_value_offset_u64();
+
+}
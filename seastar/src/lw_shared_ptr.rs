@@ -0,0 +1,296 @@
+//! A shard-local reference-counted pointer, `seastar::lw_shared_ptr`.
+
+use std::alloc::Layout;
+use std::cell::Cell;
+use std::ffi::c_long;
+use std::fmt;
+use std::marker::PhantomData;
+#[cfg(seastar_debug_shared_ptr)]
+use std::mem::MaybeUninit;
+use std::ops::Deref;
+use std::ptr::{self, NonNull};
+
+#[cxx::bridge(namespace = "seastar_rs")]
+mod ffi {
+    unsafe extern "C++" {
+        include!("seastar/src/lw_shared_ptr.hh");
+
+        fn lw_shared_ptr_alloc(size: usize, align: usize) -> *mut u8;
+        unsafe fn lw_shared_ptr_free(ptr: *mut u8, size: usize, align: usize);
+        fn lw_shared_ptr_counter_size() -> usize;
+        fn lw_shared_ptr_value_offset_u8() -> usize;
+        fn lw_shared_ptr_value_offset_u64() -> usize;
+    }
+}
+
+/// The reference count, `seastar::lw_shared_ptr_counter_base`.
+#[repr(C)]
+struct Counter {
+    count: Cell<c_long>,
+    // Debug builds of seastar keep the std::thread::id of the thread which
+    // created the counter next to it, and check it on every access. It is
+    // set by lw_shared_ptr_alloc() and never touched by Rust.
+    #[cfg(seastar_debug_shared_ptr)]
+    _owner: MaybeUninit<u64>,
+}
+
+/// The shared object. Its layout matches `seastar::shared_ptr_no_esft<T>`,
+/// which is checked by a test below.
+#[repr(C)]
+struct Node<T> {
+    counter: Counter,
+    value: T,
+}
+
+impl<T> Node<T> {
+    /// Allocates memory for a node with C++'s `operator new`, the same as
+    /// `seastar::make_lw_shared`, so that either side can free it. The
+    /// counter is constructed by C++, with a count of 0.
+    fn alloc() -> NonNull<Self> {
+        let layout = Layout::new::<Self>();
+        let raw = ffi::lw_shared_ptr_alloc(layout.size(), layout.align());
+        match NonNull::new(raw as *mut Self) {
+            Some(node) => node,
+            None => std::alloc::handle_alloc_error(layout),
+        }
+    }
+
+    /// Frees the memory of a node, whose value has been dropped or moved out.
+    ///
+    /// # Safety
+    ///
+    /// The node must come from [`Node::alloc`] or `seastar::make_lw_shared`
+    /// and must not be used afterwards.
+    unsafe fn free(node: NonNull<Self>) {
+        let layout = Layout::new::<Self>();
+        ffi::lw_shared_ptr_free(node.as_ptr() as *mut u8, layout.size(), layout.align());
+    }
+}
+
+/// A reference-counted pointer with the semantics of
+/// `seastar::lw_shared_ptr<T>`.
+///
+/// Like `Rc`, and unlike `Arc`, the reference count is not atomic, so the
+/// pointer can neither be sent to nor shared with other shards. Objects are
+/// allocated with C++'s `operator new`, like `seastar::make_lw_shared`,
+/// which is served by the shard's allocator.
+///
+/// When `T` is `Copy` (and so needs no destructor), the object can be handed
+/// over to C++ code as a `seastar::lw_shared_ptr<T>` and back, see
+/// [`LwSharedPtr::into_raw`] and `lw_shared_ptr.hh`. The C++ type must have
+/// the same layout as `T`, e.g. a `#[repr(C)]` struct or a shared struct of
+/// a cxx bridge.
+pub struct LwSharedPtr<T> {
+    node: NonNull<Node<T>>,
+    // Makes the pointer !Send and !Sync, and tells dropck that it owns a T.
+    _marker: PhantomData<(*const (), Node<T>)>,
+}
+
+impl<T> LwSharedPtr<T> {
+    /// Allocates a new object, `seastar::make_lw_shared`.
+    pub fn new(value: T) -> Self {
+        let node: NonNull<Node<T>> = Node::alloc();
+        // Safety: the memory is freshly allocated for a Node<T>, with the
+        // counter constructed, which is left as it is apart from the count.
+        unsafe {
+            let node = node.as_ptr();
+            (*node).counter.count.set(1);
+            ptr::addr_of_mut!((*node).value).write(value);
+        }
+        Self {
+            node,
+            _marker: PhantomData,
+        }
+    }
+
+    fn node(&self) -> &Node<T> {
+        // Safety: the node lives as long as there are references to it.
+        unsafe { self.node.as_ref() }
+    }
+
+    /// Returns the number of pointers to the object, `use_count()`.
+    pub fn use_count(this: &Self) -> usize {
+        this.node().counter.count.get() as usize
+    }
+
+    /// Returns whether this is the only pointer to the object, `owned()`.
+    pub fn owned(this: &Self) -> bool {
+        Self::use_count(this) == 1
+    }
+
+    /// Returns whether both pointers point to the same object.
+    pub fn ptr_eq(this: &Self, other: &Self) -> bool {
+        this.node == other.node
+    }
+
+    /// Returns a mutable reference to the object if this is the only
+    /// pointer to it.
+    pub fn get_mut(this: &mut Self) -> Option<&mut T> {
+        if Self::owned(this) {
+            // Safety: nobody else can access the object.
+            Some(unsafe { &mut this.node.as_mut().value })
+        } else {
+            None
+        }
+    }
+
+    /// Returns the object if this is the only pointer to it, or the pointer
+    /// otherwise.
+    pub fn try_unwrap(this: Self) -> Result<T, Self> {
+        if !Self::owned(&this) {
+            return Err(this);
+        }
+        let node = this.node;
+        std::mem::forget(this);
+        // Safety: this was the only reference, so the node can be moved out
+        // of and freed. Its fields need no drop other than the value.
+        unsafe {
+            let value = ptr::read(&node.as_ref().value);
+            Node::free(node);
+            Ok(value)
+        }
+    }
+}
+
+impl<T: Copy> LwSharedPtr<T> {
+    /// Releases the reference, to be taken over by C++ with
+    /// `seastar_rs::lw_shared_ptr_from_rust<T>()`, or by
+    /// [`LwSharedPtr::from_raw`].
+    pub fn into_raw(this: Self) -> *mut u8 {
+        let raw = this.node.as_ptr() as *mut u8;
+        std::mem::forget(this);
+        raw
+    }
+
+    /// Takes over a reference released by [`LwSharedPtr::into_raw`] or by
+    /// C++ with `seastar_rs::lw_shared_ptr_into_rust<T>()`.
+    ///
+    /// # Safety
+    ///
+    /// The pointer must come from one of the functions above, for the same
+    /// `T` (or a C++ type with the same layout), and the reference must not
+    /// have been taken over before. It must be used on the shard which
+    /// released it.
+    pub unsafe fn from_raw(raw: *mut u8) -> Self {
+        Self {
+            node: NonNull::new(raw as *mut Node<T>).expect("null lw_shared_ptr"),
+            _marker: PhantomData,
+        }
+    }
+}
+
+impl<T> Clone for LwSharedPtr<T> {
+    fn clone(&self) -> Self {
+        let count = &self.node().counter.count;
+        count.set(count.get() + 1);
+        Self {
+            node: self.node,
+            _marker: PhantomData,
+        }
+    }
+}
+
+impl<T> Drop for LwSharedPtr<T> {
+    fn drop(&mut self) {
+        let count = &self.node().counter.count;
+        count.set(count.get() - 1);
+        if count.get() == 0 {
+            // Safety: this was the last reference.
+            unsafe {
+                ptr::drop_in_place(self.node.as_ptr());
+                Node::free(self.node);
+            }
+        }
+    }
+}
+
+impl<T> Deref for LwSharedPtr<T> {
+    type Target = T;
+
+    fn deref(&self) -> &T {
+        &self.node().value
+    }
+}
+
+impl<T> AsRef<T> for LwSharedPtr<T> {
+    fn as_ref(&self) -> &T {
+        self
+    }
+}
+
+impl<T: Default> Default for LwSharedPtr<T> {
+    fn default() -> Self {
+        Self::new(T::default())
+    }
+}
+
+impl<T: PartialEq> PartialEq for LwSharedPtr<T> {
+    fn eq(&self, other: &Self) -> bool {
+        **self == **other
+    }
+}
+
+impl<T: Eq> Eq for LwSharedPtr<T> {}
+
+impl<T: fmt::Debug> fmt::Debug for LwSharedPtr<T> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        fmt::Debug::fmt(&**self, f)
+    }
+}
+
+impl<T: fmt::Display> fmt::Display for LwSharedPtr<T> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        fmt::Display::fmt(&**self, f)
+    }
+}
+
+#[test]
+fn test_lw_shared_ptr_counts_references() {
+    let ptr = LwSharedPtr::new(String::from("shared"));
+    assert!(LwSharedPtr::owned(&ptr));
+    let other = ptr.clone();
+    assert_eq!(LwSharedPtr::use_count(&ptr), 2);
+    assert!(LwSharedPtr::ptr_eq(&ptr, &other));
+    drop(other);
+    assert_eq!(LwSharedPtr::try_unwrap(ptr).unwrap(), "shared");
+}
+
+#[test]
+fn test_lw_shared_ptr_drops_value_once() {
+    let value = std::rc::Rc::new(());
+    let ptr = LwSharedPtr::new(value.clone());
+    let mut other = ptr.clone();
+    assert!(LwSharedPtr::get_mut(&mut other).is_none());
+    drop(ptr);
+    assert!(LwSharedPtr::get_mut(&mut other).is_some());
+    assert_eq!(std::rc::Rc::strong_count(&value), 2);
+    drop(other);
+    assert_eq!(std::rc::Rc::strong_count(&value), 1);
+}
+
+#[test]
+fn test_lw_shared_ptr_raw_round_trip() {
+    let ptr = LwSharedPtr::new(42u64);
+    let other = ptr.clone();
+    let raw = LwSharedPtr::into_raw(other);
+    // Safety: released just above.
+    let other = unsafe { LwSharedPtr::<u64>::from_raw(raw) };
+    assert_eq!(*other, 42);
+    assert_eq!(LwSharedPtr::use_count(&ptr), 2);
+}
+
+#[test]
+fn test_node_layout_matches_seastar() {
+    assert_eq!(
+        ffi::lw_shared_ptr_counter_size(),
+        std::mem::size_of::<Counter>()
+    );
+    assert_eq!(
+        ffi::lw_shared_ptr_value_offset_u8(),
+        std::mem::offset_of!(Node<u8>, value)
+    );
+    assert_eq!(
+        ffi::lw_shared_ptr_value_offset_u64(),
+        std::mem::offset_of!(Node<u64>, value)
+    );
+}
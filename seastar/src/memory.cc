@@ -0,0 +1,86 @@
+#include "seastar/src/memory.hh"
+#include "seastar/src/memory.rs.h"
+
+#include <string_view>
+
+namespace seastar_rs {
+
+Statistics memory_stats() noexcept {
+    auto stats = seastar::memory::stats();
+    return Statistics{
+        .mallocs = stats.mallocs(),
+        .frees = stats.frees(),
+        .cross_cpu_frees = stats.cross_cpu_frees(),
+        .live_objects = stats.live_objects(),
+        .free_memory = stats.free_memory(),
+        .allocated_memory = stats.allocated_memory(),
+        .total_memory = stats.total_memory(),
+        .reclaims = stats.reclaims(),
+        .large_allocations = stats.large_allocations(),
+        .failed_allocations = stats.failed_allocations(),
+        .foreign_mallocs = stats.foreign_mallocs(),
+        .foreign_frees = stats.foreign_frees(),
+        .foreign_cross_frees = stats.foreign_cross_frees(),
+    };
+}
+
+MemoryLayout memory_layout() noexcept {
+    auto layout = seastar::memory::get_memory_layout();
+    return MemoryLayout{.start = layout.start, .end = layout.end};
+}
+
+seastar::sstring memory_diagnostics_report() {
+    return seastar::memory::generate_memory_diagnostics_report();
+}
+
+void set_memory_diagnostics_producer(rust::Box<DiagnosticsProducer> producer) {
+    seastar::memory::set_additional_diagnostics_producer(
+            [producer = std::move(producer)] (memory_diagnostics_writer writer) {
+        produce_memory_diagnostics(*producer, writer);
+    });
+}
+
+void write_memory_diagnostics(memory_diagnostics_writer& writer, rust::Str text) {
+    writer(std::string_view(text.data(), text.size()));
+}
+
+std::unique_ptr<seastar::memory::reclaimer> make_reclaimer(rust::Box<ReclaimFn> reclaim, bool sync) {
+    // std::function has to be copyable.
+    auto fn = std::make_shared<rust::Box<ReclaimFn>>(std::move(reclaim));
+    auto scope = sync ? seastar::memory::reclaimer_scope::sync : seastar::memory::reclaimer_scope::async;
+    return std::make_unique<seastar::memory::reclaimer>([fn] (seastar::memory::reclaimer::request request) {
+        return run_reclaim(**fn, request.bytes_to_reclaim)
+                ? seastar::memory::reclaiming_result::reclaimed_something
+                : seastar::memory::reclaiming_result::reclaimed_nothing;
+    }, scope);
+}
+
+void set_min_free_pages(size_t pages) {
+    seastar::memory::set_min_free_pages(pages);
+}
+
+void set_large_allocation_warning_threshold(size_t threshold) {
+    seastar::memory::set_large_allocation_warning_threshold(threshold);
+}
+
+size_t get_large_allocation_warning_threshold() {
+    return seastar::memory::get_large_allocation_warning_threshold();
+}
+
+void fail_allocation_after(uint64_t count) {
+    seastar::memory::local_failure_injector().fail_after(count);
+}
+
+void cancel_allocation_failure() {
+    seastar::memory::local_failure_injector().cancel();
+}
+
+bool allocation_failure_injected() {
+    return seastar::memory::local_failure_injector().failed();
+}
+
+uint64_t allocation_points() {
+    return seastar::memory::local_failure_injector().alloc_count();
+}
+
+}
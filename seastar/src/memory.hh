@@ -0,0 +1,40 @@
+#pragma once
+
+#include "seastar/src/sstring.hh"
+
+#include <seastar/core/memory.hh>
+#include <seastar/util/alloc_failure_injector.hh>
+
+#include <memory>
+
+namespace seastar_rs {
+
+struct Statistics;
+struct MemoryLayout;
+struct DiagnosticsProducer;
+struct ReclaimFn;
+
+// cxx can only name types by identifiers.
+using memory_diagnostics_writer = seastar::memory::memory_diagnostics_writer;
+
+Statistics memory_stats() noexcept;
+MemoryLayout memory_layout() noexcept;
+seastar::sstring memory_diagnostics_report();
+void set_memory_diagnostics_producer(rust::Box<DiagnosticsProducer> producer);
+void write_memory_diagnostics(memory_diagnostics_writer& writer, rust::Str text);
+
+// Registers the function with the allocator until the reclaimer is destroyed.
+std::unique_ptr<seastar::memory::reclaimer> make_reclaimer(rust::Box<ReclaimFn> reclaim, bool sync);
+void set_min_free_pages(size_t pages);
+
+void set_large_allocation_warning_threshold(size_t threshold);
+size_t get_large_allocation_warning_threshold();
+
+// seastar::memory::local_failure_injector(), which does nothing unless
+// seastar is built with SEASTAR_ENABLE_ALLOC_FAILURE_INJECTION.
+void fail_allocation_after(uint64_t count);
+void cancel_allocation_failure();
+bool allocation_failure_injected();
+uint64_t allocation_points();
+
+}
@@ -0,0 +1,406 @@
+//! The memory allocator of the current shard, `seastar::memory`.
+//!
+//! Unless seastar is built with the default allocator (see
+//! [`build_config::DEFAULT_ALLOCATOR`](crate::build_config::DEFAULT_ALLOCATOR)),
+//! `malloc` and thus Rust's global allocator are served by Seastar's
+//! per-shard allocator, so everything here covers allocations made by Rust
+//! code as well. With the default allocator the statistics are all zero.
+
+use crate::Sstring;
+use cxx::UniquePtr;
+use std::cell::RefCell;
+use std::fmt;
+use std::pin::Pin;
+
+#[cxx::bridge(namespace = "seastar_rs")]
+mod ffi {
+    /// Allocator statistics of a shard, `seastar::memory::statistics`.
+    ///
+    /// The counters are cumulative since the shard started.
+    #[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+    struct Statistics {
+        /// Allocations made on this shard.
+        mallocs: u64,
+        /// Allocations freed on this shard, wherever they were made.
+        frees: u64,
+        /// Frees of memory which belongs to another shard. Such memory is
+        /// sent back to its shard, which is much slower than a local free.
+        cross_cpu_frees: u64,
+        /// Allocations which are currently live.
+        live_objects: u64,
+        /// Bytes which are not allocated.
+        free_memory: u64,
+        /// Bytes which are allocated.
+        allocated_memory: u64,
+        /// Bytes which the shard owns.
+        total_memory: u64,
+        /// Times the allocator ran the reclaimers to free memory.
+        reclaims: u64,
+        /// Allocations above the large allocation warning threshold.
+        large_allocations: u64,
+        /// Allocations which failed.
+        failed_allocations: u64,
+        /// Allocations made by threads which are not shards.
+        foreign_mallocs: u64,
+        /// Frees of foreign allocations made by threads which are not shards.
+        foreign_frees: u64,
+        /// Frees of foreign allocations made by shards.
+        foreign_cross_frees: u64,
+    }
+
+    /// The range of addresses of a shard's memory,
+    /// `seastar::memory::memory_layout`.
+    #[derive(Clone, Copy, Debug, PartialEq, Eq)]
+    struct MemoryLayout {
+        start: usize,
+        end: usize,
+    }
+
+    extern "Rust" {
+        type DiagnosticsProducer;
+        type ReclaimFn;
+
+        fn produce_memory_diagnostics(
+            producer: &DiagnosticsProducer,
+            writer: Pin<&mut CppDiagnosticsWriter>,
+        );
+        fn run_reclaim(reclaim: &ReclaimFn, bytes_to_reclaim: usize) -> bool;
+    }
+
+    unsafe extern "C++" {
+        include!("seastar/src/memory.hh");
+
+        #[namespace = "seastar"]
+        #[cxx_name = "sstring"]
+        type Sstring = crate::Sstring;
+
+        #[cxx_name = "memory_diagnostics_writer"]
+        type CppDiagnosticsWriter;
+
+        #[namespace = "seastar::memory"]
+        #[cxx_name = "reclaimer"]
+        type CppReclaimer;
+
+        fn memory_stats() -> Statistics;
+        fn memory_layout() -> MemoryLayout;
+        fn memory_diagnostics_report() -> Sstring;
+        fn set_memory_diagnostics_producer(producer: Box<DiagnosticsProducer>);
+        fn write_memory_diagnostics(writer: Pin<&mut CppDiagnosticsWriter>, text: &str);
+        fn make_reclaimer(reclaim: Box<ReclaimFn>, sync: bool) -> UniquePtr<CppReclaimer>;
+        fn set_min_free_pages(pages: usize);
+
+        fn set_large_allocation_warning_threshold(threshold: usize);
+        fn get_large_allocation_warning_threshold() -> usize;
+
+        fn fail_allocation_after(count: u64);
+        fn cancel_allocation_failure();
+        fn allocation_failure_injected() -> bool;
+        fn allocation_points() -> u64;
+    }
+}
+
+pub use ffi::{MemoryLayout, Statistics};
+
+/// Returns the allocator statistics of the current shard,
+/// `seastar::memory::stats()`.
+pub fn stats() -> Statistics {
+    ffi::memory_stats()
+}
+
+/// Returns the range of addresses of the current shard's memory,
+/// `seastar::memory::get_memory_layout()`.
+pub fn memory_layout() -> MemoryLayout {
+    ffi::memory_layout()
+}
+
+/// Generates the report which Seastar logs when an allocation fails:
+/// the allocator's state, its pools and the output of the diagnostics
+/// producer, `seastar::memory::generate_memory_diagnostics_report()`.
+pub fn diagnostics_report() -> Sstring {
+    ffi::memory_diagnostics_report()
+}
+
+/// Writes lines into the memory diagnostics report, see
+/// [`set_diagnostics_producer`].
+///
+/// It implements [`fmt::Write`], so `write!` formats straight into the
+/// report without allocating.
+pub struct DiagnosticsWriter<'a> {
+    writer: Pin<&'a mut ffi::CppDiagnosticsWriter>,
+}
+
+impl DiagnosticsWriter<'_> {
+    /// Appends text to the report.
+    pub fn write(&mut self, text: &str) {
+        ffi::write_memory_diagnostics(self.writer.as_mut(), text);
+    }
+}
+
+impl fmt::Write for DiagnosticsWriter<'_> {
+    fn write_str(&mut self, s: &str) -> fmt::Result {
+        self.write(s);
+        Ok(())
+    }
+}
+
+struct DiagnosticsProducer(Box<dyn Fn(&mut DiagnosticsWriter<'_>)>);
+
+fn produce_memory_diagnostics(
+    producer: &DiagnosticsProducer,
+    writer: Pin<&mut ffi::CppDiagnosticsWriter>,
+) {
+    (producer.0)(&mut DiagnosticsWriter { writer })
+}
+
+/// Sets a function which adds the application's own state, e.g. the sizes
+/// of its caches, to the memory diagnostics report of the current shard,
+/// `seastar::memory::set_additional_diagnostics_producer()`.
+///
+/// The report is mostly generated when an allocation has just failed, so
+/// the function should not allocate; lines should end with `'\n'`.
+pub fn set_diagnostics_producer(producer: impl Fn(&mut DiagnosticsWriter<'_>) + 'static) {
+    ffi::set_memory_diagnostics_producer(Box::new(DiagnosticsProducer(Box::new(producer))));
+}
+
+/// When the allocator calls a [`Reclaimer`], `seastar::memory::reclaimer_scope`.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum ReclaimerScope {
+    /// From a task, once the free memory of the shard drops below its
+    /// minimum (see [`set_min_free_pages`]). The function may allocate.
+    Async,
+    /// Synchronously, from within an allocation which cannot be satisfied.
+    /// The function must not allocate, and should be quick.
+    Sync,
+}
+
+/// The outcome of a reclaim, `seastar::memory::reclaiming_result`.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum ReclaimingResult {
+    ReclaimedNothing,
+    ReclaimedSomething,
+}
+
+struct ReclaimFn(RefCell<Box<dyn FnMut(usize) -> ReclaimingResult>>);
+
+fn run_reclaim(reclaim: &ReclaimFn, bytes_to_reclaim: usize) -> bool {
+    // Memory freed by the function may be needed by an allocation made by
+    // the function itself, which then must not run it again.
+    let Ok(mut reclaim) = reclaim.0.try_borrow_mut() else {
+        return false;
+    };
+    reclaim(bytes_to_reclaim) == ReclaimingResult::ReclaimedSomething
+}
+
+/// Lets the allocator of the current shard ask a cache to free memory,
+/// `seastar::memory::reclaimer`.
+///
+/// A cache which grows into all of the spare memory of its shard registers
+/// a reclaimer, whose function evicts entries when the shard runs low on
+/// memory. The function is passed the number of bytes which the allocator
+/// is short of; freeing less is fine, it is called again if needed.
+///
+/// The reclaimer is unregistered when it is dropped. It belongs to the
+/// shard which created it. With the default allocator it is never called.
+pub struct Reclaimer {
+    _reclaimer: UniquePtr<ffi::CppReclaimer>,
+}
+
+impl Reclaimer {
+    /// Registers `reclaim` with the allocator.
+    pub fn new(
+        scope: ReclaimerScope,
+        reclaim: impl FnMut(usize) -> ReclaimingResult + 'static,
+    ) -> Self {
+        let reclaim = Box::new(ReclaimFn(RefCell::new(Box::new(reclaim))));
+        Self {
+            _reclaimer: ffi::make_reclaimer(reclaim, scope == ReclaimerScope::Sync),
+        }
+    }
+}
+
+/// Sets the number of free pages below which the current shard runs its
+/// asynchronous reclaimers, `seastar::memory::set_min_free_pages()`.
+pub fn set_min_free_pages(pages: usize) {
+    ffi::set_min_free_pages(pages)
+}
+
+/// Sets the size from which allocations on the current shard are logged
+/// with a backtrace and counted in [`Statistics::large_allocations`],
+/// `seastar::memory::set_large_allocation_warning_threshold()`.
+///
+/// Large contiguous allocations fragment the allocator's memory and can
+/// fail even when there is enough free memory in total.
+pub fn set_large_allocation_warning_threshold(bytes: usize) {
+    ffi::set_large_allocation_warning_threshold(bytes)
+}
+
+/// Returns the large allocation warning threshold of the current shard.
+pub fn large_allocation_warning_threshold() -> usize {
+    ffi::get_large_allocation_warning_threshold()
+}
+
+/// Turns off the large allocation warning on the current shard.
+pub fn disable_large_allocation_warning() {
+    set_large_allocation_warning_threshold(usize::MAX)
+}
+
+/// Changes the large allocation warning threshold of the current shard
+/// until it is dropped, `seastar::memory::scoped_large_allocation_warning_threshold`.
+///
+/// Useful around code which is known to allocate a lot at once, e.g. with
+/// [`usize::MAX`] to silence the warning there.
+pub struct ScopedLargeAllocationWarningThreshold {
+    previous: usize,
+}
+
+impl ScopedLargeAllocationWarningThreshold {
+    /// Sets the threshold to `bytes`.
+    pub fn new(bytes: usize) -> Self {
+        let previous = large_allocation_warning_threshold();
+        set_large_allocation_warning_threshold(bytes);
+        Self { previous }
+    }
+}
+
+impl Drop for ScopedLargeAllocationWarningThreshold {
+    fn drop(&mut self) {
+        set_large_allocation_warning_threshold(self.previous);
+    }
+}
+
+/// Makes the allocation after the next `count` ones on the current shard
+/// fail, `alloc_failure_injector::fail_after()`.
+///
+/// The failure is injected into all allocations, not only into Rust's
+/// fallible ones: Rust aborts when an infallible allocation fails, so only
+/// code which handles allocation errors (`try_reserve` and the like)
+/// should run while a failure is pending.
+///
+/// Does nothing unless seastar is built with allocation failure injection,
+/// see [`ALLOC_FAILURE_INJECTION`](crate::build_config::ALLOC_FAILURE_INJECTION).
+pub fn fail_allocation_after(count: u64) {
+    ffi::fail_allocation_after(count)
+}
+
+/// Cancels a pending allocation failure.
+pub fn cancel_allocation_failure() {
+    ffi::cancel_allocation_failure()
+}
+
+/// Returns whether an allocation failure has been injected since the last
+/// call to [`fail_allocation_after`].
+pub fn allocation_failure_injected() -> bool {
+    ffi::allocation_failure_injected()
+}
+
+/// Returns the number of allocations counted by the failure injector of
+/// the current shard.
+pub fn allocation_points() -> u64 {
+    ffi::allocation_points()
+}
+
+/// Runs `func` once for every allocation it makes, failing that
+/// allocation, and then once more without failures,
+/// `seastar::memory::with_allocation_failures()`.
+///
+/// This checks deterministically that each allocation error is handled.
+/// See [`fail_allocation_after`] for the caveats. Without allocation
+/// failure injection, `func` runs once.
+pub fn with_allocation_failures(mut func: impl FnMut()) {
+    let mut count = 0;
+    loop {
+        fail_allocation_after(count);
+        func();
+        let failed = allocation_failure_injected();
+        cancel_allocation_failure();
+        if !failed {
+            return;
+        }
+        count += 1;
+    }
+}
+
+#[seastar::test]
+async fn test_memory_stats_count_rust_allocations() {
+    if crate::build_config::DEFAULT_ALLOCATOR {
+        return;
+    }
+    let before = stats();
+    let boxed = std::hint::black_box(Box::new([0u8; 100]));
+    let after = stats();
+    assert!(after.mallocs > before.mallocs);
+    assert!(after.free_memory + after.allocated_memory <= after.total_memory);
+    let layout = memory_layout();
+    let address = &*boxed as *const u8 as usize;
+    assert!(layout.start <= address && address < layout.end);
+}
+
+#[seastar::test]
+async fn test_memory_diagnostics_producer() {
+    set_diagnostics_producer(|writer| {
+        use std::fmt::Write;
+        let _ = writeln!(writer, "rust cache: {} entries", 42);
+    });
+    let report = diagnostics_report();
+    assert!(report.to_string_lossy().contains("rust cache: 42 entries"));
+}
+
+#[seastar::test]
+async fn test_reclaimer_registration() {
+    // Reclaimers are unregistered when dropped, in any order.
+    let _sync = Reclaimer::new(ReclaimerScope::Sync, |_| ReclaimingResult::ReclaimedNothing);
+    {
+        let _async = Reclaimer::new(ReclaimerScope::Async, |_| {
+            ReclaimingResult::ReclaimedNothing
+        });
+    }
+    let _another = Reclaimer::new(ReclaimerScope::Async, |_| {
+        ReclaimingResult::ReclaimedNothing
+    });
+}
+
+#[test]
+fn test_reclaim_is_not_reentered() {
+    use std::rc::Rc;
+
+    let inner: Rc<RefCell<Option<Rc<ReclaimFn>>>> = Rc::default();
+    let nested = inner.clone();
+    let reclaim = Rc::new(ReclaimFn(RefCell::new(Box::new(move |bytes| {
+        // An allocation made while reclaiming must not run the function again.
+        let this = nested.borrow().clone().unwrap();
+        assert!(!run_reclaim(&this, bytes));
+        ReclaimingResult::ReclaimedSomething
+    }))));
+    *inner.borrow_mut() = Some(reclaim.clone());
+    assert!(run_reclaim(&reclaim, 4096));
+    inner.borrow_mut().take();
+}
+
+#[seastar::test]
+async fn test_scoped_large_allocation_warning_threshold() {
+    let threshold = large_allocation_warning_threshold();
+    {
+        let _scoped = ScopedLargeAllocationWarningThreshold::new(1 << 30);
+        assert_eq!(large_allocation_warning_threshold(), 1 << 30);
+    }
+    assert_eq!(large_allocation_warning_threshold(), threshold);
+}
+
+#[seastar::test]
+async fn test_with_allocation_failures() {
+    let mut runs = 0;
+    let mut failures = 0;
+    with_allocation_failures(|| {
+        runs += 1;
+        let mut vec = Vec::<u8>::new();
+        if vec.try_reserve(1000).is_err() {
+            failures += 1;
+        }
+    });
+    if crate::build_config::ALLOC_FAILURE_INJECTION {
+        assert!(failures > 0);
+        assert_eq!(runs, failures + 1);
+    } else {
+        assert_eq!(runs, 1);
+    }
+}
@@ -0,0 +1,405 @@
+#include "seastar/src/net.hh"
+#include "seastar/src/net.rs.h"
+
+#include <seastar/core/loop.hh>
+#include <seastar/core/posix.hh>
+#include <seastar/net/unix_address.hh>
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <system_error>
+
+namespace seastar_rs {
+
+seastar::socket_address to_socket_address(const SockAddr& addr) {
+    if (addr.family == AddressFamily::Unix) {
+        return seastar::socket_address(seastar::unix_domain_addr(std::string(addr.path.begin(), addr.path.end())));
+    }
+    if (addr.family == AddressFamily::Inet6) {
+        ::sockaddr_in6 sa{};
+        sa.sin6_family = AF_INET6;
+        sa.sin6_port = htons(addr.port);
+        sa.sin6_flowinfo = htonl(addr.flowinfo);
+        sa.sin6_scope_id = addr.scope_id;
+        std::memcpy(&sa.sin6_addr, addr.ip.data(), 16);
+        return seastar::socket_address(sa);
+    }
+    ::sockaddr_in sa{};
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(addr.port);
+    std::memcpy(&sa.sin_addr, addr.ip.data(), 4);
+    return seastar::socket_address(sa);
+}
+
+SockAddr from_socket_address(const seastar::socket_address& addr) {
+    SockAddr result{};
+    result.family = AddressFamily::Inet;
+    if (addr.family() == AF_UNIX) {
+        result.family = AddressFamily::Unix;
+        const auto& sa = addr.u.un;
+        auto offset = offsetof(::sockaddr_un, sun_path);
+        size_t len = addr.addr_length > offset ? addr.addr_length - offset : 0;
+        // The length of a path in the filesystem may count its terminating
+        // NUL, while names in the abstract namespace start with one.
+        if (len > 0 && sa.sun_path[0] != '\0') {
+            len = ::strnlen(sa.sun_path, len);
+        }
+        result.path.reserve(len);
+        for (size_t i = 0; i < len; ++i) {
+            result.path.push_back(static_cast<uint8_t>(sa.sun_path[i]));
+        }
+    } else if (addr.family() == AF_INET6) {
+        const auto& sa = addr.as_posix_sockaddr_in6();
+        result.family = AddressFamily::Inet6;
+        result.port = ntohs(sa.sin6_port);
+        result.flowinfo = ntohl(sa.sin6_flowinfo);
+        result.scope_id = sa.sin6_scope_id;
+        std::memcpy(result.ip.data(), &sa.sin6_addr, 16);
+    } else if (addr.family() == AF_INET) {
+        const auto& sa = addr.as_posix_sockaddr_in();
+        result.port = ntohs(sa.sin_port);
+        std::memcpy(result.ip.data(), &sa.sin_addr, 4);
+    }
+    return result;
+}
+
+std::unique_ptr<seastar::connected_socket> new_connected_socket() {
+    return std::make_unique<seastar::connected_socket>();
+}
+
+void connect_socket(const SockAddr& addr, seastar::connected_socket& socket, completion c) {
+    auto connected = seastar::futurize_invoke([&] {
+        return seastar::connect(to_socket_address(addr));
+    });
+    // The Rust side keeps the socket alive until the completion is resolved.
+    complete_void(c, connected.then([&socket] (seastar::connected_socket connected) {
+        socket = std::move(connected);
+    }));
+}
+
+SockAddr connected_socket_local_address(const seastar::connected_socket& socket) {
+    return from_socket_address(socket.local_address());
+}
+
+// Runs an operation which fails synchronously and returns the errno of its
+// failure, or 0.
+template <typename Func>
+static int errno_of(Func&& func) noexcept {
+    try {
+        func();
+        return 0;
+    } catch (const std::system_error& e) {
+        return e.code().category() == std::system_category() ? e.code().value() : EINVAL;
+    } catch (...) {
+        return EINVAL;
+    }
+}
+
+int connected_socket_set_nodelay(seastar::connected_socket& socket, bool nodelay) noexcept {
+    return errno_of([&] {
+        socket.set_nodelay(nodelay);
+    });
+}
+
+int connected_socket_set_keepalive(seastar::connected_socket& socket, bool keepalive) noexcept {
+    return errno_of([&] {
+        socket.set_keepalive(keepalive);
+    });
+}
+
+int connected_socket_set_keepalive_parameters(seastar::connected_socket& socket,
+        uint64_t idle_secs, uint64_t interval_secs, uint32_t count) noexcept {
+    return errno_of([&] {
+        socket.set_keepalive_parameters(seastar::net::tcp_keepalive_params{
+            std::chrono::seconds(idle_secs), std::chrono::seconds(interval_secs), count});
+    });
+}
+
+int connected_socket_set_buffer_size(seastar::connected_socket& socket, bool send, int32_t size) noexcept {
+    return errno_of([&] {
+        socket.set_sockopt(SOL_SOCKET, send ? SO_SNDBUF : SO_RCVBUF, &size, sizeof(size));
+    });
+}
+
+int connected_socket_get_nodelay(const seastar::connected_socket& socket, bool& nodelay) noexcept {
+    return errno_of([&] {
+        nodelay = socket.get_nodelay();
+    });
+}
+
+int connected_socket_get_keepalive(const seastar::connected_socket& socket, bool& keepalive) noexcept {
+    return errno_of([&] {
+        keepalive = socket.get_keepalive();
+    });
+}
+
+int connected_socket_get_buffer_size(const seastar::connected_socket& socket, bool send, int32_t& size) noexcept {
+    return errno_of([&] {
+        socket.get_sockopt(SOL_SOCKET, send ? SO_SNDBUF : SO_RCVBUF, &size, sizeof(size));
+    });
+}
+
+std::unique_ptr<input_stream> connected_socket_input(seastar::connected_socket& socket) {
+    return std::make_unique<input_stream>(socket.input());
+}
+
+std::unique_ptr<output_stream> connected_socket_output(seastar::connected_socket& socket) {
+    return std::make_unique<output_stream>(socket.output());
+}
+
+listener::~listener() {
+    if (_state) {
+        _state->socket.abort_accept();
+        (void)_state->accepts.close().finally([st = _state] {});
+    }
+}
+
+seastar::listen_options to_listen_options(const ListenOptions& options) {
+    seastar::listen_options opts;
+    opts.reuse_address = options.reuse_address;
+    opts.listen_backlog = options.listen_backlog;
+    opts.proto = options.proto == Transport::Sctp ? seastar::transport::SCTP : seastar::transport::TCP;
+    using lba = seastar::server_socket::load_balancing_algorithm;
+    switch (options.lba) {
+    case LoadBalancingAlgorithm::ConnectionDistribution:
+        opts.lba = lba::connection_distribution;
+        break;
+    case LoadBalancingAlgorithm::Port:
+        opts.lba = lba::port;
+        break;
+    case LoadBalancingAlgorithm::Fixed:
+        opts.set_fixed_cpu(options.fixed_cpu);
+        break;
+    default:
+        break;
+    }
+    return opts;
+}
+
+void listener::listen(const SockAddr& addr, const ListenOptions& options) {
+    _state = seastar::make_lw_shared<state>(seastar::listen(to_socket_address(addr), to_listen_options(options)));
+}
+
+SockAddr listener::local_address() const {
+    return from_socket_address(_state->socket.local_address());
+}
+
+void listener::accept(seastar::connected_socket& socket, SockAddr& remote, completion c) const {
+    // The Rust side keeps the socket and the address alive until the
+    // completion is resolved.
+    complete_void(c, seastar::with_gate(_state->accepts, [st = _state, &socket, &remote] {
+        return st->socket.accept().then([&socket, &remote] (seastar::accept_result accepted) {
+            socket = std::move(accepted.connection);
+            remote = from_socket_address(accepted.remote_address);
+        });
+    }));
+}
+
+std::unique_ptr<listener> new_listener() {
+    return std::make_unique<listener>();
+}
+
+void make_listener(listener& l, const SockAddr& addr, const ListenOptions& options, completion c) {
+    // Listening fails synchronously, the completion carries the errno.
+    complete_void(c, seastar::futurize_invoke([&] {
+        l.listen(addr, options);
+    }));
+}
+
+SockAddr listener_local_address(const listener& l) {
+    return l.local_address();
+}
+
+void listener_accept(const listener& l, seastar::connected_socket& socket, SockAddr& remote, completion c) {
+    l.accept(socket, remote, c);
+}
+
+// Datagrams are received into scratch buffers which can hold the largest
+// possible datagram, and copied into buffers of their own size, so that a
+// small datagram does not pin 64 KiB.
+static constexpr size_t max_datagram_size = 64 * 1024;
+
+static_assert(UIO_MAXIOV == 1024, "MAX_UDP_BATCH in net.rs must match UIO_MAXIOV");
+
+bool udp_channel::state::receive_now(rust::Vec<DatagramSlot>& slots, size_t max) {
+    while (scratch.size() < max) {
+        scratch.push_back(std::make_unique<char[]>(max_datagram_size));
+    }
+    std::vector<::mmsghdr> msgs(max);
+    std::vector<::iovec> iovs(max);
+    std::vector<seastar::socket_address> srcs(max);
+    for (size_t i = 0; i < max; ++i) {
+        iovs[i] = {scratch[i].get(), max_datagram_size};
+        auto& hdr = msgs[i].msg_hdr;
+        hdr.msg_iov = &iovs[i];
+        hdr.msg_iovlen = 1;
+        hdr.msg_name = &srcs[i].u.sas;
+        hdr.msg_namelen = sizeof(srcs[i].u.sas);
+    }
+    int n = ::recvmmsg(fd.get_file_desc().get(), msgs.data(), max, MSG_DONTWAIT, nullptr);
+    if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return false;
+        }
+        throw std::system_error(errno, std::system_category(), "recvmmsg");
+    }
+    for (int i = 0; i < n; ++i) {
+        srcs[i].addr_length = msgs[i].msg_hdr.msg_namelen;
+        slots.push_back(DatagramSlot{
+            temporary_buffer(scratch[i].get(), msgs[i].msg_len),
+            from_socket_address(srcs[i]),
+            from_socket_address(local),
+        });
+    }
+    return true;
+}
+
+namespace {
+
+struct outgoing {
+    std::vector<seastar::socket_address> dsts;
+    std::vector<size_t> lens;
+    temporary_buffer data;
+    // The first datagram which was not sent yet, and where it starts.
+    size_t next = 0;
+    size_t offset = 0;
+
+    // Returns true once all datagrams are sent, false if the socket is
+    // full.
+    bool send_now(int fd) {
+        while (next < dsts.size()) {
+            size_t count = std::min<size_t>(dsts.size() - next, UIO_MAXIOV);
+            std::vector<::mmsghdr> msgs(count);
+            std::vector<::iovec> iovs(count);
+            size_t pos = offset;
+            for (size_t i = 0; i < count; ++i) {
+                auto& dst = dsts[next + i];
+                iovs[i] = {const_cast<char*>(data.get()) + pos, lens[next + i]};
+                pos += lens[next + i];
+                auto& hdr = msgs[i].msg_hdr;
+                hdr.msg_iov = &iovs[i];
+                hdr.msg_iovlen = 1;
+                hdr.msg_name = &dst.u.sas;
+                hdr.msg_namelen = dst.length();
+            }
+            int n = ::sendmmsg(fd, msgs.data(), count, MSG_DONTWAIT);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    return false;
+                }
+                throw std::system_error(errno, std::system_category(), "sendmmsg");
+            }
+            for (int i = 0; i < n; ++i) {
+                offset += lens[next++];
+            }
+        }
+        return true;
+    }
+};
+
+}
+
+udp_channel::~udp_channel() {
+    if (_state) {
+        _state->fd.abort_reader();
+        (void)_state->ops.close().then([st = _state] {
+            st->fd.close();
+        });
+    }
+}
+
+void udp_channel::bind(const SockAddr& addr) {
+    auto sa = to_socket_address(addr);
+    auto fd = seastar::file_desc::socket(sa.family(), SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    fd.bind(sa.u.sa, sa.length());
+    auto local = fd.get_address();
+    _state = seastar::make_lw_shared<state>(seastar::pollable_fd(std::move(fd)), local);
+}
+
+SockAddr udp_channel::local_address() const {
+    return from_socket_address(_state->local);
+}
+
+void udp_channel::receive(rust::Vec<DatagramSlot>& slots, size_t max, completion c) const {
+    // The Rust side keeps the slots alive until the completion is resolved.
+    max = std::min<size_t>(max, UIO_MAXIOV);
+    complete_void(c, seastar::with_gate(_state->ops, [st = _state, &slots, max] {
+        return seastar::repeat([st, &slots, max] {
+            return st->fd.readable().then([st, &slots, max] {
+                return seastar::stop_iteration(st->receive_now(slots, max));
+            });
+        });
+    }));
+}
+
+void udp_channel::send(std::vector<seastar::socket_address> dsts, std::vector<size_t> lens, temporary_buffer data, bool borrowed,
+        completion c) const {
+    auto out = seastar::make_lw_shared<outgoing>(outgoing{std::move(dsts), std::move(lens), std::move(data)});
+    // Sockets usually have room for the datagrams, so try before the data
+    // has to outlive this call.
+    try {
+        if (out->send_now(_state->fd.get_file_desc().get())) {
+            complete_void(c, seastar::make_ready_future<>());
+            return;
+        }
+    } catch (...) {
+        complete_void(c, seastar::make_exception_future<>(std::current_exception()));
+        return;
+    }
+    if (borrowed) {
+        out->data = out->data.clone();
+    }
+    complete_void(c, seastar::with_gate(_state->ops, [st = _state, out] {
+        return seastar::repeat([st, out] {
+            return st->fd.writeable().then([st, out] {
+                return seastar::stop_iteration(out->send_now(st->fd.get_file_desc().get()));
+            });
+        });
+    }));
+}
+
+std::unique_ptr<udp_channel> new_udp_channel() {
+    return std::make_unique<udp_channel>();
+}
+
+void bind_udp_channel(udp_channel& chan, const SockAddr& addr, completion c) {
+    // Binding fails synchronously, the completion carries the errno.
+    complete_void(c, seastar::futurize_invoke([&] {
+        chan.bind(addr);
+    }));
+}
+
+SockAddr udp_channel_local_address(const udp_channel& chan) {
+    return chan.local_address();
+}
+
+void udp_channel_receive(const udp_channel& chan, rust::Vec<DatagramSlot>& slots, size_t max, completion c) {
+    chan.receive(slots, max, c);
+}
+
+void udp_channel_send(const udp_channel& chan, rust::Slice<const SockAddr> dsts, rust::Slice<const size_t> lens,
+        rust::Slice<const uint8_t> bytes, completion c) {
+    std::vector<seastar::socket_address> addrs;
+    addrs.reserve(dsts.size());
+    for (const auto& dst : dsts) {
+        addrs.push_back(to_socket_address(dst));
+    }
+    // A view of the bytes, which the channel copies if it has to keep them.
+    auto data = temporary_buffer(reinterpret_cast<char*>(const_cast<uint8_t*>(bytes.data())), bytes.size(), seastar::deleter());
+    chan.send(std::move(addrs), std::vector<size_t>(lens.begin(), lens.end()), std::move(data), true, c);
+}
+
+void udp_channel_send_buffer(const udp_channel& chan, const SockAddr& dst, temporary_buffer buf, completion c) {
+    auto len = buf.size();
+    chan.send({to_socket_address(dst)}, {len}, std::move(buf), false, c);
+}
+
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "seastar/src/completion.hh"
+#include "seastar/src/iostream.hh"
+
+#include <seastar/core/gate.hh>
+#include <seastar/core/internal/pollable_fd.hh>
+#include <seastar/core/shared_ptr.hh>
+#include <seastar/net/api.hh>
+#include <seastar/net/socket_defs.hh>
+
+#include <memory>
+#include <vector>
+
+namespace seastar_rs {
+
+struct SockAddr;
+struct ListenOptions;
+struct DatagramSlot;
+
+seastar::socket_address to_socket_address(const SockAddr& addr);
+SockAddr from_socket_address(const seastar::socket_address& addr);
+seastar::listen_options to_listen_options(const ListenOptions& options);
+
+std::unique_ptr<seastar::connected_socket> new_connected_socket();
+// The socket is assigned once the completion is resolved.
+void connect_socket(const SockAddr& addr, seastar::connected_socket& socket, completion c);
+SockAddr connected_socket_local_address(const seastar::connected_socket& socket);
+// Socket options are set synchronously; these return the errno of a
+// failure, or 0.
+int connected_socket_set_nodelay(seastar::connected_socket& socket, bool nodelay) noexcept;
+int connected_socket_set_keepalive(seastar::connected_socket& socket, bool keepalive) noexcept;
+int connected_socket_set_keepalive_parameters(seastar::connected_socket& socket,
+        uint64_t idle_secs, uint64_t interval_secs, uint32_t count) noexcept;
+int connected_socket_set_buffer_size(seastar::connected_socket& socket, bool send, int32_t size) noexcept;
+// These return the errno of a failure, or 0, and store the value of the
+// option otherwise.
+int connected_socket_get_nodelay(const seastar::connected_socket& socket, bool& nodelay) noexcept;
+int connected_socket_get_keepalive(const seastar::connected_socket& socket, bool& keepalive) noexcept;
+int connected_socket_get_buffer_size(const seastar::connected_socket& socket, bool send, int32_t& size) noexcept;
+std::unique_ptr<input_stream> connected_socket_input(seastar::connected_socket& socket);
+std::unique_ptr<output_stream> connected_socket_output(seastar::connected_socket& socket);
+
+// A server_socket which Rust can drop at any time. Dropping it aborts the
+// accept in flight. It is created empty and initialized once it listens.
+class listener {
+    struct state {
+        seastar::server_socket socket;
+        seastar::gate accepts;
+
+        explicit state(seastar::server_socket socket) : socket(std::move(socket)) {}
+    };
+    seastar::lw_shared_ptr<state> _state;
+public:
+    listener() = default;
+    listener(const listener&) = delete;
+    ~listener();
+
+    void listen(const SockAddr& addr, const ListenOptions& options);
+    SockAddr local_address() const;
+    // The connection and the address of its peer are stored once the
+    // completion is resolved.
+    void accept(seastar::connected_socket& socket, SockAddr& remote, completion c) const;
+};
+
+std::unique_ptr<listener> new_listener();
+void make_listener(listener& l, const SockAddr& addr, const ListenOptions& options, completion c);
+SockAddr listener_local_address(const listener& l);
+void listener_accept(const listener& l, seastar::connected_socket& socket, SockAddr& remote, completion c);
+
+// A UDP socket on a pollable_fd which Rust can drop at any time. Dropping
+// it aborts the receive in flight and closes the socket once the
+// operations are done. It is created empty and initialized once it is
+// bound.
+//
+// datagram_channel sends and receives one datagram per system call, so the
+// socket is driven directly with recvmmsg and sendmmsg instead, which
+// always goes through the kernel's network stack.
+//
+// The socket supports one receive and one send in flight, which the Rust
+// side ensures.
+class udp_channel {
+    struct state {
+        seastar::pollable_fd fd;
+        seastar::socket_address local;
+        seastar::gate ops;
+        // Room for a datagram of the largest size for each datagram of the
+        // largest batch received so far.
+        std::vector<std::unique_ptr<char[]>> scratch;
+
+        state(seastar::pollable_fd fd, seastar::socket_address local) : fd(std::move(fd)), local(local) {}
+
+        // Returns false if no datagram is waiting.
+        bool receive_now(rust::Vec<DatagramSlot>& slots, size_t max);
+    };
+    seastar::lw_shared_ptr<state> _state;
+public:
+    udp_channel() = default;
+    udp_channel(const udp_channel&) = delete;
+    ~udp_channel();
+
+    void bind(const SockAddr& addr);
+    SockAddr local_address() const;
+    // Up to max datagrams, and at most UIO_MAXIOV, are appended to slots
+    // once the completion is resolved.
+    void receive(rust::Vec<DatagramSlot>& slots, size_t max, completion c) const;
+    // Datagram i is the next lens[i] bytes of data. If the data is borrowed,
+    // the datagrams which cannot be sent right away are sent from a copy of
+    // it, so it only has to live until the function returns.
+    void send(std::vector<seastar::socket_address> dsts, std::vector<size_t> lens, temporary_buffer data, bool borrowed,
+            completion c) const;
+};
+
+std::unique_ptr<udp_channel> new_udp_channel();
+void bind_udp_channel(udp_channel& chan, const SockAddr& addr, completion c);
+SockAddr udp_channel_local_address(const udp_channel& chan);
+void udp_channel_receive(const udp_channel& chan, rust::Vec<DatagramSlot>& slots, size_t max, completion c);
+// The bytes are copied if they are not all sent before the function returns.
+void udp_channel_send(const udp_channel& chan, rust::Slice<const SockAddr> dsts, rust::Slice<const size_t> lens,
+        rust::Slice<const uint8_t> bytes, completion c);
+void udp_channel_send_buffer(const udp_channel& chan, const SockAddr& dst, temporary_buffer buf, completion c);
+
+}
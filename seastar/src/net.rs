@@ -0,0 +1,968 @@
+//! Networking, `seastar::net`.
+//!
+//! Sockets belong to the shard which created them. Stream sockets use the
+//! network stack of the reactor, which is the POSIX stack unless the
+//! application is configured otherwise; UDP channels always use the
+//! kernel's.
+
+use crate::completion::{completion, Keeping, Pending};
+use crate::{InputStream, OutputStream, TemporaryBuffer};
+use cxx::UniquePtr;
+use std::collections::VecDeque;
+use std::ffi::OsString;
+use std::io;
+use std::net::{Ipv4Addr, Ipv6Addr, SocketAddr, SocketAddrV4, SocketAddrV6};
+use std::os::unix::ffi::{OsStrExt, OsStringExt};
+use std::path::{Path, PathBuf};
+use std::rc::Rc;
+use std::time::Duration;
+
+pub(crate) use ffi::{ListenOptions as ListenOptionsRepr, SockAddr};
+
+#[cxx::bridge(namespace = "seastar_rs")]
+mod ffi {
+    enum AddressFamily {
+        Inet,
+        Inet6,
+        Unix,
+    }
+
+    /// A `seastar::socket_address`.
+    struct SockAddr {
+        family: AddressFamily,
+        // Only the first 4 bytes are used for IPv4.
+        ip: [u8; 16],
+        port: u16,
+        flowinfo: u32,
+        scope_id: u32,
+        // The path of a Unix domain socket, which starts with a NUL byte
+        // in the abstract namespace.
+        path: Vec<u8>,
+    }
+
+    enum LoadBalancingAlgorithm {
+        Default,
+        ConnectionDistribution,
+        Port,
+        Fixed,
+    }
+
+    enum Transport {
+        Tcp,
+        Sctp,
+    }
+
+    /// `seastar::listen_options`.
+    struct ListenOptions {
+        reuse_address: bool,
+        lba: LoadBalancingAlgorithm,
+        fixed_cpu: u32,
+        proto: Transport,
+        listen_backlog: i32,
+    }
+
+    struct DatagramSlot {
+        data: TemporaryBuffer,
+        src: SockAddr,
+        dst: SockAddr,
+    }
+
+    unsafe extern "C++" {
+        include!("seastar/src/net.hh");
+
+        #[cxx_name = "completion"]
+        type Completion = crate::completion::Completion;
+        #[cxx_name = "temporary_buffer"]
+        type TemporaryBuffer = crate::TemporaryBuffer;
+
+        #[cxx_name = "input_stream"]
+        type CppInputStream = crate::iostream::CppInputStream;
+        #[cxx_name = "output_stream"]
+        type CppOutputStream = crate::iostream::CppOutputStream;
+
+        #[namespace = "seastar"]
+        #[cxx_name = "connected_socket"]
+        type CppConnectedSocket;
+
+        #[cxx_name = "listener"]
+        type CppListener;
+
+        #[cxx_name = "udp_channel"]
+        type CppUdpChannel;
+
+        fn new_connected_socket() -> UniquePtr<CppConnectedSocket>;
+        fn connect_socket(addr: &SockAddr, socket: Pin<&mut CppConnectedSocket>, c: Completion);
+        fn connected_socket_local_address(socket: &CppConnectedSocket) -> SockAddr;
+        fn connected_socket_set_nodelay(socket: Pin<&mut CppConnectedSocket>, nodelay: bool)
+            -> i32;
+        fn connected_socket_set_keepalive(
+            socket: Pin<&mut CppConnectedSocket>,
+            keepalive: bool,
+        ) -> i32;
+        fn connected_socket_set_keepalive_parameters(
+            socket: Pin<&mut CppConnectedSocket>,
+            idle_secs: u64,
+            interval_secs: u64,
+            count: u32,
+        ) -> i32;
+        fn connected_socket_set_buffer_size(
+            socket: Pin<&mut CppConnectedSocket>,
+            send: bool,
+            size: i32,
+        ) -> i32;
+        fn connected_socket_get_nodelay(socket: &CppConnectedSocket, nodelay: &mut bool) -> i32;
+        fn connected_socket_get_keepalive(socket: &CppConnectedSocket, keepalive: &mut bool)
+            -> i32;
+        fn connected_socket_get_buffer_size(
+            socket: &CppConnectedSocket,
+            send: bool,
+            size: &mut i32,
+        ) -> i32;
+        fn connected_socket_input(
+            socket: Pin<&mut CppConnectedSocket>,
+        ) -> UniquePtr<CppInputStream>;
+        fn connected_socket_output(
+            socket: Pin<&mut CppConnectedSocket>,
+        ) -> UniquePtr<CppOutputStream>;
+
+        fn new_listener() -> UniquePtr<CppListener>;
+        fn make_listener(
+            listener: Pin<&mut CppListener>,
+            addr: &SockAddr,
+            options: &ListenOptions,
+            c: Completion,
+        );
+        fn listener_local_address(listener: &CppListener) -> SockAddr;
+        fn listener_accept(
+            listener: &CppListener,
+            socket: Pin<&mut CppConnectedSocket>,
+            remote: &mut SockAddr,
+            c: Completion,
+        );
+
+        fn new_udp_channel() -> UniquePtr<CppUdpChannel>;
+        fn bind_udp_channel(chan: Pin<&mut CppUdpChannel>, addr: &SockAddr, c: Completion);
+        fn udp_channel_local_address(chan: &CppUdpChannel) -> SockAddr;
+        fn udp_channel_receive(
+            chan: &CppUdpChannel,
+            slots: &mut Vec<DatagramSlot>,
+            max: usize,
+            c: Completion,
+        );
+        fn udp_channel_send(
+            chan: &CppUdpChannel,
+            dsts: &[SockAddr],
+            lens: &[usize],
+            bytes: &[u8],
+            c: Completion,
+        );
+        fn udp_channel_send_buffer(
+            chan: &CppUdpChannel,
+            dst: &SockAddr,
+            buf: TemporaryBuffer,
+            c: Completion,
+        );
+    }
+}
+
+/// The address of a socket, `seastar::socket_address`.
+#[derive(Clone, Debug, PartialEq, Eq, Hash)]
+pub enum SocketAddress {
+    /// An IPv4 or IPv6 address.
+    Inet(SocketAddr),
+    /// The path of a Unix domain socket, `seastar::unix_domain_addr`.
+    ///
+    /// A path which starts with a NUL byte names a socket in the abstract
+    /// namespace. The addresses of connecting sockets are usually unnamed,
+    /// which is an empty path.
+    Unix(PathBuf),
+}
+
+impl SocketAddress {
+    /// Creates the address of a Unix domain socket.
+    pub fn unix(path: impl AsRef<Path>) -> Self {
+        SocketAddress::Unix(path.as_ref().to_owned())
+    }
+}
+
+impl From<SocketAddr> for SocketAddress {
+    fn from(addr: SocketAddr) -> Self {
+        SocketAddress::Inet(addr)
+    }
+}
+
+impl Default for ffi::SockAddr {
+    fn default() -> Self {
+        Self {
+            family: ffi::AddressFamily::Inet,
+            ip: [0; 16],
+            port: 0,
+            flowinfo: 0,
+            scope_id: 0,
+            path: Vec::new(),
+        }
+    }
+}
+
+impl From<&SocketAddress> for ffi::SockAddr {
+    fn from(addr: &SocketAddress) -> Self {
+        match addr {
+            SocketAddress::Inet(addr) => (*addr).into(),
+            SocketAddress::Unix(path) => Self {
+                family: ffi::AddressFamily::Unix,
+                path: path.as_os_str().as_bytes().to_vec(),
+                ..Default::default()
+            },
+        }
+    }
+}
+
+impl From<SocketAddr> for ffi::SockAddr {
+    fn from(addr: SocketAddr) -> Self {
+        let mut ip = [0; 16];
+        match addr {
+            SocketAddr::V4(addr) => {
+                ip[..4].copy_from_slice(&addr.ip().octets());
+                Self {
+                    family: ffi::AddressFamily::Inet,
+                    ip,
+                    port: addr.port(),
+                    ..Default::default()
+                }
+            }
+            SocketAddr::V6(addr) => Self {
+                family: ffi::AddressFamily::Inet6,
+                ip: addr.ip().octets(),
+                port: addr.port(),
+                flowinfo: addr.flowinfo(),
+                scope_id: addr.scope_id(),
+                path: Vec::new(),
+            },
+        }
+    }
+}
+
+impl From<ffi::SockAddr> for SocketAddress {
+    fn from(addr: ffi::SockAddr) -> Self {
+        match addr.family {
+            ffi::AddressFamily::Inet6 => {
+                let ip = Ipv6Addr::from(addr.ip);
+                SocketAddr::from(SocketAddrV6::new(
+                    ip,
+                    addr.port,
+                    addr.flowinfo,
+                    addr.scope_id,
+                ))
+                .into()
+            }
+            ffi::AddressFamily::Unix => SocketAddress::Unix(OsString::from_vec(addr.path).into()),
+            _ => {
+                let ip = Ipv4Addr::new(addr.ip[0], addr.ip[1], addr.ip[2], addr.ip[3]);
+                SocketAddr::from(SocketAddrV4::new(ip, addr.port)).into()
+            }
+        }
+    }
+}
+
+impl From<ffi::SockAddr> for SocketAddr {
+    fn from(addr: ffi::SockAddr) -> Self {
+        match addr.into() {
+            SocketAddress::Inet(addr) => addr,
+            SocketAddress::Unix(_) => panic!("expected an inet address"),
+        }
+    }
+}
+
+/// Creates a socket listening on `addr` with the default options,
+/// `seastar::listen`. See [`ListenOptions::listen`].
+pub async fn listen(addr: impl Into<SocketAddress>) -> io::Result<ServerSocket> {
+    ListenOptions::new().listen(addr).await
+}
+
+/// How the connections to a listening address are spread across shards,
+/// `server_socket::load_balancing_algorithm`.
+///
+/// Every shard which is to accept connections listens on the address. When
+/// the kernel supports `SO_REUSEPORT`, the POSIX stack gives each shard a
+/// TCP socket of its own, the kernel spreads the connections among them and
+/// the algorithm is ignored: connections are served by the shard which
+/// accepted them. Otherwise, and for Unix domain sockets, connections are
+/// accepted on one socket and handed to a shard picked by the algorithm.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub enum LoadBalancing {
+    /// The default of the network stack, which is
+    /// [`LoadBalancing::ConnectionDistribution`] for TCP.
+    #[default]
+    Default,
+    /// Hands each connection to the shard with the fewest connections.
+    /// Connections are accepted by one shard and moved to another.
+    ConnectionDistribution,
+    /// Hands each connection to the shard `peer port % smp::count`.
+    /// Connections are accepted by one shard and moved to another.
+    Port,
+    /// Hands all connections to the given shard.
+    Fixed(u32),
+}
+
+/// The transport protocol of a listening socket, `seastar::transport`.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub enum Transport {
+    /// `transport::TCP`.
+    #[default]
+    Tcp,
+    /// `transport::SCTP`.
+    Sctp,
+}
+
+/// Options for listening on an address, `seastar::listen_options`.
+pub struct ListenOptions {
+    options: ffi::ListenOptions,
+}
+
+impl ListenOptions {
+    /// Creates options with the defaults of `seastar::listen_options`.
+    pub fn new() -> Self {
+        Self {
+            options: ffi::ListenOptions {
+                reuse_address: false,
+                lba: ffi::LoadBalancingAlgorithm::Default,
+                fixed_cpu: 0,
+                proto: ffi::Transport::Tcp,
+                listen_backlog: 100,
+            },
+        }
+    }
+
+    /// Lets the address be reused while connections to a previous
+    /// listener linger, `SO_REUSEADDR`.
+    pub fn reuse_address(&mut self, reuse_address: bool) -> &mut Self {
+        self.options.reuse_address = reuse_address;
+        self
+    }
+
+    /// Sets how connections are spread across shards.
+    pub fn load_balancing(&mut self, lba: LoadBalancing) -> &mut Self {
+        let (lba, fixed_cpu) = match lba {
+            LoadBalancing::Default => (ffi::LoadBalancingAlgorithm::Default, 0),
+            LoadBalancing::ConnectionDistribution => {
+                (ffi::LoadBalancingAlgorithm::ConnectionDistribution, 0)
+            }
+            LoadBalancing::Port => (ffi::LoadBalancingAlgorithm::Port, 0),
+            LoadBalancing::Fixed(shard) => (ffi::LoadBalancingAlgorithm::Fixed, shard),
+        };
+        self.options.lba = lba;
+        self.options.fixed_cpu = fixed_cpu;
+        self
+    }
+
+    /// Sets the transport protocol, TCP by default.
+    pub fn transport(&mut self, proto: Transport) -> &mut Self {
+        self.options.proto = match proto {
+            Transport::Tcp => ffi::Transport::Tcp,
+            Transport::Sctp => ffi::Transport::Sctp,
+        };
+        self
+    }
+
+    /// Sets the length of the queue of connections waiting to be accepted.
+    pub fn listen_backlog(&mut self, backlog: i32) -> &mut Self {
+        self.options.listen_backlog = backlog;
+        self
+    }
+
+    pub(crate) fn repr(&self) -> &ffi::ListenOptions {
+        &self.options
+    }
+
+    /// Creates a socket listening on `addr`, `seastar::listen`.
+    ///
+    /// The socket of a Unix domain address is created in the filesystem,
+    /// and listening fails if it exists already; it is not removed when the
+    /// listening socket is closed.
+    pub async fn listen(&self, addr: impl Into<SocketAddress>) -> io::Result<ServerSocket> {
+        let mut listener = ffi::new_listener();
+        let (c, pending) = completion();
+        ffi::make_listener(listener.pin_mut(), &(&addr.into()).into(), &self.options, c);
+        // Listening completes right away.
+        pending.await?;
+        Ok(ServerSocket {
+            listener,
+            next: None,
+        })
+    }
+}
+
+impl Default for ListenOptions {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+/// Connects to a socket listening on `addr`, `seastar::connect`.
+pub async fn connect(addr: impl Into<SocketAddress>) -> io::Result<ConnectedSocket> {
+    let mut socket = ffi::new_connected_socket();
+    let (c, pending) = completion();
+    ffi::connect_socket(&(&addr.into()).into(), socket.pin_mut(), c);
+    // The socket is assigned by the C++ side when it connects.
+    let (result, socket) = pending.keeping(socket).await;
+    result?;
+    Ok(ConnectedSocket::new(socket))
+}
+
+type AcceptSlot = (UniquePtr<ffi::CppConnectedSocket>, Box<ffi::SockAddr>);
+
+/// A listening socket, `seastar::server_socket`.
+///
+/// Dropping it aborts the accept in flight.
+pub struct ServerSocket {
+    listener: UniquePtr<ffi::CppListener>,
+    // The accept in flight, kept here so that dropping an accept future
+    // does not lose a connection.
+    next: Option<Keeping<AcceptSlot>>,
+}
+
+impl ServerSocket {
+    /// Returns the address the socket listens on.
+    pub fn local_addr(&self) -> SocketAddress {
+        ffi::listener_local_address(&self.listener).into()
+    }
+
+    /// Accepts a connection, returning it together with the address of its
+    /// peer.
+    pub async fn accept(&mut self) -> io::Result<(ConnectedSocket, SocketAddress)> {
+        let listener = &self.listener;
+        let next = self.next.get_or_insert_with(|| {
+            let mut socket = ffi::new_connected_socket();
+            let mut remote = Box::default();
+            let (c, pending) = completion();
+            ffi::listener_accept(listener, socket.pin_mut(), &mut remote, c);
+            // Both are assigned by the C++ side when the accept completes.
+            pending.keeping((socket, remote))
+        });
+        let (result, (socket, remote)) = next.await;
+        self.next = None;
+        result?;
+        Ok((ConnectedSocket::new(socket), (*remote).into()))
+    }
+}
+
+/// A connection, `seastar::connected_socket`.
+///
+/// Bytes are read from its [`InputStream`] and written to its
+/// [`OutputStream`], which can be split off to be used by different tasks.
+/// Dropping the socket closes the streams in the background.
+pub struct ConnectedSocket {
+    socket: UniquePtr<ffi::CppConnectedSocket>,
+    input: InputStream,
+    output: OutputStream,
+}
+
+impl ConnectedSocket {
+    fn new(mut socket: UniquePtr<ffi::CppConnectedSocket>) -> Self {
+        let input = InputStream::new(ffi::connected_socket_input(socket.pin_mut()));
+        let output = OutputStream::new(ffi::connected_socket_output(socket.pin_mut()));
+        Self {
+            socket,
+            input,
+            output,
+        }
+    }
+
+    /// Returns the address of the local end of the connection.
+    pub fn local_addr(&self) -> SocketAddress {
+        ffi::connected_socket_local_address(&self.socket).into()
+    }
+
+    /// Disables Nagle's algorithm, so that small writes are sent without
+    /// waiting for earlier ones to be acknowledged, `TCP_NODELAY`.
+    ///
+    /// Seastar enables it on the TCP connections it creates.
+    pub fn set_nodelay(&mut self, nodelay: bool) -> io::Result<()> {
+        check(ffi::connected_socket_set_nodelay(
+            self.socket.pin_mut(),
+            nodelay,
+        ))
+    }
+
+    /// Returns whether Nagle's algorithm is disabled, see
+    /// [`ConnectedSocket::set_nodelay`].
+    pub fn nodelay(&self) -> io::Result<bool> {
+        let mut nodelay = false;
+        check(ffi::connected_socket_get_nodelay(
+            &self.socket,
+            &mut nodelay,
+        ))?;
+        Ok(nodelay)
+    }
+
+    /// Enables keepalive probes on an idle connection, `SO_KEEPALIVE`.
+    pub fn set_keepalive(&mut self, keepalive: bool) -> io::Result<()> {
+        check(ffi::connected_socket_set_keepalive(
+            self.socket.pin_mut(),
+            keepalive,
+        ))
+    }
+
+    /// Returns whether keepalive probes are enabled, `SO_KEEPALIVE`.
+    pub fn keepalive(&self) -> io::Result<bool> {
+        let mut keepalive = false;
+        check(ffi::connected_socket_get_keepalive(
+            &self.socket,
+            &mut keepalive,
+        ))?;
+        Ok(keepalive)
+    }
+
+    /// Sets when keepalive probes are sent, see [`TcpKeepaliveParams`].
+    pub fn set_keepalive_parameters(&mut self, params: TcpKeepaliveParams) -> io::Result<()> {
+        check(ffi::connected_socket_set_keepalive_parameters(
+            self.socket.pin_mut(),
+            params.idle.as_secs(),
+            params.interval.as_secs(),
+            params.count,
+        ))
+    }
+
+    /// Sets the size of the kernel's send buffer, `SO_SNDBUF`.
+    pub fn set_send_buffer_size(&mut self, size: usize) -> io::Result<()> {
+        self.set_buffer_size(true, size)
+    }
+
+    /// Sets the size of the kernel's receive buffer, `SO_RCVBUF`.
+    pub fn set_receive_buffer_size(&mut self, size: usize) -> io::Result<()> {
+        self.set_buffer_size(false, size)
+    }
+
+    /// Returns the size of the kernel's send buffer, `SO_SNDBUF`.
+    ///
+    /// Linux reports twice the size which was set, to account for its own
+    /// bookkeeping.
+    pub fn send_buffer_size(&self) -> io::Result<usize> {
+        self.buffer_size(true)
+    }
+
+    /// Returns the size of the kernel's receive buffer, `SO_RCVBUF`, which
+    /// Linux doubles like the send buffer.
+    pub fn receive_buffer_size(&self) -> io::Result<usize> {
+        self.buffer_size(false)
+    }
+
+    fn buffer_size(&self, send: bool) -> io::Result<usize> {
+        let mut size = 0;
+        check(ffi::connected_socket_get_buffer_size(
+            &self.socket,
+            send,
+            &mut size,
+        ))?;
+        Ok(size as usize)
+    }
+
+    fn set_buffer_size(&mut self, send: bool, size: usize) -> io::Result<()> {
+        let size = i32::try_from(size).map_err(|_| io::Error::from(io::ErrorKind::InvalidInput))?;
+        check(ffi::connected_socket_set_buffer_size(
+            self.socket.pin_mut(),
+            send,
+            size,
+        ))
+    }
+
+    /// Returns the stream of bytes received from the peer.
+    pub fn input(&mut self) -> &mut InputStream {
+        &mut self.input
+    }
+
+    /// Returns the stream of bytes sent to the peer.
+    pub fn output(&mut self) -> &mut OutputStream {
+        &mut self.output
+    }
+
+    /// Splits the socket into its streams. Options can no longer be set
+    /// afterwards.
+    pub fn split(self) -> (InputStream, OutputStream) {
+        (self.input, self.output)
+    }
+}
+
+/// When keepalive probes are sent on an idle TCP connection,
+/// `seastar::net::tcp_keepalive_params`. They are rounded down to seconds.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct TcpKeepaliveParams {
+    /// How long the connection is idle before the first probe,
+    /// `TCP_KEEPIDLE`.
+    pub idle: Duration,
+    /// The interval between probes, `TCP_KEEPINTVL`.
+    pub interval: Duration,
+    /// How many probes are unanswered before the connection is dropped,
+    /// `TCP_KEEPCNT`.
+    pub count: u32,
+}
+
+fn check(errno: i32) -> io::Result<()> {
+    if errno == 0 {
+        Ok(())
+    } else {
+        Err(io::Error::from_raw_os_error(errno))
+    }
+}
+
+/// The largest number of datagrams which a [`UdpChannel`] sends or receives
+/// in one system call, `UIO_MAXIOV`.
+pub const MAX_UDP_BATCH: usize = 1024;
+
+/// A datagram received by a [`UdpChannel`], like `seastar::net::datagram`.
+#[derive(Debug)]
+pub struct Datagram {
+    /// The payload, in a buffer of its own size.
+    pub data: TemporaryBuffer,
+    /// The address of the sender.
+    pub src: SocketAddr,
+    /// The address the channel is bound to.
+    pub dst: SocketAddr,
+}
+
+impl From<ffi::DatagramSlot> for Datagram {
+    fn from(slot: ffi::DatagramSlot) -> Self {
+        Datagram {
+            data: slot.data,
+            src: slot.src.into(),
+            dst: slot.dst.into(),
+        }
+    }
+}
+
+/// A UDP socket.
+///
+/// Unlike `seastar::net::datagram_channel`, which makes a system call per
+/// datagram, the channel drives a socket of the kernel with `recvmmsg` and
+/// `sendmmsg`, so [`UdpReceiver::receive_batch`] and
+/// [`UdpSender::send_batch`] move a whole batch of datagrams in one system
+/// call. It therefore always uses the kernel's network stack.
+///
+/// The channel has one receive and one send in flight at a time, which is
+/// why its methods take `&mut self`. To receive and send from different
+/// tasks, split it with [`UdpChannel::split`].
+///
+/// Dropping the channel aborts the receive in flight and closes the socket
+/// in the background once the operations in flight are done.
+pub struct UdpChannel {
+    receiver: UdpReceiver,
+    sender: UdpSender,
+}
+
+impl UdpChannel {
+    /// Creates a channel bound to `addr`.
+    ///
+    /// Binding to port 0 picks an ephemeral port, see
+    /// [`UdpChannel::local_addr`].
+    pub async fn bind(addr: SocketAddr) -> io::Result<UdpChannel> {
+        let mut chan = ffi::new_udp_channel();
+        let (c, pending) = completion();
+        ffi::bind_udp_channel(chan.pin_mut(), &addr.into(), c);
+        // Binding completes right away.
+        pending.await?;
+        let chan = Rc::new(chan);
+        Ok(UdpChannel {
+            receiver: UdpReceiver {
+                chan: chan.clone(),
+                next: None,
+                received: VecDeque::new(),
+            },
+            sender: UdpSender {
+                chan,
+                in_flight: None,
+            },
+        })
+    }
+
+    /// Returns the address the channel is bound to.
+    pub fn local_addr(&self) -> SocketAddr {
+        self.sender.local_addr()
+    }
+
+    /// Receives a datagram, see [`UdpReceiver::receive`].
+    pub async fn receive(&mut self) -> io::Result<Datagram> {
+        self.receiver.receive().await
+    }
+
+    /// Receives a batch of datagrams, see [`UdpReceiver::receive_batch`].
+    pub async fn receive_batch(
+        &mut self,
+        batch: &mut Vec<Datagram>,
+        max: usize,
+    ) -> io::Result<usize> {
+        self.receiver.receive_batch(batch, max).await
+    }
+
+    /// Sends a datagram, see [`UdpSender::send`].
+    pub async fn send(&mut self, dst: SocketAddr, bytes: &[u8]) -> io::Result<()> {
+        self.sender.send(dst, bytes).await
+    }
+
+    /// Sends a datagram without copying it, see [`UdpSender::send_buffer`].
+    pub async fn send_buffer(&mut self, dst: SocketAddr, buf: TemporaryBuffer) -> io::Result<()> {
+        self.sender.send_buffer(dst, buf).await
+    }
+
+    /// Sends a batch of datagrams, see [`UdpSender::send_batch`].
+    pub async fn send_batch<'a>(
+        &mut self,
+        datagrams: impl IntoIterator<Item = (SocketAddr, &'a [u8])>,
+    ) -> io::Result<()> {
+        self.sender.send_batch(datagrams).await
+    }
+
+    /// Splits the channel into halves which receive and send independently.
+    /// The socket is closed when both are dropped.
+    pub fn split(self) -> (UdpReceiver, UdpSender) {
+        (self.receiver, self.sender)
+    }
+}
+
+/// The receiving half of a [`UdpChannel`].
+pub struct UdpReceiver {
+    chan: Rc<UniquePtr<ffi::CppUdpChannel>>,
+    // The receive in flight, kept here so that dropping a receive future
+    // does not lose datagrams. C++ appends to the vector, so it is boxed
+    // to stay at the same address.
+    #[allow(clippy::box_collection)]
+    next: Option<Keeping<Box<Vec<ffi::DatagramSlot>>>>,
+    // Datagrams received by a batch larger than its caller took, because
+    // the future which started it was dropped.
+    received: VecDeque<Datagram>,
+}
+
+impl UdpReceiver {
+    /// Returns the address the channel is bound to.
+    pub fn local_addr(&self) -> SocketAddr {
+        ffi::udp_channel_local_address(&self.chan).into()
+    }
+
+    /// Receives a datagram.
+    ///
+    /// The future can be dropped without losing a datagram; the receive in
+    /// flight is picked up by the next call.
+    pub async fn receive(&mut self) -> io::Result<Datagram> {
+        let mut batch = Vec::with_capacity(1);
+        self.receive_batch(&mut batch, 1).await?;
+        Ok(batch.pop().unwrap())
+    }
+
+    /// Waits for a datagram, then appends it to `batch` together with the
+    /// datagrams which were received with it, up to `max` of them and at most
+    /// [`MAX_UDP_BATCH`], in one `recvmmsg` call. Returns how many were
+    /// appended.
+    ///
+    /// The kernel writes the datagrams into scratch space of the channel,
+    /// 64 KiB for each datagram of the largest batch received so far, and
+    /// each is copied from there into a buffer of its own size.
+    pub async fn receive_batch(
+        &mut self,
+        batch: &mut Vec<Datagram>,
+        max: usize,
+    ) -> io::Result<usize> {
+        assert!(max > 0, "a batch has to hold at least one datagram");
+        let max = max.min(MAX_UDP_BATCH);
+        if self.received.is_empty() {
+            let chan = &self.chan;
+            let next = self.next.get_or_insert_with(|| {
+                let mut slots = Box::new(Vec::with_capacity(max));
+                let (c, pending) = completion();
+                ffi::udp_channel_receive(chan, &mut slots, max, c);
+                // The datagrams are appended to the slots when the receive
+                // completes.
+                pending.keeping(slots)
+            });
+            let (result, slots) = next.await;
+            self.next = None;
+            result?;
+            self.received.extend(slots.into_iter().map(Datagram::from));
+        }
+        let count = self.received.len().min(max);
+        batch.extend(self.received.drain(..count));
+        Ok(count)
+    }
+}
+
+/// The sending half of a [`UdpChannel`].
+pub struct UdpSender {
+    chan: Rc<UniquePtr<ffi::CppUdpChannel>>,
+    // A send whose future was dropped, which has to finish before the next
+    // one starts.
+    in_flight: Option<Pending>,
+}
+
+impl UdpSender {
+    /// Returns the address the channel is bound to.
+    pub fn local_addr(&self) -> SocketAddr {
+        ffi::udp_channel_local_address(&self.chan).into()
+    }
+
+    /// Sends `bytes` to `dst`. The bytes are copied only if the socket has
+    /// no room for them right away.
+    pub async fn send(&mut self, dst: SocketAddr, bytes: &[u8]) -> io::Result<()> {
+        self.run(|chan, c| ffi::udp_channel_send(chan, &[dst.into()], &[bytes.len()], bytes, c))
+            .await
+    }
+
+    /// Sends the contents of `buf` to `dst` without copying them.
+    pub async fn send_buffer(&mut self, dst: SocketAddr, buf: TemporaryBuffer) -> io::Result<()> {
+        self.run(|chan, c| ffi::udp_channel_send_buffer(chan, &dst.into(), buf, c))
+            .await
+    }
+
+    /// Sends `datagrams` with as few `sendmmsg` calls as the socket allows,
+    /// stopping at the first failure.
+    ///
+    /// The payloads are gathered into one buffer before they are sent.
+    pub async fn send_batch<'a>(
+        &mut self,
+        datagrams: impl IntoIterator<Item = (SocketAddr, &'a [u8])>,
+    ) -> io::Result<()> {
+        let mut dsts = Vec::new();
+        let mut lens = Vec::new();
+        let mut bytes = Vec::new();
+        for (dst, payload) in datagrams {
+            dsts.push(ffi::SockAddr::from(dst));
+            lens.push(payload.len());
+            bytes.extend_from_slice(payload);
+        }
+        if dsts.is_empty() {
+            return Ok(());
+        }
+        self.run(|chan, c| ffi::udp_channel_send(chan, &dsts, &lens, &bytes, c))
+            .await
+    }
+
+    async fn run(
+        &mut self,
+        start: impl FnOnce(&ffi::CppUdpChannel, crate::completion::Completion),
+    ) -> io::Result<()> {
+        // The caller of a dropped send is gone, so its result is dropped too.
+        if let Some(previous) = &mut self.in_flight {
+            let _ = previous.await;
+            self.in_flight = None;
+        }
+        let (c, pending) = completion();
+        start(&self.chan, c);
+        let pending = self.in_flight.insert(pending);
+        let result = pending.await;
+        self.in_flight = None;
+        result.map(drop)
+    }
+}
+
+#[seastar::test]
+async fn test_udp_channel_loopback() {
+    let localhost = SocketAddr::from((Ipv4Addr::LOCALHOST, 0));
+    let mut a = UdpChannel::bind(localhost).await.unwrap();
+    let mut b = UdpChannel::bind(localhost).await.unwrap();
+    let b_addr = b.local_addr();
+    assert_ne!(b_addr.port(), 0);
+
+    a.send(b_addr, b"ping").await.unwrap();
+    let datagram = b.receive().await.unwrap();
+    assert_eq!(&*datagram.data, b"ping");
+    assert_eq!(datagram.src, a.local_addr());
+
+    b.send_buffer(datagram.src, TemporaryBuffer::copy_of(b"pong"))
+        .await
+        .unwrap();
+    assert_eq!(&*a.receive().await.unwrap().data, b"pong");
+}
+
+#[seastar::test]
+async fn test_udp_channel_batches() {
+    let localhost = SocketAddr::from((Ipv4Addr::LOCALHOST, 0));
+    let (mut receiver, _) = UdpChannel::bind(localhost).await.unwrap().split();
+    let (_, mut sender) = UdpChannel::bind(localhost).await.unwrap().split();
+    let dst = receiver.local_addr();
+
+    let payloads: [&[u8]; 3] = [b"a", b"b", b"c"];
+    sender
+        .send_batch(payloads.iter().map(|payload| (dst, *payload)))
+        .await
+        .unwrap();
+
+    // Datagrams sent over the loopback interface are queued by the time
+    // sendmmsg returns, so a single recvmmsg picks up all of them.
+    let mut batch = Vec::new();
+    assert_eq!(receiver.receive_batch(&mut batch, 8).await.unwrap(), 3);
+    let received: Vec<&[u8]> = batch.iter().map(|datagram| &*datagram.data).collect();
+    assert_eq!(received, payloads);
+}
+
+#[seastar::test]
+async fn test_stream_socket_over_tcp() {
+    use futures::{AsyncWriteExt, TryStreamExt};
+
+    let mut server = listen(SocketAddr::from((Ipv4Addr::LOCALHOST, 0)))
+        .await
+        .unwrap();
+    let addr = server.local_addr();
+    let (mut client, (mut accepted, peer)) =
+        futures::try_join!(connect(addr.clone()), server.accept()).unwrap();
+    assert_eq!(peer, client.local_addr());
+
+    client.output().write_all(b"ping").await.unwrap();
+    client.output().flush().await.unwrap();
+    let buf = accepted.input().try_next().await.unwrap().unwrap();
+    assert_eq!(&*buf, b"ping");
+}
+
+#[seastar::test]
+async fn test_stream_socket_over_unix_domain() {
+    use futures::{AsyncWriteExt, TryStreamExt};
+
+    let path = crate::file::temp_path("unix-socket");
+    let _ = std::fs::remove_file(&path);
+    let mut server = listen(SocketAddress::unix(&path)).await.unwrap();
+    assert_eq!(server.local_addr(), SocketAddress::unix(&path));
+
+    let (client, (accepted, peer)) =
+        futures::try_join!(connect(SocketAddress::unix(&path)), server.accept()).unwrap();
+    // The connecting socket is not bound to a path.
+    assert_eq!(peer, SocketAddress::unix(""));
+
+    let (_, mut output) = client.split();
+    output.write_all(b"hello").await.unwrap();
+    output.close().await.unwrap();
+    let (mut input, _) = accepted.split();
+    let mut received = Vec::new();
+    while let Some(buf) = input.try_next().await.unwrap() {
+        received.extend_from_slice(&buf);
+    }
+    assert_eq!(received, b"hello");
+    std::fs::remove_file(&path).unwrap();
+}
+
+#[seastar::test]
+async fn test_listen_options_and_socket_options() {
+    let mut server = ListenOptions::new()
+        .reuse_address(true)
+        .listen_backlog(16)
+        .listen(SocketAddr::from((Ipv4Addr::LOCALHOST, 0)))
+        .await
+        .unwrap();
+    let addr = server.local_addr();
+    let (mut client, _) = futures::try_join!(connect(addr), server.accept()).unwrap();
+
+    client.set_nodelay(false).unwrap();
+    assert!(!client.nodelay().unwrap());
+    client.set_nodelay(true).unwrap();
+    assert!(client.nodelay().unwrap());
+    client.set_keepalive(true).unwrap();
+    assert!(client.keepalive().unwrap());
+    client
+        .set_keepalive_parameters(TcpKeepaliveParams {
+            idle: Duration::from_secs(60),
+            interval: Duration::from_secs(10),
+            count: 3,
+        })
+        .unwrap();
+    // Below the default limits of net.core.wmem_max and rmem_max, so the
+    // sizes are not capped.
+    client.set_send_buffer_size(1 << 16).unwrap();
+    client.set_receive_buffer_size(1 << 16).unwrap();
+    assert_eq!(client.send_buffer_size().unwrap(), 2 << 16);
+    assert_eq!(client.receive_buffer_size().unwrap(), 2 << 16);
+}
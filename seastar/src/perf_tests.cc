@@ -0,0 +1,16 @@
+#include "seastar/src/perf_tests.hh"
+
+#include <seastar/core/memory.hh>
+#include <seastar/core/reactor.hh>
+
+namespace seastar_rs {
+
+uint64_t perf_allocations() {
+    return seastar::memory::stats().mallocs();
+}
+
+uint64_t perf_tasks_processed() {
+    return seastar::engine().get_sched_stats().tasks_processed;
+}
+
+}
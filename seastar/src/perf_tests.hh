@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+namespace seastar_rs {
+
+// Total number of allocations made by the current shard.
+uint64_t perf_allocations();
+
+// Total number of tasks run by the current shard's reactor.
+uint64_t perf_tasks_processed();
+
+}
@@ -0,0 +1,490 @@
+//! Microbenchmarks which run inside the reactor.
+//!
+//! A Rust counterpart of Seastar's perf_tests framework. Benchmarks are
+//! registered with `#[seastar::perf_test(group)]` (the equivalent of
+//! `PERF_TEST(group, name)`) and run by [`main`] on shard 0 of a real
+//! reactor. For each benchmark, the runner reports the median time per
+//! iteration over several runs together with its median absolute deviation,
+//! and the number of allocations and tasks per iteration - which are only
+//! observable from inside the reactor.
+//!
+//! ```ignore
+//! // benches/my_bench.rs, with `harness = false`
+//! #[seastar::perf_test(preempt)]
+//! fn need_preempt() {
+//!     seastar::perf_tests::do_not_optimize(&seastar::need_preempt());
+//! }
+//!
+//! fn main() {
+//!     seastar::perf_tests::main();
+//! }
+//! ```
+
+use crate::{AppTemplate, SeastarOptions};
+use futures::future::LocalBoxFuture;
+use futures::FutureExt;
+use std::cell::RefCell;
+use std::future::Future;
+use std::sync::{Arc, Mutex};
+use std::time::{Duration, Instant};
+
+#[cxx::bridge(namespace = "seastar_rs")]
+mod ffi {
+    unsafe extern "C++" {
+        include!("seastar/src/perf_tests.hh");
+
+        fn perf_allocations() -> u64;
+        fn perf_tasks_processed() -> u64;
+    }
+}
+
+/// Result of a benchmark body: the number of iterations it performed.
+///
+/// A body which returns `()` performs a single iteration. Like in perf_tests,
+/// a body can also run an inner loop itself and return its length as `usize`.
+pub trait IterationCount {
+    fn iterations(self) -> u64;
+}
+
+impl IterationCount for () {
+    fn iterations(self) -> u64 {
+        1
+    }
+}
+
+impl IterationCount for usize {
+    fn iterations(self) -> u64 {
+        self as u64
+    }
+}
+
+#[derive(Default)]
+struct TimeMeasurement {
+    started_at: Option<Instant>,
+    total_time: Duration,
+    start_allocations: u64,
+    total_allocations: u64,
+    start_tasks: u64,
+    total_tasks: u64,
+}
+
+thread_local! {
+    static MEASUREMENT: RefCell<TimeMeasurement> = RefCell::default();
+}
+
+/// Resumes measuring time, allocations and tasks.
+///
+/// The runner starts measuring before running a benchmark's iterations. A
+/// benchmark can call [`stop_measuring_time`] and this function to exclude
+/// its setup code from the results.
+pub fn start_measuring_time() {
+    let allocations = ffi::perf_allocations();
+    let tasks = ffi::perf_tasks_processed();
+    MEASUREMENT.with(|m| {
+        let mut m = m.borrow_mut();
+        m.start_allocations = allocations;
+        m.start_tasks = tasks;
+        m.started_at = Some(Instant::now());
+    });
+}
+
+/// Pauses measuring time, allocations and tasks.
+pub fn stop_measuring_time() {
+    let now = Instant::now();
+    let allocations = ffi::perf_allocations();
+    let tasks = ffi::perf_tasks_processed();
+    MEASUREMENT.with(|m| {
+        let mut m = m.borrow_mut();
+        if let Some(started_at) = m.started_at.take() {
+            m.total_time += now - started_at;
+            m.total_allocations += allocations - m.start_allocations;
+            m.total_tasks += tasks - m.start_tasks;
+        }
+    });
+}
+
+/// Prevents the compiler from optimizing away the computation of `value`.
+#[inline(always)]
+pub fn do_not_optimize<T>(value: &T) {
+    std::hint::black_box(value);
+}
+
+/// Totals of a single run of a benchmark.
+struct RunResult {
+    iterations: u64,
+    time: Duration,
+    allocations: u64,
+    tasks: u64,
+}
+
+type RunFn = dyn Fn(u64) -> LocalBoxFuture<'static, RunResult> + Send + Sync;
+
+/// A registered benchmark.
+#[derive(Clone)]
+pub struct PerfTest {
+    group: &'static str,
+    name: &'static str,
+    run: Arc<RunFn>,
+}
+
+async fn measure(run_iterations: impl Future<Output = u64>) -> RunResult {
+    MEASUREMENT.with(|m| *m.borrow_mut() = TimeMeasurement::default());
+    start_measuring_time();
+    let iterations = run_iterations.await;
+    stop_measuring_time();
+    MEASUREMENT.with(|m| {
+        let m = m.borrow();
+        RunResult {
+            iterations,
+            time: m.total_time,
+            allocations: m.total_allocations,
+            tasks: m.total_tasks,
+        }
+    })
+}
+
+impl PerfTest {
+    /// Creates a benchmark whose body is a plain function.
+    pub fn new<F, R>(group: &'static str, name: &'static str, body: F) -> Self
+    where
+        F: Fn() -> R + Copy + Send + Sync + 'static,
+        R: IterationCount,
+    {
+        let run = move |count: u64| {
+            measure(async move {
+                let mut iterations = 0;
+                for _ in 0..count {
+                    iterations += body().iterations();
+                }
+                iterations
+            })
+            .boxed_local()
+        };
+        Self {
+            group,
+            name,
+            run: Arc::new(run),
+        }
+    }
+
+    /// Creates a benchmark whose body is an async function. Each iteration
+    /// awaits the body to completion before starting the next one.
+    pub fn new_async<F, Fut>(group: &'static str, name: &'static str, body: F) -> Self
+    where
+        F: Fn() -> Fut + Copy + Send + Sync + 'static,
+        Fut: Future + 'static,
+        Fut::Output: IterationCount,
+    {
+        let run = move |count: u64| {
+            measure(async move {
+                let mut iterations = 0;
+                for _ in 0..count {
+                    iterations += body().await.iterations();
+                }
+                iterations
+            })
+            .boxed_local()
+        };
+        Self {
+            group,
+            name,
+            run: Arc::new(run),
+        }
+    }
+
+    fn full_name(&self) -> String {
+        format!("{}.{}", self.group, self.name)
+    }
+}
+
+static REGISTRY: Mutex<Vec<PerfTest>> = Mutex::new(Vec::new());
+
+/// Registers a benchmark to be run by [`main`] or [`run_all`].
+///
+/// `#[seastar::perf_test]` calls this before `main` runs.
+pub fn register(test: PerfTest) {
+    REGISTRY.lock().unwrap().push(test);
+}
+
+/// Configuration of the runner, corresponds to perf_tests' command line.
+#[derive(Clone, Debug, PartialEq)]
+pub struct Config {
+    /// Number of iterations in a single run, or 0 to run for `single_run_duration`.
+    pub single_run_iterations: u64,
+    /// Duration of a single run if the number of iterations is not fixed.
+    pub single_run_duration: Duration,
+    /// Number of runs of each benchmark.
+    pub number_of_runs: usize,
+    /// Only benchmarks whose `group.name` contains one of the filters are run.
+    /// An empty list runs all benchmarks.
+    pub test_filters: Vec<String>,
+}
+
+impl Default for Config {
+    fn default() -> Self {
+        Self {
+            single_run_iterations: 0,
+            single_run_duration: Duration::from_secs(1),
+            number_of_runs: 5,
+            test_filters: Vec::new(),
+        }
+    }
+}
+
+impl Config {
+    /// Removes the runner's options from the command line and returns the
+    /// configuration they describe. The remaining arguments are left for Seastar.
+    ///
+    /// Recognizes `--iterations N`, `--duration SECONDS`, `--runs N` and
+    /// `--test FILTER` (or `-t FILTER`, which may be repeated).
+    pub fn from_args(args: &mut Vec<String>) -> Result<Self, String> {
+        let mut config = Config::default();
+        let mut remaining = Vec::with_capacity(args.len());
+        let mut iter = std::mem::take(args).into_iter();
+        while let Some(arg) = iter.next() {
+            let (name, inline_value) = match arg.split_once('=') {
+                Some((name, value)) => (name.to_owned(), Some(value.to_owned())),
+                None => (arg.clone(), None),
+            };
+            if !matches!(
+                name.as_str(),
+                "--iterations" | "--duration" | "--runs" | "--test" | "-t"
+            ) {
+                remaining.push(arg);
+                continue;
+            }
+            let value = inline_value
+                .or_else(|| iter.next())
+                .ok_or_else(|| format!("missing value for {name}"))?;
+            let invalid = || format!("invalid value for {name}: {value}");
+            match name.as_str() {
+                "--iterations" => {
+                    config.single_run_iterations = value.parse().map_err(|_| invalid())?
+                }
+                "--duration" => {
+                    let seconds: f64 = value.parse().map_err(|_| invalid())?;
+                    config.single_run_duration =
+                        Duration::try_from_secs_f64(seconds).map_err(|_| invalid())?;
+                }
+                "--runs" => config.number_of_runs = value.parse().map_err(|_| invalid())?,
+                _ => config.test_filters.push(value),
+            }
+        }
+        *args = remaining;
+        Ok(config)
+    }
+}
+
+/// Statistics of a benchmark over all of its runs.
+#[derive(Clone, Debug, PartialEq)]
+pub struct PerfTestResult {
+    /// `group.name` of the benchmark.
+    pub test_name: String,
+    /// Number of iterations in a single run.
+    pub iterations: u64,
+    /// Median time per iteration, in nanoseconds.
+    pub median: f64,
+    /// Median absolute deviation of the time per iteration, in nanoseconds.
+    pub mad: f64,
+    /// Minimum time per iteration, in nanoseconds.
+    pub min: f64,
+    /// Maximum time per iteration, in nanoseconds.
+    pub max: f64,
+    /// Average number of allocations per iteration.
+    pub allocations: f64,
+    /// Average number of tasks run by the reactor per iteration.
+    pub tasks: f64,
+}
+
+fn median(sorted: &[f64]) -> f64 {
+    let mid = sorted.len() / 2;
+    if sorted.len() % 2 == 1 {
+        sorted[mid]
+    } else {
+        (sorted[mid - 1] + sorted[mid]) / 2.0
+    }
+}
+
+impl PerfTestResult {
+    fn from_runs(test_name: String, runs: &[RunResult]) -> Self {
+        let iterations = runs.iter().map(|r| r.iterations).max().unwrap_or(0);
+        let per_iteration = |r: &RunResult, value: f64| value / r.iterations.max(1) as f64;
+        let mut times = runs
+            .iter()
+            .map(|r| per_iteration(r, r.time.as_nanos() as f64))
+            .collect::<Vec<_>>();
+        times.sort_by(f64::total_cmp);
+        let median_time = median(&times);
+        let mut deviations = times
+            .iter()
+            .map(|t| (t - median_time).abs())
+            .collect::<Vec<_>>();
+        deviations.sort_by(f64::total_cmp);
+        let average = |value: fn(&RunResult) -> u64| {
+            runs.iter()
+                .map(|r| per_iteration(r, value(r) as f64))
+                .sum::<f64>()
+                / runs.len() as f64
+        };
+        Self {
+            test_name,
+            iterations,
+            median: median_time,
+            mad: median(&deviations),
+            min: times[0],
+            max: times[times.len() - 1],
+            allocations: average(|r| r.allocations),
+            tasks: average(|r| r.tasks),
+        }
+    }
+}
+
+/// Runs the benchmark enough times to fill a single run, doubling the number
+/// of iterations until a run takes at least a tenth of the requested duration.
+async fn calibrate(test: &PerfTest, duration: Duration) -> u64 {
+    let mut iterations = 1u64;
+    loop {
+        let result = (test.run)(iterations).await;
+        if result.time >= duration / 10 || iterations >= u64::MAX / 2 {
+            let nanos_per_iteration =
+                result.time.as_nanos().max(1) / result.iterations.max(1) as u128;
+            return ((duration.as_nanos() / nanos_per_iteration.max(1)) as u64).max(1);
+        }
+        iterations *= 2;
+    }
+}
+
+async fn run_test(test: &PerfTest, config: &Config) -> PerfTestResult {
+    let iterations = match config.single_run_iterations {
+        0 => calibrate(test, config.single_run_duration).await,
+        n => n,
+    };
+    let mut runs = Vec::with_capacity(config.number_of_runs);
+    for _ in 0..config.number_of_runs.max(1) {
+        runs.push((test.run)(iterations).await);
+    }
+    PerfTestResult::from_runs(test.full_name(), &runs)
+}
+
+fn format_duration(nanos: f64) -> String {
+    if nanos >= 1e9 {
+        format!("{:.3}s", nanos / 1e9)
+    } else if nanos >= 1e6 {
+        format!("{:.3}ms", nanos / 1e6)
+    } else if nanos >= 1e3 {
+        format!("{:.3}us", nanos / 1e3)
+    } else {
+        format!("{nanos:.3}ns")
+    }
+}
+
+/// Runs all registered benchmarks which match the filters, printing a line
+/// for each one as soon as it finishes. Must be called on a reactor thread.
+pub async fn run_all(config: Config) -> Vec<PerfTestResult> {
+    let mut tests = REGISTRY.lock().unwrap().clone();
+    tests.sort_by_key(|t| (t.group, t.name));
+    tests.retain(|t| {
+        config.test_filters.is_empty()
+            || config
+                .test_filters
+                .iter()
+                .any(|f| t.full_name().contains(f.as_str()))
+    });
+
+    println!("single run iterations:    {}", config.single_run_iterations);
+    println!(
+        "single run duration:      {:.3}s",
+        config.single_run_duration.as_secs_f64()
+    );
+    println!("number of runs:           {}", config.number_of_runs);
+    println!();
+    println!(
+        "{:<40} {:>11} {:>11} {:>11} {:>11} {:>11} {:>11} {:>11}",
+        "test", "iterations", "median", "mad", "min", "max", "allocs", "tasks"
+    );
+
+    let mut results = Vec::with_capacity(tests.len());
+    for test in &tests {
+        let result = run_test(test, &config).await;
+        println!(
+            "{:<40} {:>11} {:>11} {:>11} {:>11} {:>11} {:>11.3} {:>11.3}",
+            result.test_name,
+            result.iterations,
+            format_duration(result.median),
+            format_duration(result.mad),
+            format_duration(result.min),
+            format_duration(result.max),
+            result.allocations,
+            result.tasks,
+        );
+        results.push(result);
+    }
+    results
+}
+
+/// Entry point of a benchmark binary: parses the command line, starts the
+/// reactor and runs all registered benchmarks.
+///
+/// Use it as `main` of a bench target with `harness = false`. Arguments not
+/// recognized by [`Config::from_args`] are passed to Seastar.
+pub fn main() {
+    let mut args = std::env::args().collect::<Vec<_>>();
+    let config = match Config::from_args(&mut args) {
+        Ok(config) => config,
+        Err(err) => {
+            eprintln!("{err}");
+            std::process::exit(2);
+        }
+    };
+    let options = SeastarOptions::new().smp(1);
+    if let Err(code) = AppTemplate::new(options).run(args, run_all(config)) {
+        std::process::exit(code);
+    }
+}
+
+#[test]
+fn test_config_from_args() {
+    let mut args = [
+        "bench",
+        "--runs",
+        "3",
+        "-t=ffi",
+        "--smp",
+        "2",
+        "--duration=0.5",
+    ]
+    .map(String::from)
+    .to_vec();
+    let config = Config::from_args(&mut args).unwrap();
+    assert_eq!(args, ["bench", "--smp", "2"]);
+    assert_eq!(config.number_of_runs, 3);
+    assert_eq!(config.test_filters, ["ffi"]);
+    assert_eq!(config.single_run_duration, Duration::from_millis(500));
+
+    let mut args = ["bench", "--iterations"].map(String::from).to_vec();
+    assert!(Config::from_args(&mut args).is_err());
+}
+
+#[test]
+fn test_result_statistics() {
+    let run = |nanos, allocations| RunResult {
+        iterations: 10,
+        time: Duration::from_nanos(nanos),
+        allocations,
+        tasks: 0,
+    };
+    let runs = [
+        run(100, 10),
+        run(120, 20),
+        run(300, 30),
+        run(110, 0),
+        run(90, 0),
+    ];
+    let result = PerfTestResult::from_runs("group.name".to_owned(), &runs);
+    assert_eq!(result.iterations, 10);
+    assert_eq!(result.median, 11.0);
+    assert_eq!(result.mad, 1.0);
+    assert_eq!(result.min, 9.0);
+    assert_eq!(result.max, 30.0);
+    assert_eq!(result.allocations, 1.2);
+}
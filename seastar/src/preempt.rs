@@ -11,6 +11,38 @@ mod ffi {
 
 pub use ffi::need_preempt;
 
+use std::future::Future;
+use std::pin::Pin;
+use std::task::{Context, Poll};
+
+/// Lets the other tasks of the shard run before the current one continues,
+/// the counterpart of `seastar::yield()`.
+///
+/// The returned future wakes its task and returns `Pending` once, so the
+/// task goes to the back of the reactor's task queue.
+pub fn yield_now() -> YieldNow {
+    YieldNow { yielded: false }
+}
+
+/// The future returned by [`yield_now`].
+#[must_use = "futures do nothing unless polled"]
+pub struct YieldNow {
+    yielded: bool,
+}
+
+impl Future for YieldNow {
+    type Output = ();
+
+    fn poll(mut self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<()> {
+        if self.yielded {
+            return Poll::Ready(());
+        }
+        self.yielded = true;
+        cx.waker().wake_by_ref();
+        Poll::Pending
+    }
+}
+
 #[test]
 fn test_preempt_smoke_test() {
     // The need_preempt function "works" even if there is no Seastar runtime
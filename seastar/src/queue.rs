@@ -0,0 +1,445 @@
+//! Shard-local bounded channels, `seastar::queue` and `seastar::pipe`.
+
+use crate::CircularBuffer;
+use futures::{Sink, Stream};
+use std::cell::RefCell;
+use std::fmt;
+use std::future::poll_fn;
+use std::pin::Pin;
+use std::rc::Rc;
+use std::task::{Context, Poll, Waker};
+
+/// The error returned by the operations of an aborted [`Queue`].
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct QueueAborted;
+
+impl fmt::Display for QueueAborted {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.write_str("the queue was aborted")
+    }
+}
+
+impl std::error::Error for QueueAborted {}
+
+/// The error returned when writing to a pipe whose reader is gone,
+/// `seastar::broken_pipe_exception`.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct BrokenPipe;
+
+impl fmt::Display for BrokenPipe {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.write_str("the reader of the pipe is gone")
+    }
+}
+
+impl std::error::Error for BrokenPipe {}
+
+fn register(wakers: &mut Vec<Waker>, waker: &Waker) {
+    if !wakers.iter().any(|w| w.will_wake(waker)) {
+        wakers.push(waker.clone());
+    }
+}
+
+fn wake_all(wakers: &mut Vec<Waker>) {
+    for waker in wakers.drain(..) {
+        waker.wake();
+    }
+}
+
+struct State<T> {
+    items: CircularBuffer<T>,
+    max_size: usize,
+    // No more items will be pushed (the writer of a pipe is gone).
+    eof: bool,
+    // No more items will be popped (aborted, or the reader of a pipe is gone).
+    aborted: bool,
+    not_empty: Vec<Waker>,
+    not_full: Vec<Waker>,
+}
+
+impl<T> State<T> {
+    fn new(max_size: usize) -> Rc<RefCell<Self>> {
+        assert!(max_size > 0, "the maximum size of a queue must be positive");
+        Rc::new(RefCell::new(Self {
+            items: CircularBuffer::new(),
+            max_size,
+            eof: false,
+            aborted: false,
+            not_empty: Vec::new(),
+            not_full: Vec::new(),
+        }))
+    }
+
+    fn is_full(&self) -> bool {
+        self.items.len() >= self.max_size
+    }
+
+    fn push(&mut self, item: T) {
+        self.items.push_back(item);
+        wake_all(&mut self.not_empty);
+    }
+
+    fn try_push(&mut self, item: T) -> Result<(), T> {
+        if self.aborted || self.is_full() {
+            return Err(item);
+        }
+        self.push(item);
+        Ok(())
+    }
+
+    fn try_pop(&mut self) -> Option<T> {
+        let item = self.items.pop_front()?;
+        wake_all(&mut self.not_full);
+        Some(item)
+    }
+
+    /// Resolves once an item can be pushed, or to `Err` if it never can.
+    fn poll_push_ready(&mut self, cx: &mut Context<'_>) -> Poll<Result<(), ()>> {
+        if self.aborted {
+            Poll::Ready(Err(()))
+        } else if !self.is_full() {
+            Poll::Ready(Ok(()))
+        } else {
+            register(&mut self.not_full, cx.waker());
+            Poll::Pending
+        }
+    }
+
+    /// Resolves to the next item, or to `None` if there will be none.
+    fn poll_pop(&mut self, cx: &mut Context<'_>) -> Poll<Option<T>> {
+        if self.aborted {
+            return Poll::Ready(None);
+        }
+        if let Some(item) = self.try_pop() {
+            return Poll::Ready(Some(item));
+        }
+        if self.eof {
+            return Poll::Ready(None);
+        }
+        register(&mut self.not_empty, cx.waker());
+        Poll::Pending
+    }
+
+    fn abort(&mut self) {
+        self.aborted = true;
+        self.items.clear();
+        wake_all(&mut self.not_empty);
+        wake_all(&mut self.not_full);
+    }
+
+    fn close(&mut self) {
+        self.eof = true;
+        wake_all(&mut self.not_empty);
+    }
+}
+
+/// A bounded FIFO queue for passing items between tasks of one shard,
+/// `seastar::queue<T>`.
+///
+/// The queue is not thread-safe, so unlike channels meant for multiple
+/// threads it costs no atomic operations. It is a handle which can be cloned
+/// to give producers and consumers their own; all clones refer to the same
+/// queue.
+///
+/// The queue is a `Stream` of its items, which ends when the queue is
+/// aborted, and a `Sink`, which accepts items when the queue is not full.
+pub struct Queue<T> {
+    state: Rc<RefCell<State<T>>>,
+}
+
+impl<T> Clone for Queue<T> {
+    fn clone(&self) -> Self {
+        Self {
+            state: self.state.clone(),
+        }
+    }
+}
+
+impl<T> Queue<T> {
+    /// Creates a queue which holds at most `max_size` items.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `max_size` is zero.
+    pub fn new(max_size: usize) -> Self {
+        Self {
+            state: State::new(max_size),
+        }
+    }
+
+    /// Pushes an item if the queue is not full, `push()`.
+    pub fn try_push(&self, item: T) -> Result<(), T> {
+        self.state.borrow_mut().try_push(item)
+    }
+
+    /// Pops an item if the queue is not empty, `pop()`.
+    pub fn try_pop(&self) -> Option<T> {
+        self.state.borrow_mut().try_pop()
+    }
+
+    /// Pushes an item, waiting until the queue is not full,
+    /// `push_eventually()`.
+    pub async fn push(&self, item: T) -> Result<(), QueueAborted> {
+        poll_fn(|cx| self.state.borrow_mut().poll_push_ready(cx))
+            .await
+            .map_err(|()| QueueAborted)?;
+        self.state.borrow_mut().push(item);
+        Ok(())
+    }
+
+    /// Pops an item, waiting until the queue is not empty, `pop_eventually()`.
+    pub async fn pop(&self) -> Result<T, QueueAborted> {
+        poll_fn(|cx| self.state.borrow_mut().poll_pop(cx))
+            .await
+            .ok_or(QueueAborted)
+    }
+
+    /// Returns the number of items in the queue.
+    pub fn len(&self) -> usize {
+        self.state.borrow().items.len()
+    }
+
+    /// Returns whether the queue holds no items.
+    pub fn is_empty(&self) -> bool {
+        self.state.borrow().items.is_empty()
+    }
+
+    /// Returns whether the queue holds `max_size` items or more.
+    pub fn is_full(&self) -> bool {
+        self.state.borrow().is_full()
+    }
+
+    /// Returns the maximum number of items in the queue.
+    pub fn max_size(&self) -> usize {
+        self.state.borrow().max_size
+    }
+
+    /// Changes the maximum number of items in the queue. Items already in
+    /// the queue are kept even if there are more of them.
+    pub fn set_max_size(&self, max_size: usize) {
+        assert!(max_size > 0, "the maximum size of a queue must be positive");
+        let mut state = self.state.borrow_mut();
+        state.max_size = max_size;
+        if !state.is_full() {
+            wake_all(&mut state.not_full);
+        }
+    }
+
+    /// Discards all items and makes all current and future waits fail,
+    /// `abort()`.
+    pub fn abort(&self) {
+        self.state.borrow_mut().abort();
+    }
+
+    /// Returns whether the queue was aborted.
+    pub fn is_aborted(&self) -> bool {
+        self.state.borrow().aborted
+    }
+}
+
+impl<T> Stream for Queue<T> {
+    type Item = T;
+
+    fn poll_next(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Option<T>> {
+        self.state.borrow_mut().poll_pop(cx)
+    }
+}
+
+impl<T> Sink<T> for Queue<T> {
+    type Error = QueueAborted;
+
+    fn poll_ready(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Result<(), QueueAborted>> {
+        self.state
+            .borrow_mut()
+            .poll_push_ready(cx)
+            .map_err(|()| QueueAborted)
+    }
+
+    /// Pushes the item. If another handle filled the queue since
+    /// `poll_ready`, the item is pushed anyway, exceeding the maximum size.
+    fn start_send(self: Pin<&mut Self>, item: T) -> Result<(), QueueAborted> {
+        let mut state = self.state.borrow_mut();
+        if state.aborted {
+            return Err(QueueAborted);
+        }
+        state.push(item);
+        Ok(())
+    }
+
+    fn poll_flush(self: Pin<&mut Self>, _cx: &mut Context<'_>) -> Poll<Result<(), QueueAborted>> {
+        Poll::Ready(Ok(()))
+    }
+
+    fn poll_close(self: Pin<&mut Self>, _cx: &mut Context<'_>) -> Poll<Result<(), QueueAborted>> {
+        Poll::Ready(Ok(()))
+    }
+}
+
+/// Creates a bounded single-producer, single-consumer channel of at most
+/// `max_size` items, `seastar::pipe<T>`.
+///
+/// Dropping (or closing) the writer ends the stream of the reader once the
+/// remaining items are read. Dropping the reader makes writes fail with
+/// [`BrokenPipe`].
+///
+/// # Panics
+///
+/// Panics if `max_size` is zero.
+pub fn pipe<T>(max_size: usize) -> (PipeReader<T>, PipeWriter<T>) {
+    let state = State::new(max_size);
+    (
+        PipeReader {
+            state: state.clone(),
+        },
+        PipeWriter { state },
+    )
+}
+
+/// The reading end of a [`pipe`], `seastar::pipe_reader<T>`.
+pub struct PipeReader<T> {
+    state: Rc<RefCell<State<T>>>,
+}
+
+impl<T> PipeReader<T> {
+    /// Reads the next item, or returns `None` if the writer is gone and
+    /// all items have been read.
+    pub async fn read(&mut self) -> Option<T> {
+        poll_fn(|cx| self.state.borrow_mut().poll_pop(cx)).await
+    }
+}
+
+impl<T> Stream for PipeReader<T> {
+    type Item = T;
+
+    fn poll_next(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Option<T>> {
+        self.state.borrow_mut().poll_pop(cx)
+    }
+}
+
+impl<T> Drop for PipeReader<T> {
+    fn drop(&mut self) {
+        self.state.borrow_mut().abort();
+    }
+}
+
+/// The writing end of a [`pipe`], `seastar::pipe_writer<T>`.
+pub struct PipeWriter<T> {
+    state: Rc<RefCell<State<T>>>,
+}
+
+impl<T> PipeWriter<T> {
+    /// Writes an item, waiting until there is room for it.
+    pub async fn write(&mut self, item: T) -> Result<(), BrokenPipe> {
+        poll_fn(|cx| self.state.borrow_mut().poll_push_ready(cx))
+            .await
+            .map_err(|()| BrokenPipe)?;
+        self.state.borrow_mut().push(item);
+        Ok(())
+    }
+}
+
+impl<T> Sink<T> for PipeWriter<T> {
+    type Error = BrokenPipe;
+
+    fn poll_ready(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Result<(), BrokenPipe>> {
+        self.state
+            .borrow_mut()
+            .poll_push_ready(cx)
+            .map_err(|()| BrokenPipe)
+    }
+
+    fn start_send(self: Pin<&mut Self>, item: T) -> Result<(), BrokenPipe> {
+        self.state
+            .borrow_mut()
+            .try_push(item)
+            .map_err(|_| BrokenPipe)
+    }
+
+    fn poll_flush(self: Pin<&mut Self>, _cx: &mut Context<'_>) -> Poll<Result<(), BrokenPipe>> {
+        Poll::Ready(Ok(()))
+    }
+
+    /// Ends the stream of the reader, like dropping the writer.
+    fn poll_close(self: Pin<&mut Self>, _cx: &mut Context<'_>) -> Poll<Result<(), BrokenPipe>> {
+        self.state.borrow_mut().close();
+        Poll::Ready(Ok(()))
+    }
+}
+
+impl<T> Drop for PipeWriter<T> {
+    fn drop(&mut self) {
+        self.state.borrow_mut().close();
+    }
+}
+
+#[test]
+fn test_queue_is_bounded() {
+    let queue = Queue::new(2);
+    assert_eq!(queue.try_push(1), Ok(()));
+    assert_eq!(queue.try_push(2), Ok(()));
+    assert_eq!(queue.try_push(3), Err(3));
+    assert!(queue.is_full());
+    assert_eq!(queue.try_pop(), Some(1));
+    assert_eq!(queue.try_push(3), Ok(()));
+    assert_eq!(queue.len(), 2);
+}
+
+#[test]
+fn test_queue_waits_for_room_and_items() {
+    use futures::executor::block_on;
+    use futures::future::join;
+
+    let queue = Queue::new(1);
+    let producer = async {
+        for i in 0..10 {
+            queue.push(i).await.unwrap();
+        }
+    };
+    let consumer = async {
+        let mut items = Vec::new();
+        for _ in 0..10 {
+            items.push(queue.pop().await.unwrap());
+        }
+        items
+    };
+    let ((), items) = block_on(join(producer, consumer));
+    assert_eq!(items, (0..10).collect::<Vec<_>>());
+}
+
+#[test]
+fn test_queue_abort() {
+    use futures::executor::block_on;
+
+    let queue = Queue::new(1);
+    queue.try_push(1).unwrap();
+    queue.abort();
+    assert!(queue.is_empty());
+    assert_eq!(block_on(queue.pop()), Err(QueueAborted));
+    assert_eq!(block_on(queue.push(2)), Err(QueueAborted));
+}
+
+#[test]
+fn test_pipe_as_stream_and_sink() {
+    use futures::executor::block_on;
+    use futures::future::join;
+    use futures::{SinkExt, StreamExt};
+
+    let (reader, mut writer) = pipe(3);
+    let producer = async move {
+        writer
+            .send_all(&mut futures::stream::iter(0..10).map(Ok))
+            .await
+            .unwrap();
+    };
+    let (_, items) = block_on(join(producer, reader.collect::<Vec<_>>()));
+    assert_eq!(items, (0..10).collect::<Vec<_>>());
+}
+
+#[test]
+fn test_pipe_broken() {
+    use futures::executor::block_on;
+
+    let (reader, mut writer) = pipe(3);
+    drop(reader);
+    assert_eq!(block_on(writer.write(1)), Err(BrokenPipe));
+}
@@ -0,0 +1,56 @@
+#include "seastar/src/scheduling.hh"
+#include "seastar/src/scheduling.rs.h"
+
+#include <seastar/core/scheduling.hh>
+#include <seastar/core/scheduling_specific.hh>
+
+#include <bit>
+#include <memory>
+#include <type_traits>
+
+namespace seastar_rs {
+
+static_assert(std::is_trivially_copyable_v<seastar::scheduling_group_key>
+        && sizeof(seastar::scheduling_group_key) == sizeof(uint64_t));
+
+namespace {
+
+// The type of every value created for Rust; the actual types are only
+// known to Rust.
+struct rust_specific {};
+
+}
+
+uint32_t current_scheduling_group_index() noexcept {
+    return seastar::internal::scheduling_group_index(seastar::current_scheduling_group());
+}
+
+seastar::sstring scheduling_group_name(uint32_t index) {
+    return seastar::internal::scheduling_group_from_index(index).name();
+}
+
+void scheduling_group_key_create(size_t size, size_t alignment, rust::Box<SpecificType> type, completion c) {
+    // The config is copied to every shard, which construct their values
+    // concurrently.
+    auto shared_type = std::make_shared<const rust::Box<SpecificType>>(std::move(type));
+    seastar::scheduling_group_key_config config(typeid(rust_specific));
+    config.allocation_size = size;
+    config.alignment = alignment;
+    config.constructor = [shared_type] (void* p) {
+        construct_specific(**shared_type, static_cast<uint8_t*>(p));
+    };
+    config.destructor = [shared_type] (void* p) {
+        destroy_specific(**shared_type, static_cast<uint8_t*>(p));
+    };
+    complete_u64(c, seastar::scheduling_group_key_create(std::move(config)).then([] (seastar::scheduling_group_key key) {
+        return std::bit_cast<uint64_t>(key);
+    }));
+}
+
+uint8_t* scheduling_group_specific(uint32_t index, uint64_t key) noexcept {
+    auto group = seastar::internal::scheduling_group_from_index(index);
+    auto& value = seastar::scheduling_group_get_specific<rust_specific>(group, std::bit_cast<seastar::scheduling_group_key>(key));
+    return reinterpret_cast<uint8_t*>(&value);
+}
+
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "seastar/src/completion.hh"
+#include "seastar/src/sstring.hh"
+
+#include <cstdint>
+
+namespace seastar_rs {
+
+struct SpecificType;
+
+// Scheduling groups are identified by their index on the Rust side.
+uint32_t current_scheduling_group_index() noexcept;
+seastar::sstring scheduling_group_name(uint32_t index);
+
+// Scheduling group keys are passed to Rust as their bits, so that they can
+// be shared between shards.
+void scheduling_group_key_create(size_t size, size_t alignment, rust::Box<SpecificType> type, completion c);
+uint8_t* scheduling_group_specific(uint32_t index, uint64_t key) noexcept;
+
+}
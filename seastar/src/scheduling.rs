@@ -0,0 +1,189 @@
+//! Bindings to seastar's scheduling groups.
+
+use crate::completion::completion;
+use crate::Sstring;
+use std::io;
+use std::marker::PhantomData;
+
+#[cxx::bridge(namespace = "seastar_rs")]
+mod ffi {
+    extern "Rust" {
+        type SpecificType;
+
+        unsafe fn construct_specific(ty: &SpecificType, ptr: *mut u8);
+        unsafe fn destroy_specific(ty: &SpecificType, ptr: *mut u8);
+    }
+
+    unsafe extern "C++" {
+        include!("seastar/src/scheduling.hh");
+
+        #[namespace = "seastar"]
+        #[cxx_name = "sstring"]
+        type Sstring = crate::Sstring;
+
+        fn current_scheduling_group_index() -> u32;
+        fn scheduling_group_name(index: u32) -> Sstring;
+
+        #[cxx_name = "completion"]
+        type Completion = crate::completion::Completion;
+
+        fn scheduling_group_key_create(
+            size: usize,
+            alignment: usize,
+            ty: Box<SpecificType>,
+            c: Completion,
+        );
+        fn scheduling_group_specific(index: u32, key: u64) -> *mut u8;
+    }
+}
+
+/// A handle to a `seastar::scheduling_group`.
+///
+/// Tasks, including those spawned from Rust, run in the scheduling group
+/// which was current when they were created.
+#[derive(Clone, Copy, Debug, PartialEq, Eq, Hash)]
+pub struct SchedulingGroup {
+    index: u32,
+}
+
+impl SchedulingGroup {
+    /// Returns the scheduling group of the running task.
+    pub fn current() -> Self {
+        Self {
+            index: ffi::current_scheduling_group_index(),
+        }
+    }
+
+    /// Returns the index of the group, which is smaller than
+    /// [`build_config::SCHEDULING_GROUPS_COUNT`](crate::build_config::SCHEDULING_GROUPS_COUNT).
+    pub fn index(self) -> usize {
+        self.index as usize
+    }
+
+    /// Returns whether this is the default group, in which `main` runs.
+    pub fn is_main(self) -> bool {
+        self.index == 0
+    }
+
+    /// Returns the name the group was created with.
+    pub fn name(self) -> Sstring {
+        ffi::scheduling_group_name(self.index)
+    }
+}
+
+/// How the values of a [`SchedulingGroupKey`] are created and destroyed.
+struct SpecificType {
+    construct: Box<dyn Fn(*mut u8) + Send + Sync>,
+    destroy: unsafe fn(*mut u8),
+}
+
+/// # Safety
+///
+/// `ptr` points to memory for a value of the type of the key.
+unsafe fn construct_specific(ty: &SpecificType, ptr: *mut u8) {
+    (ty.construct)(ptr)
+}
+
+/// # Safety
+///
+/// `ptr` points to a value of the type of the key, which is not used again.
+unsafe fn destroy_specific(ty: &SpecificType, ptr: *mut u8) {
+    (ty.destroy)(ptr)
+}
+
+/// Scheduling-group-local storage, `seastar::scheduling_group_key`.
+///
+/// A key holds one value of type `T` for each scheduling group on each
+/// shard. Getting the value is a direct index into the group's array of
+/// values, so it is a cheaper way to keep per-group state (e.g. per-tenant
+/// counters) than a map from groups to state.
+///
+/// Values are created with the function given to [`SchedulingGroupKey::create`],
+/// for every existing group and for groups created later, and dropped
+/// when their group is destroyed. Since each value belongs to a single
+/// shard and group, it is only ever borrowed immutably; state which
+/// changes goes into a `Cell` or a `RefCell`.
+///
+/// The key itself can be copied and sent to other shards.
+pub struct SchedulingGroupKey<T> {
+    key: u64,
+    _marker: PhantomData<fn() -> T>,
+}
+
+impl<T> Clone for SchedulingGroupKey<T> {
+    fn clone(&self) -> Self {
+        *self
+    }
+}
+
+impl<T> Copy for SchedulingGroupKey<T> {}
+
+impl<T: 'static> SchedulingGroupKey<T> {
+    /// Creates a key on all shards, `seastar::scheduling_group_key_create()`.
+    pub async fn create(init: fn() -> T) -> io::Result<Self> {
+        let ty = Box::new(SpecificType {
+            construct: Box::new(move |ptr| {
+                // Safety: seastar allocates the values with the size and
+                // alignment of T.
+                unsafe { ptr.cast::<T>().write(init()) }
+            }),
+            destroy: |ptr| {
+                // Safety: see destroy_specific.
+                unsafe { ptr.cast::<T>().drop_in_place() }
+            },
+        });
+        // seastar does not expect empty values.
+        let size = std::mem::size_of::<T>().max(1);
+        let (c, pending) = completion();
+        ffi::scheduling_group_key_create(size, std::mem::align_of::<T>(), ty, c);
+        Ok(Self {
+            key: pending.await?.into_u64(),
+            _marker: PhantomData,
+        })
+    }
+
+    /// Runs `f` with the value of the given group on the current shard,
+    /// `seastar::scheduling_group_get_specific()`.
+    pub fn with<R>(&self, group: SchedulingGroup, f: impl FnOnce(&T) -> R) -> R {
+        let ptr = ffi::scheduling_group_specific(group.index, self.key);
+        // Safety: the value was constructed for this key and lives as long
+        // as the group, which cannot be destroyed while the caller runs.
+        // Values are only borrowed immutably and never leave their shard.
+        f(unsafe { &*ptr.cast::<T>() })
+    }
+
+    /// Runs `f` with the value of the current group on the current shard.
+    pub fn with_current<R>(&self, f: impl FnOnce(&T) -> R) -> R {
+        self.with(SchedulingGroup::current(), f)
+    }
+}
+
+#[seastar::test]
+async fn test_main_scheduling_group() {
+    let group = SchedulingGroup::current();
+    assert!(group.is_main());
+    assert_eq!(group.name(), "main");
+}
+
+#[seastar::test]
+async fn test_scheduling_group_key() {
+    use std::cell::Cell;
+
+    let key = SchedulingGroupKey::create(|| Cell::new(7u64))
+        .await
+        .unwrap();
+    key.with_current(|counter| counter.set(counter.get() + 1));
+    assert_eq!(key.with(SchedulingGroup::current(), Cell::get), 8);
+
+    // Every shard has values of its own.
+    for shard in 0..crate::smp::shard_count() {
+        let value =
+            crate::smp::submit_to(shard, move || async move { key.with_current(Cell::get) }).await;
+        let expected = if shard == crate::smp::this_shard_id() {
+            8
+        } else {
+            7
+        };
+        assert_eq!(value, expected);
+    }
+}
@@ -0,0 +1,23 @@
+#include "seastar/src/smp.hh"
+#include "seastar/src/smp.rs.h"
+
+#include <seastar/core/smp.hh>
+
+namespace seastar_rs {
+
+uint32_t shard_count() noexcept {
+    return seastar::smp::count;
+}
+
+uint32_t this_shard_id() noexcept {
+    return seastar::this_shard_id();
+}
+
+void submit_to_shard(uint32_t shard, rust::Box<SmpTask> task) {
+    // The task reports its result, if any, with another message.
+    (void)seastar::smp::submit_to(shard, [task = std::move(task)] () mutable {
+        run_smp_task(std::move(task));
+    });
+}
+
+}
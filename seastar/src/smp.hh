@@ -0,0 +1,18 @@
+#pragma once
+
+#include "rust/cxx.h"
+
+#include <cstdint>
+
+namespace seastar_rs {
+
+struct SmpTask;
+
+uint32_t shard_count() noexcept;
+uint32_t this_shard_id() noexcept;
+
+// Runs the task on the given shard through the reactor's smp queues,
+// without waiting for it.
+void submit_to_shard(uint32_t shard, rust::Box<SmpTask> task);
+
+}
@@ -0,0 +1,92 @@
+//! Communication between shards, `seastar::smp`.
+
+use crate::executor::TaskResult;
+use crate::spawn;
+use futures::channel::oneshot;
+use futures::FutureExt;
+use std::future::Future;
+use std::panic::{self, AssertUnwindSafe};
+
+#[cxx::bridge(namespace = "seastar_rs")]
+mod ffi {
+    extern "Rust" {
+        type SmpTask;
+
+        fn run_smp_task(task: Box<SmpTask>);
+    }
+
+    unsafe extern "C++" {
+        include!("seastar/src/smp.hh");
+
+        fn shard_count() -> u32;
+        fn this_shard_id() -> u32;
+        fn submit_to_shard(shard: u32, task: Box<SmpTask>);
+    }
+}
+
+/// A closure sent to another shard.
+struct SmpTask(Box<dyn FnOnce() + Send>);
+
+// The signature is dictated by the bridge.
+#[allow(clippy::boxed_local)]
+fn run_smp_task(task: Box<SmpTask>) {
+    (task.0)()
+}
+
+/// Returns the number of shards, `smp::count`.
+pub fn shard_count() -> u32 {
+    ffi::shard_count()
+}
+
+/// Returns the id of the current shard, `this_shard_id()`.
+pub fn this_shard_id() -> u32 {
+    ffi::this_shard_id()
+}
+
+/// Runs the closure on the given shard, without waiting for it.
+///
+/// For another shard, the closure is passed through the reactor's smp
+/// queues, which batch messages between each pair of shards, and runs
+/// outside of any task. Like `smp::submit_to()`, a closure for the current
+/// shard runs right away instead, before this returns.
+pub(crate) fn run_on(shard: u32, func: impl FnOnce() + Send + 'static) {
+    ffi::submit_to_shard(shard, Box::new(SmpTask(Box::new(func))));
+}
+
+/// Runs the future returned by `func` on the given shard and returns its
+/// output, `smp::submit_to()`.
+///
+/// The output is sent back through the smp queues as well, so the calling
+/// task is woken by its own reactor. If the future panics, the panic is
+/// resumed in the calling task.
+pub async fn submit_to<F, Fut>(shard: u32, func: F) -> Fut::Output
+where
+    F: FnOnce() -> Fut + Send + 'static,
+    Fut: Future + 'static,
+    Fut::Output: Send + 'static,
+{
+    let origin = this_shard_id();
+    let (tx, rx) = oneshot::channel::<TaskResult<Fut::Output>>();
+    run_on(shard, move || {
+        // The handle is dropped, the result is sent back in a message.
+        spawn(async move {
+            let result = AssertUnwindSafe(async move { func().await })
+                .catch_unwind()
+                .await;
+            run_on(origin, move || {
+                let _ = tx.send(result);
+            });
+        });
+    });
+    match rx.await.expect("the shard dropped the submitted task") {
+        Ok(output) => output,
+        Err(payload) => panic::resume_unwind(payload),
+    }
+}
+
+#[seastar::test]
+async fn test_submit_to_every_shard() {
+    for shard in 0..shard_count() {
+        assert_eq!(submit_to(shard, || async { this_shard_id() }).await, shard);
+    }
+}
@@ -0,0 +1,479 @@
+//! A bounded channel from any shard to one shard, with batched delivery.
+//!
+//! Sending items one by one with [`smp::submit_to`](crate::smp::submit_to)
+//! costs a message, and cross-core cache traffic, per item. The [`Sender`]
+//! of this channel instead buffers items and delivers them to the
+//! [`Receiver`]'s shard a batch per smp message, and the receiver is woken
+//! by its own reactor when a batch arrives.
+//!
+//! Senders are `Sink`s: items fed to a sender are delivered when a batch is
+//! full or when the sender is flushed (e.g. by `SinkExt::send` or at the end
+//! of `SinkExt::send_all`), closed or dropped. The receiver is a `Stream`,
+//! which ends once all senders are gone and all items have been received.
+
+use crate::smp::{run_on, this_shard_id};
+use crate::ChunkedFifo;
+use futures::{Sink, Stream};
+use std::cell::RefCell;
+use std::fmt;
+use std::future::poll_fn;
+use std::marker::PhantomData;
+use std::pin::Pin;
+use std::sync::atomic::{self, AtomicBool, AtomicUsize, Ordering};
+use std::sync::{Arc, Mutex};
+use std::task::{Context, Poll, Waker};
+
+/// The error returned by a [`Sender`] whose receiver is gone.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct Disconnected;
+
+impl fmt::Display for Disconnected {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.write_str("the receiver of the channel is gone")
+    }
+}
+
+impl std::error::Error for Disconnected {}
+
+struct ReceiverState<T> {
+    items: ChunkedFifo<T>,
+    waker: Option<Waker>,
+    // Items received since credits were last returned to the senders.
+    consumed: usize,
+}
+
+/// The part of the channel shared by all shards.
+struct Shared<T> {
+    receiver_shard: u32,
+    capacity: usize,
+    // Credits taken by senders, one per item which was reserved, is in
+    // transit or was received but not yet returned. Never exceeds capacity.
+    used: AtomicUsize,
+    senders: AtomicUsize,
+    // Only written on the receiver's shard.
+    receiver_closed: AtomicBool,
+    // The address of the receiver's state. Only dereferenced on the
+    // receiver's shard, while the receiver is not closed.
+    receiver: usize,
+    // Senders waiting for credits, with the shards on which to wake them.
+    waiting_senders: Mutex<Vec<(u32, Waker)>>,
+    has_waiting_senders: AtomicBool,
+    _items: PhantomData<fn(T)>,
+}
+
+impl<T: Send + 'static> Shared<T> {
+    /// Takes up to `wanted` credits, returns how many were taken.
+    fn take_credits(&self, wanted: usize) -> usize {
+        let mut used = self.used.load(Ordering::Relaxed);
+        loop {
+            let taken = wanted.min(self.capacity - used);
+            if taken == 0 {
+                return 0;
+            }
+            match self.used.compare_exchange_weak(
+                used,
+                used + taken,
+                Ordering::AcqRel,
+                Ordering::Relaxed,
+            ) {
+                Ok(_) => return taken,
+                Err(current) => used = current,
+            }
+        }
+    }
+
+    fn return_credits(&self, credits: usize) {
+        if credits == 0 {
+            return;
+        }
+        self.used.fetch_sub(credits, Ordering::AcqRel);
+        // Pairs with the fence in `Sender::poll_ready`: either the waiting
+        // sender sees the returned credits, or this sees it waiting.
+        atomic::fence(Ordering::SeqCst);
+        self.wake_waiting_senders();
+    }
+
+    fn wake_waiting_senders(&self) {
+        if !self.has_waiting_senders.load(Ordering::Acquire) {
+            return;
+        }
+        let waiting = {
+            let mut waiting = self.waiting_senders.lock().unwrap();
+            self.has_waiting_senders.store(false, Ordering::Release);
+            std::mem::take(&mut *waiting)
+        };
+        for (shard, waker) in waiting {
+            // Wakers of seastar tasks must be used on the task's shard.
+            run_on(shard, move || waker.wake());
+        }
+    }
+
+    /// Runs on the receiver's shard.
+    fn with_receiver(&self, func: impl FnOnce(&mut ReceiverState<T>)) {
+        debug_assert_eq!(this_shard_id(), self.receiver_shard);
+        if self.receiver_closed.load(Ordering::Acquire) {
+            return;
+        }
+        // Safety: the receiver is alive, because it marks the channel as
+        // closed before it is dropped, on this same shard.
+        let state = unsafe { &*(self.receiver as *const RefCell<ReceiverState<T>>) };
+        func(&mut state.borrow_mut());
+    }
+
+    fn deliver(self: &Arc<Self>, batch: Vec<T>) {
+        let shared = self.clone();
+        run_on(self.receiver_shard, move || {
+            let count = batch.len();
+            let mut delivered = false;
+            shared.with_receiver(|state| {
+                state.items.extend(batch);
+                if let Some(waker) = state.waker.take() {
+                    waker.wake();
+                }
+                delivered = true;
+            });
+            if !delivered {
+                shared.return_credits(count);
+            }
+        });
+    }
+}
+
+/// Creates a channel whose receiver lives on the current shard.
+///
+/// At most `capacity` items can be buffered by senders, in transit and
+/// queued at the receiver, together. Senders deliver up to `batch_size`
+/// items per message.
+///
+/// # Panics
+///
+/// Panics if `capacity` or `batch_size` is zero.
+pub fn channel<T: Send + 'static>(capacity: usize, batch_size: usize) -> (Sender<T>, Receiver<T>) {
+    assert!(capacity > 0, "the capacity of a channel must be positive");
+    assert!(
+        batch_size > 0,
+        "the batch size of a channel must be positive"
+    );
+    let state = Box::new(RefCell::new(ReceiverState {
+        items: ChunkedFifo::new(),
+        waker: None,
+        consumed: 0,
+    }));
+    let shared = Arc::new(Shared {
+        receiver_shard: this_shard_id(),
+        capacity,
+        used: AtomicUsize::new(0),
+        senders: AtomicUsize::new(1),
+        receiver_closed: AtomicBool::new(false),
+        receiver: &*state as *const RefCell<ReceiverState<T>> as usize,
+        waiting_senders: Mutex::new(Vec::new()),
+        has_waiting_senders: AtomicBool::new(false),
+        _items: PhantomData,
+    });
+    (
+        Sender {
+            shared: shared.clone(),
+            batch: Vec::new(),
+            batch_size: batch_size.min(capacity),
+            reserved: 0,
+        },
+        Receiver {
+            shared,
+            state,
+            _not_send: PhantomData,
+        },
+    )
+}
+
+/// The sending half of a [`channel`]. Can be moved to, and cloned on,
+/// any shard.
+pub struct Sender<T: Send + 'static> {
+    shared: Arc<Shared<T>>,
+    batch: Vec<T>,
+    batch_size: usize,
+    // Credits taken by this sender which are not used by an item yet.
+    reserved: usize,
+}
+
+impl<T: Send + 'static> Sender<T> {
+    fn deliver(&mut self) {
+        if !self.batch.is_empty() {
+            let batch = std::mem::replace(&mut self.batch, Vec::with_capacity(self.batch_size));
+            self.shared.deliver(batch);
+        }
+    }
+
+    fn release_reserved(&mut self) {
+        self.shared
+            .return_credits(std::mem::take(&mut self.reserved));
+    }
+
+    /// Sends an item and delivers it, together with any buffered items,
+    /// right away. To batch items, use the `Sink` interface instead.
+    pub async fn send(&mut self, item: T) -> Result<(), Disconnected> {
+        poll_fn(|cx| Pin::new(&mut *self).poll_ready(cx)).await?;
+        Pin::new(&mut *self).start_send(item)?;
+        self.deliver();
+        self.release_reserved();
+        Ok(())
+    }
+}
+
+impl<T: Send + 'static> Clone for Sender<T> {
+    fn clone(&self) -> Self {
+        self.shared.senders.fetch_add(1, Ordering::Relaxed);
+        Self {
+            shared: self.shared.clone(),
+            batch: Vec::new(),
+            batch_size: self.batch_size,
+            reserved: 0,
+        }
+    }
+}
+
+// The sender is never pinned structurally.
+impl<T: Send + 'static> Unpin for Sender<T> {}
+
+impl<T: Send + 'static> Sink<T> for Sender<T> {
+    type Error = Disconnected;
+
+    fn poll_ready(
+        mut self: Pin<&mut Self>,
+        cx: &mut Context<'_>,
+    ) -> Poll<Result<(), Disconnected>> {
+        if self.shared.receiver_closed.load(Ordering::Acquire) {
+            return Poll::Ready(Err(Disconnected));
+        }
+        if self.reserved > 0 {
+            return Poll::Ready(Ok(()));
+        }
+        let wanted = self.batch_size - self.batch.len();
+        self.reserved = self.shared.take_credits(wanted);
+        if self.reserved > 0 {
+            return Poll::Ready(Ok(()));
+        }
+        // The receiver may be waiting for the buffered items in order to
+        // return the credits.
+        self.deliver();
+        {
+            let mut waiting = self.shared.waiting_senders.lock().unwrap();
+            waiting.push((this_shard_id(), cx.waker().clone()));
+            self.shared
+                .has_waiting_senders
+                .store(true, Ordering::Release);
+        }
+        // Credits may have been returned before the waker was registered.
+        // Pairs with the fence in `Shared::return_credits`.
+        atomic::fence(Ordering::SeqCst);
+        self.reserved = self.shared.take_credits(wanted);
+        if self.reserved > 0 {
+            Poll::Ready(Ok(()))
+        } else {
+            Poll::Pending
+        }
+    }
+
+    fn start_send(mut self: Pin<&mut Self>, item: T) -> Result<(), Disconnected> {
+        assert!(self.reserved > 0, "start_send called without poll_ready");
+        self.reserved -= 1;
+        self.batch.push(item);
+        if self.batch.len() >= self.batch_size {
+            self.deliver();
+        }
+        Ok(())
+    }
+
+    fn poll_flush(
+        mut self: Pin<&mut Self>,
+        _cx: &mut Context<'_>,
+    ) -> Poll<Result<(), Disconnected>> {
+        self.deliver();
+        self.release_reserved();
+        if self.shared.receiver_closed.load(Ordering::Acquire) {
+            Poll::Ready(Err(Disconnected))
+        } else {
+            Poll::Ready(Ok(()))
+        }
+    }
+
+    fn poll_close(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Result<(), Disconnected>> {
+        self.poll_flush(cx)
+    }
+}
+
+impl<T: Send + 'static> Drop for Sender<T> {
+    fn drop(&mut self) {
+        self.deliver();
+        self.release_reserved();
+        if self.shared.senders.fetch_sub(1, Ordering::AcqRel) == 1 {
+            // Let the receiver notice that the stream has ended.
+            let shared = self.shared.clone();
+            run_on(self.shared.receiver_shard, move || {
+                shared.with_receiver(|state| {
+                    if let Some(waker) = state.waker.take() {
+                        waker.wake();
+                    }
+                });
+            });
+        }
+    }
+}
+
+/// The receiving half of a [`channel`], which stays on the shard on which
+/// the channel was created.
+pub struct Receiver<T: Send + 'static> {
+    shared: Arc<Shared<T>>,
+    // Boxed, so that its address stays the same when the receiver moves.
+    state: Box<RefCell<ReceiverState<T>>>,
+    _not_send: PhantomData<*const ()>,
+}
+
+impl<T: Send + 'static> Receiver<T> {
+    /// Receives the next item, or `None` once all senders are gone and all
+    /// items have been received.
+    pub async fn recv(&mut self) -> Option<T> {
+        poll_fn(|cx| Pin::new(&mut *self).poll_next(cx)).await
+    }
+
+    fn return_consumed(&self, state: &mut ReceiverState<T>) {
+        self.shared
+            .return_credits(std::mem::take(&mut state.consumed));
+    }
+}
+
+impl<T: Send + 'static> Stream for Receiver<T> {
+    type Item = T;
+
+    fn poll_next(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Option<T>> {
+        let mut state = self.state.borrow_mut();
+        if let Some(item) = state.items.pop_front() {
+            state.consumed += 1;
+            // Credits are returned in bulk, to touch the shared counter
+            // (and wake senders) less often.
+            if state.items.is_empty() || state.consumed >= self.shared.capacity / 4 {
+                self.return_consumed(&mut state);
+            }
+            return Poll::Ready(Some(item));
+        }
+        self.return_consumed(&mut state);
+        state.waker = Some(cx.waker().clone());
+        // Senders release their credits before they are dropped, so with no
+        // senders left, any used credit belongs to an item in transit.
+        if self.shared.senders.load(Ordering::Acquire) == 0
+            && self.shared.used.load(Ordering::Acquire) == 0
+        {
+            return Poll::Ready(None);
+        }
+        Poll::Pending
+    }
+}
+
+impl<T: Send + 'static> Drop for Receiver<T> {
+    fn drop(&mut self) {
+        self.shared.receiver_closed.store(true, Ordering::Release);
+        let mut state = self.state.borrow_mut();
+        let queued = state.items.len();
+        state.items.clear();
+        state.consumed += queued;
+        self.return_consumed(&mut state);
+        // Senders waiting for credits have to learn that the receiver is
+        // gone even if no credits were returned. Pairs with the fence in
+        // `Sender::poll_ready`, like the one in `Shared::return_credits`.
+        atomic::fence(Ordering::SeqCst);
+        self.shared.wake_waiting_senders();
+    }
+}
+
+#[seastar::test]
+async fn test_channel_fan_in() {
+    use futures::{SinkExt, StreamExt};
+
+    let (sender, receiver) = channel(16, 4);
+    let shards = crate::smp::shard_count();
+    for shard in 0..shards {
+        let mut sender = sender.clone();
+        // The handle is dropped, the receiver waits for all items instead.
+        crate::spawn(crate::smp::submit_to(shard, move || async move {
+            let items = (0..100).map(move |i| Ok((shard, i)));
+            sender
+                .send_all(&mut futures::stream::iter(items))
+                .await
+                .unwrap();
+        }));
+    }
+    drop(sender);
+
+    let items: Vec<(u32, u32)> = receiver.collect().await;
+    assert_eq!(items.len(), 100 * shards as usize);
+    for shard in 0..shards {
+        let from_shard: Vec<u32> = items
+            .iter()
+            .filter(|(s, _)| *s == shard)
+            .map(|(_, i)| *i)
+            .collect();
+        assert_eq!(from_shard, (0..100).collect::<Vec<_>>());
+    }
+}
+
+#[seastar::test]
+async fn test_channel_send_after_receiver_dropped() {
+    let (mut sender, receiver) = channel::<u32>(4, 2);
+    drop(receiver);
+    assert_eq!(sender.send(1).await, Err(Disconnected));
+}
+
+#[seastar::test]
+async fn test_channel_saturated_credits() {
+    use futures::{SinkExt, StreamExt};
+
+    // Few credits and many senders on both sides of the receiver's shard,
+    // so that senders keep waiting for credits while others return them.
+    const SENDERS_PER_SHARD: u32 = 8;
+    const ITEMS: u32 = 2000;
+    let (sender, receiver) = channel(4, 2);
+    let shards = crate::smp::shard_count().min(2);
+    for shard in 0..shards {
+        for id in 0..SENDERS_PER_SHARD {
+            let mut sender = sender.clone();
+            crate::spawn(crate::smp::submit_to(shard, move || async move {
+                let items = (0..ITEMS).map(move |i| Ok((shard, id, i)));
+                sender
+                    .send_all(&mut futures::stream::iter(items))
+                    .await
+                    .unwrap();
+            }));
+        }
+    }
+    drop(sender);
+
+    let mut next = vec![vec![0; SENDERS_PER_SHARD as usize]; shards as usize];
+    let mut receiver = receiver.enumerate();
+    while let Some((n, (shard, id, i))) = receiver.next().await {
+        assert_eq!(next[shard as usize][id as usize], i);
+        next[shard as usize][id as usize] += 1;
+        if n % 7 == 0 {
+            // Let the credits run out now and then.
+            crate::yield_now().await;
+        }
+    }
+    for per_shard in next {
+        assert!(per_shard.iter().all(|&n| n == ITEMS));
+    }
+}
+
+#[seastar::test]
+async fn test_channel_wakes_parked_sender_when_receiver_dropped() {
+    use futures::SinkExt;
+
+    let (mut holder, receiver) = channel::<u32>(2, 4);
+    let mut parked = holder.clone();
+    // Takes all the credits and keeps them in a batch which is not full, so
+    // nothing is delivered and dropping the receiver returns no credits.
+    holder.feed(1).await.unwrap();
+    holder.feed(2).await.unwrap();
+    let send = crate::spawn(async move { parked.send(3).await });
+    // Lets the sender park in poll_ready.
+    crate::yield_now().await;
+    drop(receiver);
+    assert_eq!(send.await, Err(Disconnected));
+}
@@ -0,0 +1,27 @@
+#include "seastar/src/sstring.hh"
+#include "seastar/src/sstring.rs.h"
+
+#include <memory>
+
+namespace seastar_rs {
+
+static_assert(sizeof(seastar::sstring) == 16 && alignof(seastar::sstring) == 8,
+        "the layout of Sstring in sstring.rs must match seastar::sstring");
+
+seastar::sstring sstring_from_bytes(rust::Slice<const uint8_t> bytes) {
+    return seastar::sstring(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+seastar::sstring sstring_clone(const seastar::sstring& s) {
+    return s;
+}
+
+void sstring_destroy(seastar::sstring& s) noexcept {
+    std::destroy_at(&s);
+}
+
+rust::Slice<const uint8_t> sstring_as_bytes(const seastar::sstring& s) noexcept {
+    return {reinterpret_cast<const uint8_t*>(s.data()), s.size()};
+}
+
+}
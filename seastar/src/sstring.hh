@@ -0,0 +1,21 @@
+#pragma once
+
+#include "rust/cxx.h"
+
+#include <seastar/core/sstring.hh>
+
+#include <type_traits>
+
+// sstring stores short strings inline, but never points into itself,
+// so it can be moved around by Rust as plain bytes.
+template <>
+struct rust::IsRelocatable<seastar::sstring> : std::true_type {};
+
+namespace seastar_rs {
+
+seastar::sstring sstring_from_bytes(rust::Slice<const uint8_t> bytes);
+seastar::sstring sstring_clone(const seastar::sstring& s);
+void sstring_destroy(seastar::sstring& s) noexcept;
+rust::Slice<const uint8_t> sstring_as_bytes(const seastar::sstring& s) noexcept;
+
+}
@@ -0,0 +1,207 @@
+//! Bindings to `seastar::sstring`.
+
+use std::borrow::Cow;
+use std::fmt;
+use std::mem::MaybeUninit;
+use std::ops::Deref;
+use std::str::Utf8Error;
+
+#[cxx::bridge(namespace = "seastar_rs")]
+mod ffi {
+    unsafe extern "C++" {
+        include!("seastar/src/sstring.hh");
+
+        #[namespace = "seastar"]
+        #[cxx_name = "sstring"]
+        type Sstring = crate::sstring::Sstring;
+
+        fn sstring_from_bytes(bytes: &[u8]) -> Sstring;
+        fn sstring_clone(s: &Sstring) -> Sstring;
+        fn sstring_destroy(s: &mut Sstring);
+        fn sstring_as_bytes(s: &Sstring) -> &[u8];
+    }
+}
+
+/// An owned `seastar::sstring`, the string type used throughout Seastar's
+/// APIs (metric labels, HTTP headers, log messages, ...).
+///
+/// Strings of up to 14 bytes are stored inline, longer ones are allocated
+/// with the allocator of the current shard. Converting from `&str` copies
+/// the bytes once, straight into the string's final storage, and the
+/// contents can be borrowed as `&[u8]` or `&str` without copying.
+///
+/// Unlike `String`, an `Sstring` received from C++ is not guaranteed to hold
+/// valid UTF-8, so it derefs to `[u8]` and borrowing it as `&str` is
+/// fallible, see [`Sstring::to_str`].
+#[repr(C, align(8))]
+pub struct Sstring {
+    // Size and alignment are checked against seastar::sstring in sstring.cc.
+    repr: [MaybeUninit<u8>; 16],
+}
+
+// Safety: the C++ side declares seastar::sstring to be relocatable
+// and the layouts are checked to match.
+unsafe impl cxx::ExternType for Sstring {
+    type Id = cxx::type_id!("seastar::sstring");
+    type Kind = cxx::kind::Trivial;
+}
+
+impl Sstring {
+    /// Creates an empty string, which does not allocate.
+    pub fn new() -> Self {
+        ffi::sstring_from_bytes(&[])
+    }
+
+    /// Creates a string from arbitrary bytes.
+    pub fn from_bytes(bytes: &[u8]) -> Self {
+        ffi::sstring_from_bytes(bytes)
+    }
+
+    /// Borrows the contents of the string.
+    pub fn as_bytes(&self) -> &[u8] {
+        ffi::sstring_as_bytes(self)
+    }
+
+    /// Borrows the contents of the string as `&str` if they are valid UTF-8.
+    pub fn to_str(&self) -> Result<&str, Utf8Error> {
+        std::str::from_utf8(self.as_bytes())
+    }
+
+    /// Borrows the contents of the string as `&str`, replacing invalid
+    /// UTF-8 sequences (and only then copying).
+    pub fn to_string_lossy(&self) -> Cow<'_, str> {
+        String::from_utf8_lossy(self.as_bytes())
+    }
+
+    /// Returns the length of the string in bytes.
+    pub fn len(&self) -> usize {
+        self.as_bytes().len()
+    }
+
+    /// Returns whether the string is empty.
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+}
+
+impl Drop for Sstring {
+    fn drop(&mut self) {
+        ffi::sstring_destroy(self);
+    }
+}
+
+impl Clone for Sstring {
+    fn clone(&self) -> Self {
+        ffi::sstring_clone(self)
+    }
+}
+
+impl Default for Sstring {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl From<&str> for Sstring {
+    fn from(s: &str) -> Self {
+        Self::from_bytes(s.as_bytes())
+    }
+}
+
+impl From<&String> for Sstring {
+    fn from(s: &String) -> Self {
+        Self::from(s.as_str())
+    }
+}
+
+impl From<String> for Sstring {
+    fn from(s: String) -> Self {
+        Self::from(s.as_str())
+    }
+}
+
+impl Deref for Sstring {
+    type Target = [u8];
+
+    fn deref(&self) -> &[u8] {
+        self.as_bytes()
+    }
+}
+
+impl AsRef<[u8]> for Sstring {
+    fn as_ref(&self) -> &[u8] {
+        self.as_bytes()
+    }
+}
+
+impl PartialEq for Sstring {
+    fn eq(&self, other: &Self) -> bool {
+        self.as_bytes() == other.as_bytes()
+    }
+}
+
+impl Eq for Sstring {}
+
+impl PartialEq<str> for Sstring {
+    fn eq(&self, other: &str) -> bool {
+        self.as_bytes() == other.as_bytes()
+    }
+}
+
+impl PartialEq<&str> for Sstring {
+    fn eq(&self, other: &&str) -> bool {
+        self.as_bytes() == other.as_bytes()
+    }
+}
+
+impl PartialOrd for Sstring {
+    fn partial_cmp(&self, other: &Self) -> Option<std::cmp::Ordering> {
+        Some(self.cmp(other))
+    }
+}
+
+impl Ord for Sstring {
+    fn cmp(&self, other: &Self) -> std::cmp::Ordering {
+        self.as_bytes().cmp(other.as_bytes())
+    }
+}
+
+impl std::hash::Hash for Sstring {
+    fn hash<H: std::hash::Hasher>(&self, state: &mut H) {
+        self.as_bytes().hash(state)
+    }
+}
+
+impl fmt::Display for Sstring {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        fmt::Display::fmt(&self.to_string_lossy(), f)
+    }
+}
+
+impl fmt::Debug for Sstring {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        fmt::Debug::fmt(&self.to_string_lossy(), f)
+    }
+}
+
+#[seastar::test]
+async fn test_sstring_round_trip() {
+    for s in [
+        "",
+        "short",
+        "exactly 14 b..",
+        "long enough to be allocated outside",
+    ] {
+        let sstring = Sstring::from(s);
+        assert_eq!(sstring.to_str(), Ok(s));
+        assert_eq!(sstring.len(), s.len());
+        assert_eq!(sstring.clone(), sstring);
+    }
+}
+
+#[seastar::test]
+async fn test_sstring_invalid_utf8() {
+    let sstring = Sstring::from_bytes(b"ab\xffcd");
+    assert!(sstring.to_str().is_err());
+    assert_eq!(sstring.to_string_lossy(), "ab\u{fffd}cd");
+}
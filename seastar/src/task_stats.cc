@@ -0,0 +1,47 @@
+#include "seastar/src/task_stats.hh"
+#include "seastar/src/task_stats.rs.h"
+
+#include <seastar/core/metrics.hh>
+
+#include <string>
+
+namespace seastar_rs {
+
+namespace sm = seastar::metrics;
+
+static sm::histogram poll_duration_histogram(const TaskTypeStats& stats) {
+    sm::histogram histogram;
+    histogram.sample_count = task_type_polls(stats);
+    histogram.sample_sum = double(task_type_runtime_us(stats));
+    // The buckets of the Rust side hold counts of polls up to 2^i us.
+    auto counts = task_type_poll_buckets(stats);
+    histogram.buckets.reserve(counts.size());
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        cumulative += counts[i];
+        histogram.buckets.push_back(sm::histogram_bucket{cumulative, double(uint64_t(1) << i)});
+    }
+    return histogram;
+}
+
+task_type_metrics::task_type_metrics(const TaskTypeStats& stats, rust::Str label) {
+    sm::label task_label("task");
+    std::vector<sm::label_instance> labels{task_label(std::string(label.data(), label.size()))};
+    const TaskTypeStats* s = &stats;
+    _metrics.add_group("rust_executor", {
+        sm::make_counter("task_polls", [s] { return task_type_polls(*s); },
+                sm::description("Number of times Rust tasks with this label were polled"), labels),
+        sm::make_counter("task_runtime_ms", [s] { return task_type_runtime_us(*s) / 1000; },
+                sm::description("Total time spent polling Rust tasks with this label"), labels),
+        sm::make_gauge("task_longest_poll_us", [s] { return task_type_longest_poll_us(*s); },
+                sm::description("Longest single poll of a Rust task with this label"), labels),
+        sm::make_histogram("task_poll_duration_us", [s] { return poll_duration_histogram(*s); },
+                sm::description("Durations of polls of Rust tasks with this label"), labels),
+    });
+}
+
+std::unique_ptr<task_type_metrics> register_task_type_metrics(const TaskTypeStats& stats, rust::Str label) {
+    return std::make_unique<task_type_metrics>(stats, label);
+}
+
+}
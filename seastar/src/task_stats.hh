@@ -0,0 +1,23 @@
+#pragma once
+
+#include "rust/cxx.h"
+
+#include <seastar/core/metrics_registration.hh>
+
+#include <memory>
+
+namespace seastar_rs {
+
+struct TaskTypeStats;
+
+// Exports the statistics of Rust tasks with a given label as metrics of
+// the "rust_executor" group. The statistics must outlive the metrics.
+class task_type_metrics {
+    seastar::metrics::metric_groups _metrics;
+public:
+    task_type_metrics(const TaskTypeStats& stats, rust::Str label);
+};
+
+std::unique_ptr<task_type_metrics> register_task_type_metrics(const TaskTypeStats& stats, rust::Str label);
+
+}
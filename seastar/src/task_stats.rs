@@ -0,0 +1,161 @@
+//! Statistics of Rust tasks, grouped by the labels they were spawned with.
+
+use cxx::UniquePtr;
+use std::cell::{Cell, OnceCell, RefCell};
+use std::collections::BTreeMap;
+use std::time::Duration;
+
+#[cxx::bridge(namespace = "seastar_rs")]
+mod ffi {
+    extern "Rust" {
+        type TaskTypeStats;
+
+        fn task_type_polls(stats: &TaskTypeStats) -> u64;
+        fn task_type_runtime_us(stats: &TaskTypeStats) -> u64;
+        fn task_type_longest_poll_us(stats: &TaskTypeStats) -> u64;
+        fn task_type_poll_buckets(stats: &TaskTypeStats) -> Vec<u64>;
+    }
+
+    unsafe extern "C++" {
+        include!("seastar/src/task_stats.hh");
+
+        #[cxx_name = "task_type_metrics"]
+        type TaskTypeMetrics;
+
+        fn register_task_type_metrics(
+            stats: &TaskTypeStats,
+            label: &str,
+        ) -> UniquePtr<TaskTypeMetrics>;
+    }
+}
+
+/// Polls are counted in buckets of durations up to 2^i microseconds, the
+/// last one being about a second. Longer polls are only counted in total.
+const POLL_BUCKETS: usize = 21;
+
+thread_local! {
+    static STATS: RefCell<BTreeMap<&'static str, &'static TaskTypeStats>> =
+        const { RefCell::new(BTreeMap::new()) };
+}
+
+/// The statistics of the tasks with one label on one shard.
+///
+/// They are created when the label is first used on the shard and live
+/// until the shard exits, so that tasks and the metrics can refer to them.
+pub(crate) struct TaskTypeStats {
+    polls: Cell<u64>,
+    runtime: Cell<Duration>,
+    longest_poll: Cell<Duration>,
+    poll_buckets: [Cell<u64>; POLL_BUCKETS],
+    metrics: OnceCell<UniquePtr<ffi::TaskTypeMetrics>>,
+}
+
+impl TaskTypeStats {
+    fn new() -> Self {
+        Self {
+            polls: Cell::new(0),
+            runtime: Cell::new(Duration::ZERO),
+            longest_poll: Cell::new(Duration::ZERO),
+            poll_buckets: Default::default(),
+            metrics: OnceCell::new(),
+        }
+    }
+
+    /// Returns the statistics of tasks with the given label on the current
+    /// shard, registering their metrics on first use.
+    pub(crate) fn get(label: &'static str) -> &'static Self {
+        STATS.with(|stats| {
+            if let Some(stats) = stats.borrow().get(label) {
+                return *stats;
+            }
+            // Leaked, like the loggers, so that the metrics are never
+            // unregistered after the reactor is gone.
+            let new: &'static Self = Box::leak(Box::new(Self::new()));
+            let _ = new.metrics.set(ffi::register_task_type_metrics(new, label));
+            stats.borrow_mut().insert(label, new);
+            new
+        })
+    }
+
+    /// Accounts for one poll of a task.
+    pub(crate) fn record(&self, duration: Duration) {
+        self.polls.set(self.polls.get() + 1);
+        self.runtime.set(self.runtime.get() + duration);
+        if duration > self.longest_poll.get() {
+            self.longest_poll.set(duration);
+        }
+        if let Some(bucket) = self.poll_buckets.get(poll_bucket(duration)) {
+            bucket.set(bucket.get() + 1);
+        }
+    }
+
+    fn snapshot(&self) -> TaskStats {
+        TaskStats {
+            polls: self.polls.get(),
+            runtime: self.runtime.get(),
+            longest_poll: self.longest_poll.get(),
+        }
+    }
+}
+
+/// Returns the index of the bucket which counts polls of the given
+/// duration, the first one whose bound of 2^i us is not shorter.
+fn poll_bucket(duration: Duration) -> usize {
+    let micros = duration.as_nanos().div_ceil(1000);
+    if micros <= 1 {
+        0
+    } else {
+        (u128::BITS - (micros - 1).leading_zeros()) as usize
+    }
+}
+
+fn task_type_polls(stats: &TaskTypeStats) -> u64 {
+    stats.polls.get()
+}
+
+fn task_type_runtime_us(stats: &TaskTypeStats) -> u64 {
+    stats.runtime.get().as_micros() as u64
+}
+
+fn task_type_longest_poll_us(stats: &TaskTypeStats) -> u64 {
+    stats.longest_poll.get().as_micros() as u64
+}
+
+fn task_type_poll_buckets(stats: &TaskTypeStats) -> Vec<u64> {
+    stats.poll_buckets.iter().map(Cell::get).collect()
+}
+
+/// The statistics of the tasks spawned with a label on a shard, see
+/// [`spawn_labeled`](crate::spawn_labeled).
+///
+/// They are also exported as the `rust_executor_task_*` metrics, with the
+/// label in the `task` metric label.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct TaskStats {
+    /// Number of times the tasks were polled.
+    pub polls: u64,
+    /// Total time spent polling the tasks.
+    pub runtime: Duration,
+    /// The longest single poll, which is how long the tasks stalled the
+    /// reactor at most.
+    pub longest_poll: Duration,
+}
+
+/// Returns the statistics of the tasks spawned with `label` on the current
+/// shard, or `None` if there were none.
+pub fn task_stats(label: &str) -> Option<TaskStats> {
+    STATS.with(|stats| stats.borrow().get(label).map(|stats| stats.snapshot()))
+}
+
+#[test]
+fn test_poll_buckets() {
+    let bucket = |micros| poll_bucket(Duration::from_micros(micros));
+    assert_eq!(poll_bucket(Duration::from_nanos(10)), 0);
+    assert_eq!(bucket(1), 0);
+    assert_eq!(bucket(2), 1);
+    assert_eq!(bucket(3), 2);
+    assert_eq!(bucket(4), 2);
+    assert_eq!(bucket(5), 3);
+    assert_eq!(bucket(1 << 20), POLL_BUCKETS - 1);
+    assert_eq!(bucket((1 << 20) + 1), POLL_BUCKETS);
+}
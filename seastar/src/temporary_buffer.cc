@@ -0,0 +1,39 @@
+#include "seastar/src/temporary_buffer.hh"
+#include "seastar/src/temporary_buffer.rs.h"
+
+#include <memory>
+
+namespace seastar_rs {
+
+static_assert(sizeof(temporary_buffer) == 24 && alignof(temporary_buffer) == 8,
+        "the layout of TemporaryBuffer in temporary_buffer.rs must match seastar::temporary_buffer");
+
+temporary_buffer temporary_buffer_empty() noexcept {
+    return temporary_buffer();
+}
+
+temporary_buffer temporary_buffer_copy_of(rust::Slice<const uint8_t> bytes) {
+    return temporary_buffer(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+temporary_buffer temporary_buffer_share(temporary_buffer& buf) {
+    return buf.share();
+}
+
+void temporary_buffer_trim_front(temporary_buffer& buf, size_t n) noexcept {
+    buf.trim_front(n);
+}
+
+void temporary_buffer_trim(temporary_buffer& buf, size_t n) noexcept {
+    buf.trim(n);
+}
+
+void temporary_buffer_destroy(temporary_buffer& buf) noexcept {
+    std::destroy_at(&buf);
+}
+
+rust::Slice<const uint8_t> temporary_buffer_as_bytes(const temporary_buffer& buf) noexcept {
+    return {reinterpret_cast<const uint8_t*>(buf.get()), buf.size()};
+}
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "rust/cxx.h"
+
+#include <seastar/core/temporary_buffer.hh>
+
+#include <type_traits>
+
+// temporary_buffer is a pointer, a size and a deleter, which is a pointer
+// as well, so it can be moved around by Rust as plain bytes.
+template <>
+struct rust::IsRelocatable<seastar::temporary_buffer<char>> : std::true_type {};
+
+namespace seastar_rs {
+
+// cxx can only name types by identifiers.
+using temporary_buffer = seastar::temporary_buffer<char>;
+
+temporary_buffer temporary_buffer_empty() noexcept;
+temporary_buffer temporary_buffer_copy_of(rust::Slice<const uint8_t> bytes);
+temporary_buffer temporary_buffer_share(temporary_buffer& buf);
+void temporary_buffer_trim_front(temporary_buffer& buf, size_t n) noexcept;
+void temporary_buffer_trim(temporary_buffer& buf, size_t n) noexcept;
+void temporary_buffer_destroy(temporary_buffer& buf) noexcept;
+rust::Slice<const uint8_t> temporary_buffer_as_bytes(const temporary_buffer& buf) noexcept;
+
+}
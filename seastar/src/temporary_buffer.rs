@@ -0,0 +1,141 @@
+//! Bindings to `seastar::temporary_buffer<char>`.
+
+use std::fmt;
+use std::mem::MaybeUninit;
+use std::ops::Deref;
+
+#[cxx::bridge(namespace = "seastar_rs")]
+mod ffi {
+    unsafe extern "C++" {
+        include!("seastar/src/temporary_buffer.hh");
+
+        #[cxx_name = "temporary_buffer"]
+        type TemporaryBuffer = crate::temporary_buffer::TemporaryBuffer;
+
+        fn temporary_buffer_empty() -> TemporaryBuffer;
+        fn temporary_buffer_copy_of(bytes: &[u8]) -> TemporaryBuffer;
+        fn temporary_buffer_share(buf: &mut TemporaryBuffer) -> TemporaryBuffer;
+        fn temporary_buffer_trim_front(buf: &mut TemporaryBuffer, n: usize);
+        fn temporary_buffer_trim(buf: &mut TemporaryBuffer, n: usize);
+        fn temporary_buffer_destroy(buf: &mut TemporaryBuffer);
+        fn temporary_buffer_as_bytes(buf: &TemporaryBuffer) -> &[u8];
+    }
+}
+
+/// A `seastar::temporary_buffer<char>`, a view of bytes which keeps their
+/// storage alive.
+///
+/// This is what Seastar's streams hand out and take in, so bytes read from
+/// a file or a socket reach Rust without being copied. A buffer can be
+/// shared, which creates another view of the same storage and frees it
+/// only when the last view is dropped, and trimmed from either end.
+///
+/// Like other Seastar objects, a buffer belongs to the shard which created
+/// it.
+#[repr(C, align(8))]
+pub struct TemporaryBuffer {
+    // Size and alignment are checked against seastar::temporary_buffer in
+    // temporary_buffer.cc.
+    repr: [MaybeUninit<u8>; 24],
+    _not_send: std::marker::PhantomData<*const u8>,
+}
+
+// Safety: the C++ side declares seastar::temporary_buffer to be relocatable
+// and the layouts are checked to match.
+unsafe impl cxx::ExternType for TemporaryBuffer {
+    type Id = cxx::type_id!("seastar_rs::temporary_buffer");
+    type Kind = cxx::kind::Trivial;
+}
+
+impl TemporaryBuffer {
+    /// Creates an empty buffer, which does not allocate.
+    pub fn new() -> Self {
+        ffi::temporary_buffer_empty()
+    }
+
+    /// Creates a buffer holding a copy of `bytes`.
+    pub fn copy_of(bytes: &[u8]) -> Self {
+        ffi::temporary_buffer_copy_of(bytes)
+    }
+
+    /// Borrows the contents of the buffer.
+    pub fn as_bytes(&self) -> &[u8] {
+        ffi::temporary_buffer_as_bytes(self)
+    }
+
+    /// Returns the length of the buffer in bytes.
+    pub fn len(&self) -> usize {
+        self.as_bytes().len()
+    }
+
+    /// Returns whether the buffer is empty.
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// Creates another view of the same bytes, without copying them.
+    ///
+    /// Sharing may have to change how this buffer refers to its storage,
+    /// hence `&mut self`.
+    pub fn share(&mut self) -> Self {
+        ffi::temporary_buffer_share(self)
+    }
+
+    /// Drops the first `n` bytes from the view.
+    pub fn trim_front(&mut self, n: usize) {
+        assert!(n <= self.len(), "trimming past the end of the buffer");
+        ffi::temporary_buffer_trim_front(self, n)
+    }
+
+    /// Shortens the view to its first `len` bytes.
+    pub fn trim(&mut self, len: usize) {
+        assert!(len <= self.len(), "trimming past the end of the buffer");
+        ffi::temporary_buffer_trim(self, len)
+    }
+}
+
+impl Drop for TemporaryBuffer {
+    fn drop(&mut self) {
+        ffi::temporary_buffer_destroy(self);
+    }
+}
+
+impl Default for TemporaryBuffer {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl Deref for TemporaryBuffer {
+    type Target = [u8];
+
+    fn deref(&self) -> &[u8] {
+        self.as_bytes()
+    }
+}
+
+impl AsRef<[u8]> for TemporaryBuffer {
+    fn as_ref(&self) -> &[u8] {
+        self.as_bytes()
+    }
+}
+
+impl fmt::Debug for TemporaryBuffer {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("TemporaryBuffer")
+            .field("len", &self.len())
+            .finish()
+    }
+}
+
+#[seastar::test]
+async fn test_temporary_buffer_share_and_trim() {
+    let mut buf = TemporaryBuffer::copy_of(b"hello, world");
+    let mut shared = buf.share();
+    shared.trim_front(7);
+    shared.trim(3);
+    assert_eq!(&*shared, b"wor");
+    drop(buf);
+    assert_eq!(&*shared, b"wor");
+    assert!(TemporaryBuffer::new().is_empty());
+}
@@ -0,0 +1,93 @@
+#include "seastar/src/testing.hh"
+#include "seastar/src/testing.rs.h"
+#include "seastar/src/app_template.hh"
+
+#include <seastar/core/alien.hh>
+#include <seastar/core/app-template.hh>
+#include <seastar/core/future.hh>
+
+#include <future>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace seastar_rs {
+
+namespace {
+
+// Runs an app_template on its own thread until the process exits,
+// similarly to seastar::testing::test_runner.
+class test_reactor {
+    std::thread _thread;
+    seastar::alien::instance* _alien = nullptr;
+    // Only accessed on shard 0.
+    std::optional<seastar::promise<>> _stop;
+public:
+    bool start(std::vector<std::string> args) {
+        std::promise<bool> started;
+        auto started_future = started.get_future();
+        _thread = std::thread([this, args = std::move(args), started = std::move(started)] () mutable {
+            std::vector<char*> argv;
+            argv.reserve(args.size() + 1);
+            for (auto& arg : args) {
+                argv.push_back(arg.data());
+            }
+            argv.push_back(nullptr);
+
+            seastar::app_template app;
+            bool running = false;
+            app.run(int(args.size()), argv.data(), [&] {
+                remember_reactor_config(app);
+                _alien = &app.alien();
+                _stop.emplace();
+                running = true;
+                started.set_value(true);
+                return _stop->get_future();
+            });
+            forget_reactor_config();
+            if (!running) {
+                started.set_value(false);
+            }
+        });
+        if (!started_future.get()) {
+            _thread.join();
+            return false;
+        }
+        return true;
+    }
+
+    void run_on(unsigned shard, rust::Box<AlienTask> task) {
+        seastar::alien::run_on(*_alien, shard, [task = std::move(task)] () mutable noexcept {
+            run_alien_task(std::move(task));
+        });
+    }
+
+    ~test_reactor() {
+        if (_thread.joinable()) {
+            seastar::alien::run_on(*_alien, 0, [this] () noexcept {
+                _stop->set_value();
+            });
+            _thread.join();
+        }
+    }
+};
+
+test_reactor the_test_reactor;
+
+}
+
+bool start_test_reactor(rust::Slice<const rust::String> args) {
+    std::vector<std::string> arg_strings;
+    arg_strings.reserve(args.size());
+    for (const auto& arg : args) {
+        arg_strings.emplace_back(std::string(arg));
+    }
+    return the_test_reactor.start(std::move(arg_strings));
+}
+
+void run_on_test_reactor(uint32_t shard, rust::Box<AlienTask> task) {
+    the_test_reactor.run_on(shard, std::move(task));
+}
+
+}
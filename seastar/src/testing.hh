@@ -0,0 +1,18 @@
+#pragma once
+
+#include "rust/cxx.h"
+
+#include <cstdint>
+
+namespace seastar_rs {
+
+struct AlienTask;
+
+// Starts the reactor shared by all tests of the process on a dedicated
+// thread. Returns false if the reactor failed to start.
+bool start_test_reactor(rust::Slice<const rust::String> args);
+
+// Runs the task on the given shard of the shared test reactor.
+void run_on_test_reactor(uint32_t shard, rust::Box<AlienTask> task);
+
+}
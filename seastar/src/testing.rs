@@ -0,0 +1,119 @@
+//! Support for running tests inside a Seastar reactor.
+//!
+//! Usually used through the `#[seastar::test]` macro.
+
+use crate::{spawn, SeastarOptions};
+use futures::FutureExt;
+use std::future::Future;
+use std::panic::{self, AssertUnwindSafe};
+use std::sync::{mpsc, OnceLock};
+
+#[cxx::bridge(namespace = "seastar_rs")]
+mod ffi {
+    extern "Rust" {
+        type AlienTask;
+
+        fn run_alien_task(task: Box<AlienTask>);
+    }
+
+    unsafe extern "C++" {
+        include!("seastar/src/testing.hh");
+
+        fn start_test_reactor(args: &[String]) -> bool;
+        fn run_on_test_reactor(shard: u32, task: Box<AlienTask>);
+    }
+}
+
+/// A closure sent to a reactor thread from outside of the reactor.
+struct AlienTask(Box<dyn FnOnce() + Send>);
+
+// The signature is dictated by the bridge.
+#[allow(clippy::boxed_local)]
+fn run_alien_task(task: Box<AlienTask>) {
+    (task.0)()
+}
+
+/// The number of shards of the test reactor unless a test sets it. It is
+/// fixed, rather than one per core, so that tests behave the same on every
+/// machine, and above one so that cross-shard code paths are exercised.
+const DEFAULT_TEST_SMP: u32 = 2;
+
+/// The memory of the test reactor unless a test sets it, rather than all
+/// of the machine's memory.
+const DEFAULT_TEST_MEMORY: &str = "1G";
+
+static TEST_REACTOR_OPTIONS: OnceLock<SeastarOptions> = OnceLock::new();
+
+/// Starts the reactor shared by all tests of the process, unless it is
+/// already running.
+fn ensure_test_reactor(options: &SeastarOptions) {
+    let running_with = TEST_REACTOR_OPTIONS.get_or_init(|| {
+        let mut args = vec!["seastar-test".to_owned()];
+        options.apply_to_args(&mut args);
+        assert!(
+            ffi::start_test_reactor(&args),
+            "failed to start the Seastar reactor for tests",
+        );
+        options.clone()
+    });
+    assert_eq!(
+        running_with, options,
+        "the test reactor is already running with different options; \
+         tests which need a different configuration must be run in a separate process",
+    );
+}
+
+/// Runs the test on shard 0 of the reactor shared by all tests in this
+/// process and returns its output.
+///
+/// This is what `#[seastar::test]` expands to, see [`run_in_shared_reactor`].
+pub fn run_test<Fut>(options: SeastarOptions, test: fn() -> Fut) -> Fut::Output
+where
+    Fut: Future + 'static,
+    Fut::Output: Send + 'static,
+{
+    run_in_shared_reactor(options, test)
+}
+
+/// Runs the future returned by `func` on shard 0 of the reactor shared by
+/// all tests in this process and returns its output.
+///
+/// The reactor is started with the given options by the first caller. Unless
+/// they say otherwise, it runs 2 shards with 1G of memory.
+/// Starting a reactor takes a considerable amount of time, and there can
+/// only be one per process anyway, so it is reused by all subsequent callers
+/// and stopped only when the process exits. Functions submitted concurrently
+/// from different threads, e.g. by the test harness, run concurrently on the
+/// reactor as well.
+///
+/// # Panics
+///
+/// Panics if the reactor cannot be started, or if it is already running with
+/// different options. A panic of the future is resumed on the calling thread.
+pub fn run_in_shared_reactor<F, Fut>(options: SeastarOptions, func: F) -> Fut::Output
+where
+    F: FnOnce() -> Fut + Send + 'static,
+    Fut: Future + 'static,
+    Fut::Output: Send + 'static,
+{
+    let options = options.with_default_resources(DEFAULT_TEST_SMP, DEFAULT_TEST_MEMORY);
+    ensure_test_reactor(&options);
+    let (tx, rx) = mpsc::sync_channel(1);
+    let task = AlienTask(Box::new(move || {
+        // The handle is dropped, the result is sent through the channel.
+        spawn(async move {
+            let result = AssertUnwindSafe(async move { func().await })
+                .catch_unwind()
+                .await;
+            let _ = tx.send(result);
+        });
+    }));
+    ffi::run_on_test_reactor(0, Box::new(task));
+    match rx
+        .recv()
+        .expect("the test reactor stopped before the future finished")
+    {
+        Ok(output) => output,
+        Err(payload) => panic::resume_unwind(payload),
+    }
+}